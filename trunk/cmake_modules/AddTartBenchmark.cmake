@@ -0,0 +1,61 @@
+# AddTartBenchmark - defines the "add_tart_benchmark" function
+
+include(AddTartTest)
+
+# Build a benchmark executable from the Tart sources in SRCLIST_VAR. The
+# ${BENCH_NAME}.run target runs it and writes the results to ${BENCH_NAME}.json.
+function(add_tart_benchmark BENCH_NAME SRCLIST_VAR)
+  add_tart_executable(${BENCH_NAME} ${SRCLIST_VAR})
+
+  set(EXE_FILE "${BENCH_NAME}${CMAKE_EXECUTABLE_SUFFIX}")
+  add_custom_target(${BENCH_NAME}.run
+      COMMAND ./${EXE_FILE} > ${BENCH_NAME}.json
+      DEPENDS ${EXE_FILE} ${BENCH_NAME}.deps
+      COMMENT "Running benchmarks, results in ${BENCH_NAME}.json")
+  add_dependencies(benchmark ${BENCH_NAME}.run)
+endfunction(add_tart_benchmark)
+
+# Build a second copy of the benchmark BENCH_NAME, optimized with the flags in
+# OPT_FLAGS_VAR instead, for comparing the effect of an optimization. The
+# ${BENCH_NAME}-${VARIANT}.run target writes the results to
+# ${BENCH_NAME}-${VARIANT}.json.
+function(add_tart_benchmark_variant BENCH_NAME VARIANT OPT_FLAGS_VAR)
+  set(VARIANT_NAME "${BENCH_NAME}-${VARIANT}")
+  set(LNK_BC_FILE "${BENCH_NAME}.lnk.bc")
+  set(OPT_BC_FILE "${VARIANT_NAME}.opt.bc")
+  set(OBJ_FILE "${VARIANT_NAME}${CMAKE_CXX_OUTPUT_EXTENSION}")
+  set(EXE_FILE "${VARIANT_NAME}${CMAKE_EXECUTABLE_SUFFIX}")
+
+  set(TEST_CLIBS runtime)
+  if (LIB_DL)
+    set(TEST_CLIBS ${TEST_CLIBS} dl)
+  endif (LIB_DL)
+
+  # Optimize the bitcode that was linked for BENCH_NAME
+  add_custom_command(OUTPUT ${OPT_BC_FILE}
+      COMMAND ${LLVM_OPT} ${${OPT_FLAGS_VAR}} -o ${OPT_BC_FILE} ${LNK_BC_FILE}
+      MAIN_DEPENDENCY "${LNK_BC_FILE}"
+      DEPENDS reflector
+      COMMENT "Generating optimized bitcode file ${OPT_BC_FILE}")
+
+  add_custom_command(OUTPUT ${OBJ_FILE}
+      COMMAND ${LLVM_LLC}
+          -load="${GC_PLUGIN}"
+          -disable-fp-elim
+          -filetype=obj
+          -o ${OBJ_FILE}
+          ${OPT_BC_FILE}
+      MAIN_DEPENDENCY "${OPT_BC_FILE}"
+      DEPENDS gc
+      COMMENT "Generating object file ${OBJ_FILE}")
+
+  add_executable(${EXE_FILE} EXCLUDE_FROM_ALL ${OBJ_FILE})
+  add_dependencies(${EXE_FILE} ${LIB_DEPS})
+  target_link_libraries(${EXE_FILE} ${TEST_CLIBS})
+
+  add_custom_target(${VARIANT_NAME}.run
+      COMMAND ./${EXE_FILE} > ${VARIANT_NAME}.json
+      DEPENDS ${EXE_FILE}
+      COMMENT "Running benchmarks, results in ${VARIANT_NAME}.json")
+  add_dependencies(benchmark ${VARIANT_NAME}.run)
+endfunction(add_tart_benchmark_variant)
@@ -1,11 +1,13 @@
-# AddTartTest - defines the "add_tart_test" function
+# AddTartTest - defines the "add_tart_test" and "add_tart_executable" functions
 
 set(TARTC_FLAGS
   -debug-errors
   -nostdlib # Don't look for stdlib in it's installed location
 )
 
-function(add_tart_test TEST_NAME SRCLIST_VAR)
+# Compile, link and optimize the Tart sources in SRCLIST_VAR into an executable
+# target named ${TEST_NAME}${CMAKE_EXECUTABLE_SUFFIX}.
+function(add_tart_executable TEST_NAME SRCLIST_VAR)
   include(${CMAKE_CURRENT_BINARY_DIR}/${TEST_NAME}.deps OPTIONAL)
 
   set(LNK_BC_FILE "${TEST_NAME}.lnk.bc")
@@ -80,7 +82,12 @@ function(add_tart_test TEST_NAME SRCLIST_VAR)
   add_executable(${EXE_FILE} EXCLUDE_FROM_ALL ${OBJ_FILE})
   add_dependencies(${EXE_FILE} ${LIB_DEPS})
   target_link_libraries(${EXE_FILE} ${TEST_CLIBS})
+endfunction(add_tart_executable)
+
+function(add_tart_test TEST_NAME SRCLIST_VAR)
+  add_tart_executable(${TEST_NAME} ${SRCLIST_VAR})
 
+  set(EXE_FILE "${TEST_NAME}${CMAKE_EXECUTABLE_SUFFIX}")
   add_custom_target(${TEST_NAME}.run COMMAND ./${EXE_FILE} DEPENDS ${EXE_FILE} ${TEST_NAME}.deps)
   add_dependencies(check ${TEST_NAME}.run)
 endfunction(add_tart_test)
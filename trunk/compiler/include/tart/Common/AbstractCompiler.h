@@ -24,6 +24,11 @@ public:
 
 protected:
   virtual void generate(Module * mod) = 0;
+
+  /** Called with the name of a module whose existing output has to be rebuilt,
+      because it depends on code which the module just compiled no longer
+      generates. The default does nothing. */
+  virtual void invalidate(StringRef moduleName) {}
 };
 
 }
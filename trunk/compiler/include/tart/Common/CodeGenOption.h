@@ -0,0 +1,73 @@
+/* ================================================================ *
+    TART - A Sweet Programming Language.
+ * ================================================================ */
+
+#ifndef TART_COMMON_CODEGENOPTION_H
+#define TART_COMMON_CODEGENOPTION_H
+
+#include "llvm/Support/CommandLine.h"
+
+#include <string>
+
+namespace tart {
+
+/// -------------------------------------------------------------------
+/// Base class of command-line options which change the code that is
+/// generated. Generated functions are cached under a key which includes
+/// the values of all of these options, so every option that affects
+/// generated code must be declared as a CodeGenOption rather than as a
+/// plain cl::opt. The target is not an option here, since the key
+/// already includes the data layout and target triple.
+class CodeGenOptionBase {
+public:
+  /** Append the names and values of all code generation options to 'out',
+      in a fixed order. */
+  static void describeAll(std::string & out);
+
+protected:
+  CodeGenOptionBase();
+  virtual ~CodeGenOptionBase() {}
+
+  /** Append 'name=value' for this option to 'out'. */
+  virtual void describe(std::string & out) const = 0;
+
+  static void describeValue(std::string & out, bool value);
+  static void describeValue(std::string & out, unsigned value);
+  static void describeValue(std::string & out, const std::string & value);
+
+private:
+  CodeGenOptionBase * next_;
+
+  static CodeGenOptionBase * first_;
+};
+
+/// -------------------------------------------------------------------
+/// A cl::opt which is registered as a code generation option.
+template<class T>
+class CodeGenOption : public llvm::cl::opt<T>, public CodeGenOptionBase {
+public:
+  template<class M0, class M1>
+  CodeGenOption(const M0 & m0, const M1 & m1)
+    : llvm::cl::opt<T>(m0, m1) {}
+
+  template<class M0, class M1, class M2>
+  CodeGenOption(const M0 & m0, const M1 & m1, const M2 & m2)
+    : llvm::cl::opt<T>(m0, m1, m2) {}
+
+  template<class M0, class M1, class M2, class M3>
+  CodeGenOption(const M0 & m0, const M1 & m1, const M2 & m2, const M3 & m3)
+    : llvm::cl::opt<T>(m0, m1, m2, m3) {}
+
+  using llvm::cl::opt<T>::operator=;
+
+private:
+  void describe(std::string & out) const {
+    out += this->ArgStr;
+    out += '=';
+    describeValue(out, this->getValue());
+  }
+};
+
+} // namespace tart
+
+#endif // TART_COMMON_CODEGENOPTION_H
@@ -16,6 +16,7 @@ namespace tart {
 class Compiler : public AbstractCompiler {
 protected:
   virtual void generate(Module * mod);
+  virtual void invalidate(StringRef moduleName);
 };
 
 }
@@ -0,0 +1,154 @@
+/* ================================================================ *
+    TART - A Sweet Programming Language.
+ * ================================================================ */
+
+#ifndef TART_COMMON_COMPILERSTATS_H
+#define TART_COMMON_COMPILERSTATS_H
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/DataTypes.h"
+
+namespace llvm {
+class raw_ostream;
+}
+
+namespace tart {
+
+/// -------------------------------------------------------------------
+/// A phase of the compiler whose running time is recorded when timing
+/// is enabled. Phases are arranged in a fixed hierarchy for reporting,
+/// but may be entered in any order at run time: parsing an imported
+/// module can happen in the middle of analysis, for example.
+///
+/// The total time of a phase runs from its outermost entry to the
+/// matching exit, so recursive entries aren't counted twice. The self
+/// time excludes any time during which some other phase was entered
+/// on top of it.
+class PhaseTimer {
+public:
+  PhaseTimer(const char * name, const char * desc, PhaseTimer * parent = NULL);
+
+  /** Short name of this phase, used in JSON output. */
+  const char * name() const { return name_; }
+
+  /** Description of this phase, used in text output. */
+  const char * desc() const { return desc_; }
+
+  /** The phase which this one is reported under. */
+  PhaseTimer * parent() const { return parent_; }
+
+  /** Total and self times, in microseconds. */
+  uint64_t totalTime() const { return totalTime_; }
+  uint64_t selfTime() const { return selfTime_; }
+
+  /** Number of times this phase was entered, not counting recursive entries. */
+  unsigned count() const { return count_; }
+
+  /** Turn timing on or off. */
+  static void setEnabled(bool enabled) { enabled_ = enabled; }
+  static bool isEnabled() { return enabled_; }
+
+  /** Print a table of phase times. */
+  static void print(llvm::raw_ostream & out);
+
+  /** Print phase times as a JSON array. */
+  static void printJson(llvm::raw_ostream & out);
+
+private:
+  friend class PhaseScope;
+
+  const char * name_;
+  const char * desc_;
+  PhaseTimer * parent_;
+  PhaseTimer * next_;
+  uint64_t totalTime_;
+  uint64_t selfTime_;
+  uint64_t entryTime_;
+  unsigned count_;
+  unsigned depth_;
+
+  static void printChildren(llvm::raw_ostream & out, PhaseTimer * parent, unsigned indent);
+
+  static PhaseTimer * first_;
+  static PhaseTimer * last_;
+  static bool enabled_;
+};
+
+/// -------------------------------------------------------------------
+/// Enters a phase for the lifetime of this object. Does nothing if
+/// timing is not enabled.
+class PhaseScope {
+public:
+  PhaseScope(PhaseTimer & timer);
+  ~PhaseScope();
+
+private:
+  PhaseTimer * timer_;
+  PhaseScope * outer_;
+  uint64_t resumeTime_;
+
+  // The innermost active scope.
+  static PhaseScope * current_;
+};
+
+/// -------------------------------------------------------------------
+/// A named event counter, reported with -stats. Counters are declared
+/// as static objects in the file that updates them.
+class StatCounter {
+public:
+  StatCounter(const char * name, const char * desc);
+
+  const char * name() const { return name_; }
+  const char * desc() const { return desc_; }
+  uint64_t value() const { return value_; }
+
+  StatCounter & operator++() {
+    ++value_;
+    return *this;
+  }
+
+  StatCounter & operator+=(uint64_t n) {
+    value_ += n;
+    return *this;
+  }
+
+  /** Return the counter named 'name', or NULL if there is none. */
+  static StatCounter * find(llvm::StringRef name);
+
+  /** Print all counters which are non-zero. */
+  static void print(llvm::raw_ostream & out);
+
+  /** Print all counters as a JSON object. */
+  static void printJson(llvm::raw_ostream & out);
+
+private:
+  const char * name_;
+  const char * desc_;
+  uint64_t value_;
+  StatCounter * next_;
+
+  static StatCounter * first_;
+};
+
+/** Print the phase times and all counters as a JSON document, as written by
+    -stats-json. */
+void printStatsJson(llvm::raw_ostream & out);
+
+/// -------------------------------------------------------------------
+/// The phases of the compiler.
+namespace Phase {
+  extern PhaseTimer Compile;
+  extern PhaseTimer Parse;
+  extern PhaseTimer ScopeBuild;
+  extern PhaseTimer Analyze;
+  extern PhaseTimer TypeInference;
+  extern PhaseTimer Eval;
+  extern PhaseTimer CodeGen;
+  extern PhaseTimer Verify;
+  extern PhaseTimer Output;
+  extern PhaseTimer GCSweep;
+}
+
+} // namespace tart
+
+#endif // TART_COMMON_COMPILERSTATS_H
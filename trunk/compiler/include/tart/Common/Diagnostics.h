@@ -15,6 +15,12 @@
 
 #include "llvm/Support/Compiler.h"
 
+namespace llvm {
+namespace cl {
+  class Option;
+}
+}
+
 namespace tart {
 
 /// ---------------------------------------------------------------
@@ -43,6 +49,14 @@ namespace tart {
 #define DMSG(condition) \
     (!condition) ? (void)0 : Diagnostics::VoidResult() & Diagnostics::DebugStream()
 
+// Debugging message whose arguments are only formatted if debugging messages are being
+// written. tartc filters them out with -min-severity, unless an option such as -trace-def
+// asks for them. Use in place of diag.debug() where building the message is expensive:
+//
+//   DDEBUG(loc) << Format_Verbose << "Merging " << fn;
+#define DDEBUG(loc) \
+    !diag.isEnabled(Diagnostics::Debug) ? (void)0 : Diagnostics::VoidResult() & diag.debug(loc)
+
 /// ---------------------------------------------------------------
 /// Various diagnostic functions.
 ///
@@ -215,6 +229,21 @@ public:
     llvm::SmallString<256> str_;
   };
 
+  /** Marks a command-line option which asks for debugging messages. Declare one
+      next to the option, so that giving the option turns on debug messages even
+      where the minimum severity would filter them out:
+
+        static cl::opt<bool> ShowImports("show-imports", cl::desc("Display imports"));
+        static Diagnostics::DebugOption ShowImportsDebug(ShowImports);
+  */
+  class DebugOption {
+  public:
+    DebugOption(const llvm::cl::Option & option);
+
+    /** Return true if any option marked as a DebugOption was given on the command line. */
+    static bool anyGiven();
+  };
+
   /** Used to transform a stream into a void result. */
   class VoidResult {};
 
@@ -236,6 +265,10 @@ public:
   /** Set the minimum severity level to be reported. */
   void setMinSeverity(Severity s) { minSeverity = s; }
 
+  /** Return true if a message of severity 'sev' would be written. This can be
+      tested before doing any work to compose the message; see DDEBUG. */
+  bool isEnabled(Severity sev) const { return writer_ != NULL && sev >= minSeverity; }
+
   /** Fatal error. */
   FatalErrorStream fatal(const SourceLocation & loc = SourceLocation()) {
     return FatalErrorStream(loc);
@@ -17,6 +17,7 @@
 
 namespace tart {
 
+class GCArena;
 class GCRootBase;
 class GCWeakPtrBase;
 
@@ -72,6 +73,10 @@ public:
   /** Register a callback to be called when we shut down the collector. */
   static void registerUninitCallback(Callback * cb);
 
+  /** Register a callback to be called at the start of every collection, before
+      any roots are traced. */
+  static void registerSweepCallback(Callback * cb);
+
   /** A version of mark which handles null pointers. */
   template <class T>
   static void safeMark(T const * const ptr) {
@@ -107,6 +112,8 @@ public:
   }
 
 private:
+  friend class GCArena;
+  friend class GCArenaScope;
   friend class GCRootBase;
   friend class GCWeakPtrBase;
 
@@ -119,12 +126,45 @@ private:
 
   static unsigned char cycleIndex_;
   static GC * allocList_;
+  static GCArena * arenas_;
+  static GCArena * currentArena_;
   static GCRootBase * roots_;
   static CallbackList uninitCallbacks_;
+  static CallbackList sweepCallbacks_;
   static WeakPtrList weakPtrs_;
   static ObjectList toTrace_;
 };
 
+/// -------------------------------------------------------------------
+/// While an instance of this class is in scope, new GC objects are
+/// bump-allocated from a region belonging to the scope, rather than
+/// being allocated one at a time. Use it around work which creates
+/// many objects that die together, such as parsing a module or
+/// analyzing a function.
+///
+/// Objects in a region are collected like any other. A region whose
+/// objects are all unreachable at a sweep is released in one step.
+/// Objects can't be moved, so one that is still reachable - an AST
+/// kept for a template, say - keeps the chunk it was allocated in,
+/// but the other chunks of the region are freed. Scopes may be nested,
+/// in which case the innermost one is used.
+class GCArenaScope {
+public:
+  enum Sharing {
+    /** Always open a new region. */
+    NewArena,
+
+    /** If a region is already open, allocate from that instead. */
+    ShareEnclosing,
+  };
+
+  explicit GCArenaScope(Sharing sharing = NewArena);
+  ~GCArenaScope();
+
+private:
+  GCArena * arena_;
+};
+
 /// -------------------------------------------------------------------
 /// Base class for garbage collection roots.
 class GCRootBase {
@@ -0,0 +1,61 @@
+/* ================================================================ *
+    TART - A Sweet Programming Language.
+ * ================================================================ */
+
+#ifndef TART_COMMON_IDENTTABLE_H
+#define TART_COMMON_IDENTTABLE_H
+
+#ifndef LLVM_ADT_STRINGMAP_H
+#include <llvm/ADT/StringMap.h>
+#endif
+
+namespace tart {
+
+using llvm::StringRef;
+
+/// -------------------------------------------------------------------
+/// Information kept for each identifier in the identifier table.
+struct IdentInfo {
+  unsigned id;                // Unique, non-zero number of this identifier.
+  unsigned hash;              // Hash of the identifier's text.
+
+  IdentInfo() : id(0), hash(0) {}
+};
+
+/** An interned identifier. The text of an identifier never moves, so the StringRef
+    returned by getKey() can be kept for as long as the compiler runs. */
+typedef llvm::StringMapEntry<IdentInfo> Ident;
+
+/// -------------------------------------------------------------------
+/// The table of all identifiers seen by the compiler. Each distinct name
+/// is stored once, with a stable id and its hash computed in advance, so
+/// that symbol tables can compare names by pointer and never need to
+/// hash them again.
+///
+/// The parser interns every identifier it reads, so lookups of names that
+/// came from the source are cheap: recently used identifiers are
+/// remembered by the address of their text, and a lookup with a StringRef
+/// pointing at that text finds them without hashing. This is the usual
+/// case, since resolving a name tries the same StringRef against each
+/// enclosing scope in turn.
+namespace IdentTable {
+
+  /** Return the identifier for 'str', adding it to the table if needed. */
+  const Ident * get(StringRef str);
+
+  /** Return the identifier for 'str', or NULL if there is no such identifier -
+      in which case, no symbol table can contain it either. */
+  const Ident * find(StringRef str);
+
+  /** Return an interned copy of 'str'. */
+  inline StringRef intern(StringRef str) {
+    return get(str)->getKey();
+  }
+
+  /** Return the number of identifiers in the table. */
+  unsigned count();
+}
+
+}
+
+#endif // TART_COMMON_IDENTTABLE_H
@@ -0,0 +1,107 @@
+/* ================================================================ *
+    TART - A Sweet Programming Language.
+ * ================================================================ */
+
+#ifndef TART_COMMON_TEMPLATEREPOSITORY_H
+#define TART_COMMON_TEMPLATEREPOSITORY_H
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+
+#include <set>
+#include <string>
+
+namespace tart {
+
+class Defn;
+class Module;
+
+/// -------------------------------------------------------------------
+/// An on-disk record of which module owns the code for each template
+/// instance method, shared by all of the compilation units in a build.
+///
+/// Normally every module that uses a template instance analyzes and
+/// generates its own copy of the instance methods, and the linker keeps
+/// only one of them. When a repository file is given with
+/// -template-repo, the first module to use an instance method becomes
+/// its owner and emits the body; later modules only import it, which
+/// means they analyze it no further than its signature and emit a
+/// declaration.
+///
+/// The repository also records which modules import each instance. If a
+/// recompiled module no longer generates an instance that it used to own,
+/// the modules that imported it are left with a declaration only. Their
+/// bitcode files are removed, so that the build compiles them again, at
+/// which point one of them becomes the new owner.
+///
+/// All modules compiled against the same repository must be linked
+/// together, and must be written to the same output directory. The repository lives in the build directory, and should be
+/// deleted along with the bitcode files on a clean build. Updates to it
+/// are serialized with a lock file, so modules can be compiled in
+/// parallel.
+class TemplateRepository {
+public:
+  TemplateRepository() : loaded_(false), module_(NULL) {}
+
+  /** True if a repository file was specified on the command line. */
+  bool isEnabled() const;
+
+  /** Called before analyzing 'mod'. Any instances that 'mod' previously owned
+      are released, so that it only reclaims those it still uses. */
+  void beginModule(const Module * mod);
+
+  /** Called after 'mod' has been successfully generated. Writes the
+      repository back to disk. The names of modules which imported instances
+      that 'mod' no longer generates are added to 'staleModules'; the output
+      of those modules must be discarded, and they must be compiled again. */
+  void endModule(const Module * mod, llvm::SmallVectorImpl<std::string> & staleModules);
+
+  /** Given a synthetic definition that is being added to module 'mod', return
+      true if 'mod' should generate it, and false if some other module owns it.
+      If the definition has no owner yet, 'mod' becomes the owner; otherwise
+      'mod' is recorded as one of its importers. */
+  bool claim(const Defn * de, const Module * mod);
+
+  /** Return true if 'mod' is the recorded owner of 'de'. */
+  bool isOwner(const Defn * de, const Module * mod) const;
+
+  /** The repository file given with -template-repo, or empty if none. */
+  static llvm::StringRef path();
+
+  /** Change the repository file. Used by the unit tests. */
+  static void setPath(llvm::StringRef path);
+
+  /** Return the singleton instance. */
+  static TemplateRepository & get() { return instance_; }
+
+private:
+  typedef std::set<std::string> ModuleSet;
+
+  /** The module that generates an instance, and the modules that import it. */
+  struct Entry {
+    std::string owner;
+    ModuleSet importers;
+  };
+
+  typedef llvm::StringMap<Entry> EntryMap;
+  typedef llvm::StringMap<ModuleSet> ImporterMap;
+
+  /** Return true if the code for 'de' can be shared through the repository. */
+  static bool isShareable(const Defn * de);
+
+  /** Read the repository file into 'entries'. */
+  static void read(EntryMap & entries);
+
+  EntryMap entries_;
+  ImporterMap released_;
+  bool loaded_;
+  const Module * module_;
+
+  // The singleton instance.
+  static TemplateRepository instance_;
+};
+
+} // namespace tart
+
+#endif // TART_COMMON_TEMPLATEREPOSITORY_H
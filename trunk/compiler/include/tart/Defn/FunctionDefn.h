@@ -120,6 +120,11 @@ public:
     Intrinsic = (1<<12),        // This function is an intrinsic
     TraceMethod = (1<<13),      // This overrides the compiler-generated trace strategy
     ReadOnlySelf = (1<<14),     // Guarantees no mutations to 'self'.
+    SelfEscapeKnown = (1<<15),  // Escape analysis of 'self' has been done.
+    NonEscapingSelf = (1<<16),  // 'self' is not retained after the function returns.
+    VarArgsEscapeKnown = (1<<17), // Escape analysis of the variadic param has been done.
+    NonEscapingVarArgs = (1<<18), // The variadic array is not retained after the call.
+    NoEscapeVarArgs = (1<<19),  // Declared @NoEscape - also binds any overrides.
     //Commutative = (1<<6),  // A function whose order of arguments can be reversed
     //Associative = (1<<7),  // A varargs function that can be combined with itself.
   };
@@ -134,6 +139,7 @@ public:
     MergePass,
     CompletionPass,
     ReflectionPass,
+    EscapePass,
     PassCount,
   };
 
@@ -9,53 +9,90 @@
 #include "tart/CFG/CFG.h"
 #endif
 
-#ifndef LLVM_ADT_STRINGMAP_H
-#include <llvm/ADT/StringMap.h>
+#ifndef TART_COMMON_IDENTTABLE_H
+#include "tart/Common/IdentTable.h"
 #endif
 
 #ifndef LLVM_ADT_SMALLVECTOR_H
 #include <llvm/ADT/SmallVector.h>
 #endif
 
+#include <vector>
+
 namespace tart {
 
 class FormatStream;
 
 /// -------------------------------------------------------------------
-/// Mapping of names to definitions
+/// Mapping of names to definitions.
+///
+/// Names are interned in the IdentTable, and compared by identity. Small
+/// tables are searched in order; larger ones also have an open-addressed
+/// index which is probed using the hash stored with each identifier.
+/// Buckets are bump-allocated and never move, so pointers to entries stay
+/// valid as the table grows. Iteration is in the order that names were
+/// first added.
 class SymbolTable {
 public:
   typedef llvm::SmallVector<Defn *, 4> Entry;
-  typedef llvm::StringMap<Entry/*, llvm::BumpPtrAllocator*/> NameDefnMap;
-  typedef NameDefnMap::iterator iterator;
-  typedef NameDefnMap::const_iterator const_iterator;
 
-  SymbolTable() {}
-  virtual ~SymbolTable() {}
+  /** A name, and all of the definitions with that name. The members are called
+      'first' and 'second' so that a bucket can be used like a map entry. */
+  struct Bucket {
+    const Ident * first;
+    Entry second;
+    Bucket * next;
+
+    Bucket(const Ident * ident) : first(ident), next(NULL) {}
+
+    /** The name of the definitions in this bucket. */
+    StringRef name() const { return first->getKey(); }
+  };
+
+  /** Iterates over the buckets in a symbol table. */
+  template<class BucketType>
+  class BucketIterator {
+  public:
+    BucketIterator(BucketType * bucket = NULL) : bucket_(bucket) {}
+
+    BucketType & operator*() const { return *bucket_; }
+    BucketType * operator->() const { return bucket_; }
+
+    BucketIterator & operator++() {
+      bucket_ = bucket_->next;
+      return *this;
+    }
+
+    bool operator==(const BucketIterator & other) const { return bucket_ == other.bucket_; }
+    bool operator!=(const BucketIterator & other) const { return bucket_ != other.bucket_; }
+
+  private:
+    BucketType * bucket_;
+  };
+
+  typedef BucketIterator<Bucket> iterator;
+  typedef BucketIterator<const Bucket> const_iterator;
+
+  SymbolTable() : firstBucket_(NULL), lastBucket_(NULL), size_(0) {}
+  SymbolTable(const SymbolTable & other);
+  virtual ~SymbolTable() { clear(); }
 
   /** Add a new declaration to this scope. */
   SymbolTable::Entry * add(Defn * d);
 
   /** Get the count of items in the scope */
-  size_t count() const { return map_.size(); }
+  size_t count() const { return size_; }
 
   /** Find a declaration by name */
-  const Entry * findSymbol(StringRef key) const {
-    NameDefnMap::const_iterator it = map_.find(key);
-    if (it != map_.end()) {
-      return &it->second;
-    } else {
-      return NULL;
-    }
-  }
+  const Entry * findSymbol(StringRef key) const;
 
-  iterator begin() { return map_.begin(); }
-  const_iterator begin() const { return map_.begin(); }
-  iterator end() { return map_.end(); }
-  const_iterator end() const { return map_.end(); }
+  iterator begin() { return iterator(firstBucket_); }
+  const_iterator begin() const { return const_iterator(firstBucket_); }
+  iterator end() { return iterator(); }
+  const_iterator end() const { return const_iterator(); }
 
   /** Clear the symbol table. */
-  void clear() { map_.clear(); }
+  void clear();
 
   /** GC trace function */
   void trace() const;
@@ -64,9 +101,27 @@ public:
   void getDebugSummary(FormatStream & out) const;
 
 private:
+  typedef std::vector<Bucket *> BucketIndex;
+
+  // Buckets, in the order they were added.
+  Bucket * firstBucket_;
+  Bucket * lastBucket_;
+  size_t size_;
+
+  // Index of buckets by identifier hash. Empty until the table is large enough
+  // that a linear search would be slow.
+  BucketIndex index_;
+
+  SymbolTable & operator=(const SymbolTable &); // Not implemented
+
+  /** Return the bucket for 'ident', or NULL. */
+  Bucket * findBucket(const Ident * ident) const;
+
+  /** Add 'bucket' to the index. */
+  void addToIndex(Bucket * bucket);
 
-  // Map of declarations by name
-  NameDefnMap map_;
+  /** Rebuild the index with room for at least twice the current number of names. */
+  void rebuildIndex();
 };
 
 /// -------------------------------------------------------------------
@@ -352,11 +352,20 @@ public:
 /// -------------------------------------------------------------------
 /// A 'new object' expression
 class NewExpr : public Expr {
+private:
+  bool stackAlloc_;
+
 public:
   NewExpr(const SourceLocation & loc, QualifiedType type)
     : Expr(New, loc, type)
+    , stackAlloc_(false)
   {}
 
+  /** True if the new object never escapes the enclosing function, and can be
+      allocated in its stack frame instead of on the heap. */
+  bool isStackAlloc() const { return stackAlloc_; }
+  void setStackAlloc(bool stackAlloc) { stackAlloc_ = stackAlloc; }
+
   // Overridden methods
   void format(FormatStream & out) const;
   bool isSideEffectFree() const { return true; }
@@ -516,11 +525,20 @@ private:
 /// -------------------------------------------------------------------
 /// An array literal.
 class ArrayLiteralExpr : public ArglistExpr {
+private:
+  bool stackAlloc_;
+
 public:
   ArrayLiteralExpr(const SourceLocation & loc)
     : ArglistExpr(ArrayLiteral, loc, NULL)
+    , stackAlloc_(false)
   {}
 
+  /** True if the array is only passed to a variadic parameter which doesn't retain
+      it, so it can be built in the stack frame of the caller. */
+  bool isStackAlloc() const { return stackAlloc_; }
+  void setStackAlloc(bool stackAlloc) { stackAlloc_ = stackAlloc; }
+
   // Overrides
 
   bool isSideEffectFree() const {
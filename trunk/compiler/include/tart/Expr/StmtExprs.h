@@ -203,7 +203,8 @@ public:
   Expr * iterator() const { return iterator_; }
   void setIterator(Expr * e) { iterator_ = e; }
 
-  /** The expression that produces the next iteration value. */
+  /** The expression that produces the next iteration value. This is NULL for loops
+      which are stepped by index rather than by an iterator. */
   Expr * next() const { return next_; }
   void setNext(Expr * e) { next_ = e; }
 
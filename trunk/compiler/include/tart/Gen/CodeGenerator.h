@@ -87,6 +87,7 @@ class ConstantString;
 class ConstantObjectRef;
 class ConstantNativeArray;
 class ProgramSource;
+class FunctionCache;
 
 typedef llvm::SmallVector<Expr *, 4> ExprList;
 typedef llvm::SmallVector<FunctionDefn *, 32> MethodList;
@@ -97,6 +98,7 @@ typedef llvm::DenseMap<const ConstantObjectRef *, llvm::Constant *> ConstantObje
 typedef llvm::DenseMap<QualifiedType, llvm::DIType, QualifiedType::KeyInfo> DITypeMap;
 typedef llvm::DenseMap<llvm::GlobalVariable *, llvm::Constant *> StaticRootMap;
 typedef llvm::StringMap<llvm::Constant *> StringLiteralMap;
+typedef llvm::DenseMap<llvm::Constant *, llvm::GlobalVariable *> ConstantArrayMap;
 typedef llvm::SmallVector<LocalScope *, 4> LocalScopeList;
 
 /// -------------------------------------------------------------------
@@ -182,6 +184,7 @@ public:
   };
 
   CodeGenerator(Module * mod);
+  ~CodeGenerator();
 
   /** Return the builder object. */
   llvm::IRBuilder<true> & builder() { return builder_; }
@@ -192,6 +195,10 @@ public:
   /** Function to generate the module code. */
   void generate();
 
+  /** Return the path of the bitcode file that is written for the module whose
+      qualified name is 'moduleName'. */
+  static std::string outputPath(StringRef moduleName);
+
   llvm::LLVMContext & context() const { return context_; }
   Module * module() const { return module_; }
 
@@ -280,6 +287,8 @@ public:
   llvm::Value * genCall(const FnCallExpr * in);
   llvm::Value * genIndirectCall(const IndirectCallExpr * in);
   llvm::Value * genNew(const NewExpr * in);
+  llvm::Value * genStackNew(const CompositeType * ctdef);
+  llvm::Value * genStackArray(const CompositeType * arrayType, size_t length);
   llvm::Value * defaultAlloc(const tart::Expr * size);
   llvm::Value * genCompositeCast(llvm::Value * in, const CompositeType * fromCls,
       const CompositeType * toCls, bool throwOnFailure);
@@ -327,6 +336,10 @@ public:
   llvm::Value * genCallInstr(llvm::Value * fn, llvm::ArrayRef<llvm::Value *> args,
       const llvm::Twine & name);
 
+  /** Store a large value which was returned in registers into a temporary, and return
+      the address of the temporary, which is how large values are normally handled. */
+  llvm::Value * genReturnTemp(llvm::Value * value);
+
   /** Get the address of a value. */
   llvm::Value * genBoundMethod(const BoundMethodExpr * in);
 
@@ -365,7 +378,12 @@ public:
       ConstantList & traceTable, ConstantList & fieldOffsets, ConstantList & indices);
   void createCompositeTraceTableEntries(const CompositeType * type, llvm::Constant * basePtr,
       ConstantList & traceTable, ConstantList & fieldOffsets, ConstantList & indices);
+  void createArrayTraceTableEntry(const VariableDefn * arrayField,
+      const VariableDefn * lengthField, llvm::Constant * basePtr, ConstantList & traceTable,
+      ConstantList & indices);
   llvm::Function * getUnionTraceMethod(const UnionType * utype);
+  void createRefOrVoidTraceTableEntry(const UnionType * utype, llvm::Constant * basePtr,
+      ConstantList & traceTable, ConstantList & indices);
 
   /** Generate the program entry point. */
   void genEntryPoint();
@@ -395,12 +413,22 @@ public:
   /** return a reference to the global gc_alloc function (allocates memory in the nursery space). */
   llvm::Function * getGcAlloc();
 
+  /** Generate code to allocate 'size' bytes of collected memory. The common case is
+      done inline, using the collector's allocation context. */
+  llvm::Value * genAlloc(llvm::Value * size, const llvm::Twine & name);
+
   /** Generate data structures for a string literal. */
   llvm::Constant * genStringLiteral(StringRef strval, StringRef symName = "");
 
   /** Generate an array literal. */
   llvm::Value * genArrayLiteral(const ArrayLiteralExpr * in);
 
+  /** Generate a static, read-only array object containing 'elements'. Elements which
+      are NULL are filled with zeros. Arrays with the same type and contents are only
+      generated once per module. */
+  llvm::GlobalVariable * genConstantArrayLiteral(const CompositeType * arrayType,
+      llvm::ArrayRef<llvm::Constant *> elements);
+
   /** Generate a closure environment. */
   llvm::Value * genClosureEnv(const ClosureEnvExpr * in);
 
@@ -414,6 +442,9 @@ public:
   /** Generate the contents of a constant object. */
   llvm::Constant * genConstantObject(const ConstantObjectRef * obj);
 
+  /** Generate a pointer to a constant object that is referred to by another constant. */
+  llvm::Constant * genConstantObjectRef(const ConstantObjectRef * obj);
+
   /** Generate a structure from the fields of a constant object. */
   llvm::Constant * genConstantObjectStruct(
       const ConstantObjectRef * obj, const CompositeType * type);
@@ -613,6 +644,7 @@ private:
   Reflector reflector_;
   NameTable nameTable_;
   bool gcEnabled_;
+  FunctionCache * functionCache_;
 
   // Debug information
   DIFileMap dbgFiles_;
@@ -636,7 +668,9 @@ private:
 
   RTTypeMap compositeTypeMap_;
   StringLiteralMap stringLiteralMap_;
+  ConstantArrayMap constantArrayMap_;
   ConstantObjectMap constantObjectMap_;
+  ConstantObjectMap constantObjectPtrMap_;
   TraceTableMap traceTableMap_;
   TraceMethodMap traceMethodMap_;
   StaticRootMap staticRoots_;
@@ -0,0 +1,114 @@
+/* ================================================================ *
+    TART - A Sweet Programming Language.
+ * ================================================================ */
+
+#ifndef TART_GEN_FUNCTIONCACHE_H
+#define TART_GEN_FUNCTIONCACHE_H
+
+#ifndef TART_TYPE_QUALIFIEDTYPE_H
+#include "tart/Type/QualifiedType.h"
+#endif
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/DataTypes.h"
+
+#include <string>
+#include <vector>
+
+namespace llvm {
+class Module;
+class Function;
+}
+
+namespace tart {
+
+class FunctionDefn;
+class Type;
+
+/// -------------------------------------------------------------------
+/// A cache of generated functions, kept in a directory on disk and shared
+/// between compilations.
+///
+/// Each entry is a small bitcode module containing one function, keyed by
+/// a hash of everything its code depends on: the analyzed body, the
+/// function's signature and linkage, the identities and signatures of the
+/// definitions it refers to, and the layouts of the types it uses. When a
+/// module is compiled again, functions whose key is found in the cache are
+/// not generated; instead their bodies are linked in from the cache once
+/// the rest of the module is complete.
+///
+/// Only functions which can be moved between modules by name are stored -
+/// ones that refer to private globals with state, for example, are always
+/// generated.
+class FunctionCache {
+public:
+  /** Create a cache in directory 'dir'. The 'options' string describes any
+      compiler settings which affect generated code, and is included in every
+      key. */
+  FunctionCache(StringRef dir, StringRef options, llvm::Module * irModule);
+  ~FunctionCache();
+
+  /** Compute the key for the body of 'fdef', which is about to be generated as 'fn'.
+      Returns 0 if the function can't be cached. */
+  uint64_t key(const FunctionDefn * fdef, const llvm::Function * fn);
+
+  /** Look for a cached body for 'fn'. If there is one, it is linked into the module by
+      finish(), and 'fn' should be left as a declaration until then. */
+  bool load(uint64_t key, llvm::Function * fn);
+
+  /** Record that 'fn' was generated, so that finish() can add it to the cache. */
+  void add(uint64_t key, llvm::Function * fn);
+
+  /** Write the newly generated functions to the cache, then link the bodies found
+      in the cache into the module. */
+  void finish();
+
+private:
+  enum StoreResult {
+    Stored,
+    Uncacheable,      // The function can't be moved into a cache entry.
+    WriteFailed,      // The cache entry couldn't be written.
+  };
+
+  typedef llvm::DenseMap<const Type *, uint64_t> TypeHashMap;
+  typedef std::vector<std::pair<uint64_t, llvm::Function *> > PendingList;
+
+  std::string dir_;
+  std::string options_;
+  llvm::Module * irModule_;
+  TypeHashMap nameHashes_;
+  TypeHashMap layoutHashes_;
+  PendingList stores_;
+  llvm::StringMap<llvm::Module *> loads_;
+
+  // Types whose layout hash is being computed, and the outermost of them which
+  // was found to refer back to itself.
+  std::vector<const Type *> layoutStack_;
+  size_t cutDepth_;
+
+  // Set when writing to the cache fails, after which no more entries are written.
+  bool writeFailed_;
+
+  friend class FunctionKeyBuilder;
+
+  /** Return a hash of the name of 'type', without looking inside it. */
+  uint64_t nameHash(const Type * type);
+
+  /** Return a hash of the layout of 'type' - its fields and method table, if it's
+      a composite type, and the layouts of the types it is made from. */
+  uint64_t layoutHash(const Type * type);
+
+  /** Return the path of the cache entry for 'key'. */
+  std::string entryPath(uint64_t key) const;
+
+  /** Write 'fn' to the cache entry for 'key'. */
+  StoreResult store(uint64_t key, llvm::Function * fn);
+
+  /** Warn that writing to the cache failed, and stop writing to it. */
+  StoreResult writeFailed(const std::string & what, const std::string & errMsg);
+};
+
+}
+
+#endif // TART_GEN_FUNCTIONCACHE_H
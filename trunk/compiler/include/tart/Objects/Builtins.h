@@ -82,6 +82,7 @@ public:
   static SystemClass typeIntrinsicAttribute;
 
   // System types - gc
+  static SystemClass typeAllocContext;
   static SystemClass typeStaticRoot;
   static SystemClass typeTraceAction;
   static SystemClass typeTraceDescriptor;
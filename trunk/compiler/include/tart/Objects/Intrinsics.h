@@ -464,6 +464,15 @@ class NoInlineApplyIntrinsic : public Intrinsic {
       Expr * self, const ExprList & args, Type * expectedReturn) const;
 };
 
+// -------------------------------------------------------------------
+// NoEscape.apply intrinsic
+class NoEscapeApplyIntrinsic : public Intrinsic {
+  static NoEscapeApplyIntrinsic instance;
+  NoEscapeApplyIntrinsic() : Intrinsic("tart.core.NoEscape.apply") {}
+  Expr * eval(const SourceLocation & loc, Module * callingModule, const FunctionDefn * method,
+      Expr * self, const ExprList & args, Type * expectedReturn) const;
+};
+
 // -------------------------------------------------------------------
 // Associative.apply intrinsic
 class AssociativeApplyIntrinsic : public Intrinsic {
@@ -9,6 +9,10 @@
 #include "tart/Defn/Defn.h"
 #endif
 
+#ifndef TART_COMMON_DIAGNOSTICS_H
+#include "tart/Common/Diagnostics.h"
+#endif
+
 #include "llvm/ADT/SetVector.h"
 #include "llvm/Support/CommandLine.h"
 
@@ -303,6 +307,7 @@ protected:
   bool defnListToLookupResults(DefnList & defs, Expr * context, LookupResults & out);
 
   static llvm::cl::opt<std::string> traceDef_;
+  static Diagnostics::DebugOption traceDefDebug_;
 };
 
 /** Class used to report what analysis tasks are in progress. */
@@ -0,0 +1,81 @@
+/* ================================================================ *
+    TART - A Sweet Programming Language.
+ * ================================================================ */
+
+#ifndef TART_SEMA_ESCAPEANALYSISPASS_H
+#define TART_SEMA_ESCAPEANALYSISPASS_H
+
+#ifndef TART_SEMA_CFGPASS_H
+#include "tart/Sema/CFGPass.h"
+#endif
+
+#include "llvm/ADT/SmallPtrSet.h"
+
+namespace tart {
+
+/// -------------------------------------------------------------------
+/// Function pass which finds objects that never outlive the function
+/// that creates them, and marks them for allocation on the stack.
+///
+/// An object is stack allocated if it is constructed directly into a
+/// local variable, and every use of that variable is one of: a field
+/// access, a comparison, an assignment to the variable itself, or the
+/// 'self' argument of a direct (non-virtual) call to a method whose
+/// own 'self' does not escape. A local variable which is initialized
+/// from the object is treated as another name for it.
+///
+/// The pass also marks the argument arrays built for direct variadic
+/// calls as stack allocated, when the callee never retains its variadic
+/// parameter - either because analysis of its body shows that it
+/// doesn't, or because it is declared with the 'NoEscape' attribute.
+/// Arrays passed to virtual or interface calls are always heap allocated.
+class EscapeAnalysisPass : public CFGPass {
+public:
+
+  /** Run this pass on the specified function. */
+  static void run(FunctionDefn * fn);
+
+  /** Return true if the method 'fn' never retains its 'self' argument beyond
+      the duration of the call. The result is cached in the function flags. */
+  static bool isSelfNonEscaping(FunctionDefn * fn);
+
+  /** Return true if the function 'fn' never retains its variadic argument array
+      beyond the duration of the call. For a virtual call, 'isVirtual' should be
+      true, in which case the result is always false, since an override might
+      retain the array even if 'fn' is declared 'NoEscape'. */
+  static bool isVarArgsNonEscaping(FunctionDefn * fn, bool isVirtual);
+
+  Expr * visitExpr(Expr * in);
+  Expr * visitInitVar(InitVarExpr * in);
+  Expr * visitLValue(LValueExpr * in);
+  Expr * visitAssign(AssignmentExpr * in);
+  Expr * visitFnCall(FnCallExpr * in);
+  Expr * visitRefEq(BinaryExpr * in);
+  Expr * visitYield(ReturnExpr * in);
+  Expr * visitClosureScope(ClosureEnvExpr * in);
+
+private:
+  const ValueDefn * value_;
+  llvm::SmallPtrSet<const ValueDefn *, 4> aliases_;
+  bool escapes_;
+
+  EscapeAnalysisPass(const ValueDefn * value)
+    : value_(value)
+    , escapes_(false)
+  {}
+
+  /** Return true if 'value' escapes anywhere within the body of 'fn'. */
+  static bool escapes(FunctionDefn * fn, const ValueDefn * value);
+
+  /** Return true if 'value' is the value being tracked, or an alias of it. */
+  bool isTracked(const ValueDefn * value) const {
+    return value == value_ || aliases_.count(value) != 0;
+  }
+
+  /** Return true if 'in' is a reference to the value being tracked. */
+  bool isValueRef(const Expr * in) const;
+};
+
+} // namespace tart
+
+#endif
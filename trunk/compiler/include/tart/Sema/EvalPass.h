@@ -10,6 +10,7 @@
 #endif
 
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
 
 namespace tart {
 
@@ -34,6 +35,12 @@ public:
     */
   static Expr * eval(Module * module, Expr * in, bool allowPartial = false);
 
+  /** Attempt to evaluate the initializer of a static variable at compile time. Returns
+      a constant expression (which may be a graph of constant objects) if the
+      initializer is pure and deterministic, or NULL if it must be run at startup.
+      No errors are reported if evaluation fails. */
+  static Expr * evalStaticInitializer(Module * module, Expr * in);
+
 private:
   enum RunState {
     RUNNING,
@@ -98,11 +105,15 @@ private:
   Module * module_;
   bool allowPartial_;
   CallFrame * callFrame_;
+  unsigned steps_;
+  unsigned callDepth_;
 
   EvalPass(Module * module, bool allowPartial)
     : module_(module)
     , allowPartial_(allowPartial)
     , callFrame_(NULL)
+    , steps_(0)
+    , callDepth_(0)
   {}
 
   Expr * evalExpr(Expr * in);
@@ -120,10 +131,19 @@ private:
   Expr * evalSeq(SeqExpr * in);
   Expr * evalReturn(ReturnExpr * in);
 
+  /** Return true if 'in' is a fully-initialized constant value. */
+  static bool isCompleteConstant(Expr * in, llvm::SmallPtrSet<Expr *, 16> & visited);
+
+  /** Report that an expression could not be evaluated. Returns NULL so that it can
+      be used as a return value. */
+  Expr * cannotEval(Expr * in, const char * msg);
+
   llvm::Constant * asConstNumber(ConstantExpr * e);
   BooleanResult asConstBoolean(Expr * in);
 
-  void store(Expr * value, Expr * dest);
+  /** Store a value into 'dest'. Returns false if the store could not be done at
+      compile time. */
+  bool store(Expr * value, Expr * dest);
 
   /** Set the current call frame, and return the previous frame. */
   CallFrame * setCallFrame(CallFrame * newFrame) {
@@ -13,6 +13,7 @@ namespace tart {
 
 class LValueExpr;
 class CallExpr;
+class FnCallExpr;
 class SpecializeExpr;
 class Stmt;
 class BlockStmt;
@@ -21,6 +22,7 @@ class WhileStmt;
 class DoWhileStmt;
 class ForStmt;
 class ForEachStmt;
+class ForEachExpr;
 class SwitchStmt;
 class MatchStmt;
 class MatchAsStmt;
@@ -223,6 +225,10 @@ public:
 
   // Type conversions
 
+  /** Return true if 'call' is a call to 'Array.of' with its arguments already packed
+      into an array literal. */
+  static bool isArrayOfCall(const FnCallExpr * call);
+
   /** Given a type, return the coercion function to convert it to a reference type. */
   FunctionDefn * coerceToObjectFn(const Type * type);
 
@@ -278,6 +284,16 @@ private:
       in the interface, and then find the overloaded version of that method in the concrete type. */
   FunctionDefn * findInterfaceMethod(const CompositeType * type, const Type * interface,
       const char * method);
+
+  /** Set up 'foreach' to step through the elements of 'collection' by index, if it is
+      an array or array list. Returns false if it isn't. */
+  bool reduceIndexedLoop(ForEachExpr * foreach, Expr * collection,
+      Expr *& iterValue, const Type *& iterVarType);
+
+  /** Set up 'foreach' to call the 'next' method of 'iteratorExpr', or of the iterator
+      returned by its 'iterate' method. Returns false if there was an error. */
+  bool reduceIteratorLoop(ForEachExpr * foreach, Expr * iteratorExpr,
+      Expr *& iterValue, const Type *& iterVarType);
 };
 
 } // namespace tart
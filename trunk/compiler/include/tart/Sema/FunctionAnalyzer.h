@@ -34,6 +34,7 @@ public:
   bool resolveModifiers();
   bool createCFG();
   bool merge();
+  bool analyzeEscapes();
   bool createReflectionData();
   bool analyzeRecursive(AnalysisTask task, FunctionDefn::AnalysisPass pass);
   void visitClosureEnvs(const ExprList & closureEnvs);
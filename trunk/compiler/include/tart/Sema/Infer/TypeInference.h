@@ -28,6 +28,12 @@ public:
   static Expr * run(Module * module, Expr * in, BindingEnv & env, QualifiedType expected,
       bool strict = true);
 
+  /** The maximum number of overload choices that will be tried when searching for a
+      solution by elimination. When the limit is reached, the search stops and a warning
+      is issued. */
+  static unsigned searchLimit();
+  static void setSearchLimit(unsigned limit);
+
 private:
   enum ReportLabel {
     INITIAL,
@@ -46,6 +52,8 @@ private:
   int bestSolutionCount_;
   int cullCount_;
   int searchDepth_;
+  unsigned searchCount_;
+  bool searchLimitExceeded_;
   bool underconstrained_;
   bool overconstrained_;
   bool strict_;
@@ -57,6 +65,8 @@ private:
     , env_(env)
     , expectedType_(expected)
     , searchDepth_(0)
+    , searchCount_(0)
+    , searchLimitExceeded_(false)
     , strict_(strict)
   {}
 
@@ -95,11 +105,20 @@ private:
   void cullBySpecificity();
   void cullBySpecificity(CallSite * site);
 
-  /** Try removing each from consideration and re-evaluate all conversion
-      ranks for the entire AST. Choose the one with the best rank. */
+  /** Search for the best solution by choosing a single candidate at each site in turn.
+      Each choice is followed by constraint propagation, so that branches which cannot
+      lead to a solution are abandoned early. */
   void cullByElimination();
-  void cullByElimination(CallSites::iterator first, CallSites::iterator last);
-  void cullByElimination(CallSite * site);
+  void searchByElimination();
+
+  /** Remove candidates that are incompatible with the choices made so far, repeating
+      until no more can be removed. Returns false if some site has no viable candidates
+      left, meaning that the current set of choices has no solution. */
+  bool propagate();
+
+  /** Return the undecided call site with the fewest remaining candidates, or NULL if
+      every site has been decided. */
+  CallSite * selectSite();
 
   // Undo the last pruning
   void backtrack();
@@ -36,6 +36,11 @@ public:
   bool isInvocable() const { return isInvocable_; }
   void setIsInvocable(bool value) { isInvocable_ = value; }
 
+  /** True if functions of this type are defined outside of Tart, and so must return
+      values the way the platform's C compiler does. */
+  bool isExtern() const { return isExtern_; }
+  void setIsExtern(bool value) { isExtern_ = value; }
+
   // Return type
   QualifiedType returnType() const { return returnType_; }
   void setReturnType(QualifiedType type) { returnType_ = type; }
@@ -43,6 +48,11 @@ public:
   /** True if this function type uses 'struct return' calling convention. */
   bool isStructReturn() const;
 
+  /** True if the return type is a large value type which is nonetheless small enough
+      to be returned in registers, as a first-class aggregate. This includes unions
+      such as 'char or void', which are returned as a (discriminator, value) pair. */
+  bool isRegisterReturn() const;
+
   llvm::Type * irType() const;
 
   // Parameter methods
@@ -99,6 +109,7 @@ public:
 
 private:
   bool isStatic_;
+  bool isExtern_;
   QualifiedType returnType_;
   ParameterDefn * selfParam_;
   ParameterList params_;
@@ -106,6 +117,7 @@ private:
   mutable llvm::Type * irType_;
   mutable bool isCreatingType;
   mutable bool isStructReturn_;
+  mutable bool isRegisterReturn_;
   mutable bool isInvocable_;
   mutable llvm::SmallString<0> invokeName_;
 };
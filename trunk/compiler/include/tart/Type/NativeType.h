@@ -141,6 +141,7 @@ public:
   llvm::Type * createIRType() const;
   bool isSingular() const;
   bool isReferenceType() const { return false; }
+  bool containsReferenceType() const;
   void format(FormatStream & out) const;
   void trace() const;
 
@@ -0,0 +1,58 @@
+/* ================================================================ *
+    TART - A Sweet Programming Language.
+ * ================================================================ */
+
+#ifndef TART_TYPE_TYPEQUERYCACHE_H
+#define TART_TYPE_TYPEQUERYCACHE_H
+
+#ifndef TART_TYPE_TYPE_H
+#include "tart/Type/Type.h"
+#endif
+
+namespace tart {
+
+/// -------------------------------------------------------------------
+/// Memo table for the results of type conversion and type relation
+/// queries.
+///
+/// Only queries between 'closed' types are cached: primitive, enum and
+/// composite types whose analysis has progressed far enough that the
+/// answer can no longer change. Type variables, type assignments,
+/// ambiguous types and compound types which might contain any of
+/// these are never cached, so binding or unbinding a type variable
+/// during inference can't invalidate an entry.
+///
+/// The table is cleared at every garbage collection, since the types
+/// it refers to may be reclaimed.
+namespace TypeQueryCache {
+
+  /** The kind of query whose result is being cached. */
+  enum QueryKind {
+    Convert,
+    IsEqual,
+    IsSubtype,
+    IsSubclass,
+  };
+
+  /** Returns true if the result of a query of the given kind between 'src'
+      and 'dst' can be cached. */
+  bool isCacheable(QueryKind kind, const QualifiedType & src, const QualifiedType & dst);
+
+  /** Look up a cached result. Returns true and sets 'result' if found. */
+  bool lookup(QueryKind kind, const QualifiedType & src, const QualifiedType & dst,
+      int options, int & result);
+
+  /** Add a result to the cache. */
+  void insert(QueryKind kind, const QualifiedType & src, const QualifiedType & dst,
+      int options, int result);
+
+  /** Discard all cached results. */
+  void clear();
+
+  /** Return the number of cached results. */
+  unsigned size();
+}
+
+} // namespace tart
+
+#endif // TART_TYPE_TYPEQUERYCACHE_H
@@ -57,9 +57,16 @@ public:
   size_t hasNullType() const { return hasNullType_; }
 
   /** Return true if this union contains only reference types. (Including Null). This means
-      that the type can be represented as a single pointer with no discriminator field. */
+      that the type can be represented as a single pointer with no discriminator field.
+      A union that includes void always has a discriminator, since null is a valid value
+      of its reference members and can't also stand for void. */
   bool hasRefTypesOnly() const;
 
+  /** Return true if this union contains one or more reference types and void, and no
+      value types. The discriminator then only has to tell void apart from a reference,
+      so the collector can trace it without a trace method. */
+  bool isRefOrVoidType() const;
+
   /** Return true if this type is a union of a single type with either null or void.
       (Null if it's a reference type, void if it's a value type.) The 'optional' keyword
       creates unions of this type.
@@ -3,8 +3,11 @@
  * ================================================================ */
 
 #include "tart/Common/Compiler.h"
+#include "tart/Common/CompilerStats.h"
+#include "tart/Common/GC.h"
 #include "tart/Common/SourceFile.h"
 #include "tart/Common/PackageMgr.h"
+#include "tart/Common/TemplateRepository.h"
 
 #include "tart/Defn/Module.h"
 
@@ -110,13 +113,22 @@ void AbstractCompiler::processInputFile(StringRef inFile) {
     mod = new Module(moduleName, &Builtins::module);
     mod->setModuleSource(&src);
     Parser parser(&src, mod);
-    if (parser.parse()) {
+    bool parsed;
+    {
+      // The module's AST is allocated in its own arena.
+      PhaseScope scope(Phase::Parse);
+      GCArenaScope arena;
+      parsed = parser.parse();
+    }
+
+    if (parsed) {
       ScopeBuilder::createScopeMembers(mod);
       mod->findPrimaryDefn();
       PackageMgr::get().addModule(mod);
     }
   }
 
+  TemplateRepository::get().beginModule(mod);
   if (diag.getErrorCount() == 0) {
     AnalyzerBase::analyzeModule(mod);
   }
@@ -125,11 +137,25 @@ void AbstractCompiler::processInputFile(StringRef inFile) {
     generate(mod);
   }
 
+  llvm::SmallVector<std::string, 8> staleModules;
+  if (diag.getErrorCount() == 0) {
+    TemplateRepository::get().endModule(mod, staleModules);
+  }
+
   mod->trace();
 //  Builtins::module.trace();
 //  Builtins::syntheticModule.trace();
 //  PackageMgr::get().trace();
   GC::sweep();
+
+  // Modules that imported template instances which this module no longer
+  // generates only declare them, and have to be compiled again so that one of
+  // them takes them over. The build system doesn't know about that dependency,
+  // so remove their output to make it rebuild them.
+  for (llvm::SmallVectorImpl<std::string>::iterator it = staleModules.begin();
+      it != staleModules.end(); ++it) {
+    invalidate(*it);
+  }
 }
 
 }
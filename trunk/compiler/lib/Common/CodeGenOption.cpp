@@ -0,0 +1,51 @@
+/* ================================================================ *
+    TART - A Sweet Programming Language.
+ * ================================================================ */
+
+#include "tart/Common/CodeGenOption.h"
+
+#include "llvm/ADT/StringExtras.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace tart {
+
+CodeGenOptionBase * CodeGenOptionBase::first_ = NULL;
+
+CodeGenOptionBase::CodeGenOptionBase()
+  : next_(first_)
+{
+  first_ = this;
+}
+
+void CodeGenOptionBase::describeAll(std::string & out) {
+  // The order of registration depends on the order of static initialization,
+  // so sort the options to keep the description the same from one build to the next.
+  std::vector<std::string> descriptions;
+  for (CodeGenOptionBase * opt = first_; opt != NULL; opt = opt->next_) {
+    descriptions.push_back(std::string());
+    opt->describe(descriptions.back());
+  }
+
+  std::sort(descriptions.begin(), descriptions.end());
+  for (std::vector<std::string>::const_iterator it = descriptions.begin();
+      it != descriptions.end(); ++it) {
+    out += *it;
+    out += ' ';
+  }
+}
+
+void CodeGenOptionBase::describeValue(std::string & out, bool value) {
+  out += value ? "1" : "0";
+}
+
+void CodeGenOptionBase::describeValue(std::string & out, unsigned value) {
+  out += llvm::utostr(value);
+}
+
+void CodeGenOptionBase::describeValue(std::string & out, const std::string & value) {
+  out += value;
+}
+
+} // namespace tart
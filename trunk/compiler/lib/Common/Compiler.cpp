@@ -3,13 +3,31 @@
  * ================================================================ */
 
 #include "tart/Common/Compiler.h"
+#include "tart/Common/CompilerStats.h"
 #include "tart/Gen/CodeGenerator.h"
 
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/system_error.h"
+
 namespace tart {
 
 void Compiler::generate(Module * mod) {
+  PhaseScope scope(Phase::CodeGen);
   CodeGenerator codeGen(mod);
   codeGen.generate();
 }
 
+void Compiler::invalidate(StringRef moduleName) {
+  // Removing the bitcode file makes the build compile the module again.
+  std::string binPath = CodeGenerator::outputPath(moduleName);
+  bool existed;
+  if (llvm::error_code ec = llvm::sys::fs::remove(binPath, existed)) {
+    diag.error() << "Cannot remove '" << binPath << "', the output of module '" <<
+        moduleName << "', which must be compiled again: " << ec.message();
+  } else if (existed) {
+    diag.info() << "Removed '" << binPath << "'; module '" << moduleName <<
+        "' must be compiled again.";
+  }
+}
+
 }
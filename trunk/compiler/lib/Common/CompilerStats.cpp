@@ -0,0 +1,204 @@
+/* ================================================================ *
+    TART - A Sweet Programming Language.
+ * ================================================================ */
+
+#include "tart/Common/CompilerStats.h"
+
+#include "llvm/Support/Format.h"
+#include "llvm/Support/TimeValue.h"
+#include "llvm/Support/raw_ostream.h"
+
+namespace tart {
+
+using llvm::format;
+using llvm::raw_ostream;
+
+namespace {
+  /** Return the current wall clock time in microseconds. */
+  uint64_t now() {
+    llvm::sys::TimeValue time = llvm::sys::TimeValue::now();
+    return uint64_t(time.seconds()) * 1000000 + time.microseconds();
+  }
+
+  double toSeconds(uint64_t micros) {
+    return double(micros) / 1000000.0;
+  }
+}
+
+// -------------------------------------------------------------------
+// PhaseTimer
+
+PhaseTimer * PhaseTimer::first_ = NULL;
+PhaseTimer * PhaseTimer::last_ = NULL;
+bool PhaseTimer::enabled_ = false;
+
+PhaseTimer::PhaseTimer(const char * name, const char * desc, PhaseTimer * parent)
+  : name_(name)
+  , desc_(desc)
+  , parent_(parent)
+  , next_(NULL)
+  , totalTime_(0)
+  , selfTime_(0)
+  , entryTime_(0)
+  , count_(0)
+  , depth_(0)
+{
+  // Keep the phases in the order they were declared.
+  if (last_ != NULL) {
+    last_->next_ = this;
+  } else {
+    first_ = this;
+  }
+  last_ = this;
+}
+
+void PhaseTimer::print(raw_ostream & out) {
+  out << "===---- Compiler phase times ----===\n";
+  out << "   Total (s)    Self (s)    Count  Phase\n";
+  printChildren(out, NULL, 0);
+}
+
+void PhaseTimer::printChildren(raw_ostream & out, PhaseTimer * parent, unsigned indent) {
+  for (PhaseTimer * t = first_; t != NULL; t = t->next_) {
+    if (t->parent_ == parent && t->count_ > 0) {
+      out << format("  %10.4f  %10.4f  %7u  ", toSeconds(t->totalTime_),
+          toSeconds(t->selfTime_), t->count_);
+      out.indent(indent) << t->desc_ << "\n";
+      printChildren(out, t, indent + 2);
+    }
+  }
+}
+
+void PhaseTimer::printJson(raw_ostream & out) {
+  out << "[";
+  bool first = true;
+  for (PhaseTimer * t = first_; t != NULL; t = t->next_) {
+    if (!first) {
+      out << ",";
+    }
+    first = false;
+    out << "\n    {\"name\": \"" << t->name_ << "\", ";
+    if (t->parent_ != NULL) {
+      out << "\"parent\": \"" << t->parent_->name_ << "\", ";
+    }
+    out << "\"total_us\": " << t->totalTime_ << ", \"self_us\": " << t->selfTime_ <<
+        ", \"count\": " << t->count_ << "}";
+  }
+  out << "\n  ]";
+}
+
+// -------------------------------------------------------------------
+// PhaseScope
+
+PhaseScope * PhaseScope::current_ = NULL;
+
+PhaseScope::PhaseScope(PhaseTimer & timer) : timer_(NULL), outer_(NULL), resumeTime_(0) {
+  if (!PhaseTimer::enabled_) {
+    return;
+  }
+
+  uint64_t time = now();
+  timer_ = &timer;
+  outer_ = current_;
+  current_ = this;
+  resumeTime_ = time;
+
+  // Stop charging time to the enclosing phase.
+  if (outer_ != NULL) {
+    outer_->timer_->selfTime_ += time - outer_->resumeTime_;
+  }
+
+  if (timer_->depth_++ == 0) {
+    timer_->entryTime_ = time;
+    ++timer_->count_;
+  }
+}
+
+PhaseScope::~PhaseScope() {
+  if (timer_ == NULL) {
+    return;
+  }
+
+  uint64_t time = now();
+  timer_->selfTime_ += time - resumeTime_;
+  if (--timer_->depth_ == 0) {
+    timer_->totalTime_ += time - timer_->entryTime_;
+  }
+
+  current_ = outer_;
+  if (outer_ != NULL) {
+    outer_->resumeTime_ = time;
+  }
+}
+
+// -------------------------------------------------------------------
+// StatCounter
+
+StatCounter * StatCounter::first_ = NULL;
+
+StatCounter::StatCounter(const char * name, const char * desc)
+  : name_(name)
+  , desc_(desc)
+  , value_(0)
+  , next_(first_)
+{
+  first_ = this;
+}
+
+StatCounter * StatCounter::find(llvm::StringRef name) {
+  for (StatCounter * c = first_; c != NULL; c = c->next_) {
+    if (name == c->name_) {
+      return c;
+    }
+  }
+
+  return NULL;
+}
+
+void StatCounter::print(raw_ostream & out) {
+  out << "===---- Compiler statistics ----===\n";
+  for (StatCounter * c = first_; c != NULL; c = c->next_) {
+    if (c->value_ != 0) {
+      out << format("  %10llu  ", (unsigned long long) c->value_) << c->desc_ << "\n";
+    }
+  }
+}
+
+void StatCounter::printJson(raw_ostream & out) {
+  out << "{";
+  bool first = true;
+  for (StatCounter * c = first_; c != NULL; c = c->next_) {
+    if (!first) {
+      out << ",";
+    }
+    first = false;
+    out << "\n    \"" << c->name_ << "\": " << c->value_;
+  }
+  out << "\n  }";
+}
+
+void printStatsJson(raw_ostream & out) {
+  out << "{\n  \"phases\": ";
+  PhaseTimer::printJson(out);
+  out << ",\n  \"counters\": ";
+  StatCounter::printJson(out);
+  out << "\n}\n";
+}
+
+// -------------------------------------------------------------------
+// Phases
+
+namespace Phase {
+  PhaseTimer Compile("compile", "Total");
+  PhaseTimer Parse("parse", "Parsing", &Compile);
+  PhaseTimer ScopeBuild("scope-build", "Building scopes", &Compile);
+  PhaseTimer Analyze("analyze", "Analysis", &Compile);
+  PhaseTimer TypeInference("type-inference", "Type inference", &Analyze);
+  PhaseTimer Eval("eval", "Constant evaluation", &Analyze);
+  PhaseTimer CodeGen("codegen", "Code generation", &Compile);
+  PhaseTimer Verify("verify", "Verifying module", &CodeGen);
+  PhaseTimer Output("output", "Writing bitcode", &CodeGen);
+  PhaseTimer GCSweep("gc-sweep", "Garbage collection", &Compile);
+}
+
+} // namespace tart
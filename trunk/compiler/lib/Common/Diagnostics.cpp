@@ -39,6 +39,15 @@ namespace {
 
   static const char * INDENTATION = "                                ";
   static int MAX_INDENT = 16;
+
+  typedef llvm::SmallVector<const llvm::cl::Option *, 8> OptionList;
+
+  /** The options marked as DebugOptions. A function, so that the list is constructed
+      before the static DebugOption objects that add to it. */
+  OptionList & debugOptions() {
+    static OptionList options;
+    return options;
+  }
 }
 
 Diagnostics diag;
@@ -333,6 +342,20 @@ void Diagnostics::StringWriter::write(const SourceLocation & loc, Severity sev,
   strm.flush();
 }
 
+Diagnostics::DebugOption::DebugOption(const llvm::cl::Option & option) {
+  debugOptions().push_back(&option);
+}
+
+bool Diagnostics::DebugOption::anyGiven() {
+  for (OptionList::const_iterator it = debugOptions().begin(); it != debugOptions().end(); ++it) {
+    if ((*it)->getNumOccurrences() > 0) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
 Diagnostics::FailStream::~FailStream() {
   flush();
   diag.__fail(str(), fname_, lineno_);
@@ -4,6 +4,7 @@
 
 #include "config.h"
 #include "tart/Common/GC.h"
+#include "tart/Common/CompilerStats.h"
 #include "tart/Common/Diagnostics.h"
 #include "tart/Common/SourceLocation.h"
 
@@ -16,6 +17,7 @@
 #endif
 
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/DataTypes.h"
 
 #define GC_DEBUG 0
 
@@ -29,12 +31,200 @@ namespace {
 
 static bool initialized = false;
 
+static StatCounter numSweeps("gc-sweeps", "Garbage collection cycles");
+static StatCounter numReclaimed("gc-reclaimed", "Objects reclaimed by garbage collection");
+static StatCounter numArenaObjects("gc-arena-objects", "Objects allocated from arenas");
+static StatCounter numArenasReleased("gc-arenas-released", "Arenas released");
+static StatCounter numChunksReleased("gc-arena-chunks-released", "Arena chunks released");
+
+// -------------------------------------------------------------------
+// GCArena
+
+/// A region from which GC objects are bump-allocated. Memory is obtained in
+/// chunks; each object in a chunk is preceded by a header giving its size,
+/// so that the sweep can walk the objects in order. Chunks start small and
+/// double in size, so that an arena which is only lightly used doesn't cost
+/// much, and a chunk is freed as soon as none of its objects are live.
+class GCArena {
+public:
+  GCArena()
+    : chunks_(NULL)
+    , ptr_(NULL)
+    , end_(NULL)
+    , nextChunkSize_(MIN_CHUNK_SIZE)
+    , next_(NULL)
+    , outer_(NULL)
+  {}
+  ~GCArena();
+
+  /** Allocate 'size' bytes from this arena. */
+  void * allocate(size_t size);
+
+  /** True if nothing has been allocated from this arena. */
+  bool empty() const { return chunks_ == NULL; }
+
+  /** Destroy every object in the arena which was not marked in the current cycle,
+      and free the chunks that no longer hold any live objects. Returns true if
+      there are no live objects left. */
+  bool sweep(size_t & total, size_t & reclaimed);
+
+  /** Next arena in the list of closed arenas. */
+  GCArena * next_;
+
+  /** The arena that was current when this one was opened. */
+  GCArena * outer_;
+
+private:
+  enum {
+    MIN_CHUNK_SIZE = 4 * 1024,
+    MAX_CHUNK_SIZE = 64 * 1024,
+    ALIGNMENT = 8,
+  };
+
+  struct Chunk {
+    Chunk * next;
+    char * top;         // End of the allocated objects in this chunk.
+  };
+
+  struct Header {
+    uint32_t size;      // Size of the header plus the object.
+    uint32_t dead;      // True if the object has already been destroyed.
+  };
+
+  Chunk * chunks_;      // Most recently allocated chunk first.
+  char * ptr_;          // Next free byte in the first chunk.
+  char * end_;          // End of the first chunk.
+  size_t nextChunkSize_;
+
+  void newChunk(size_t minSize);
+};
+
+GCArena::~GCArena() {
+  while (Chunk * chunk = chunks_) {
+    chunks_ = chunk->next;
+    free(chunk);
+  }
+}
+
+void * GCArena::allocate(size_t size) {
+  size_t needed = sizeof(Header) + ((size + ALIGNMENT - 1) & ~size_t(ALIGNMENT - 1));
+  if (size_t(end_ - ptr_) < needed) {
+    newChunk(needed);
+  }
+
+  Header * header = reinterpret_cast<Header *>(ptr_);
+  header->size = uint32_t(needed);
+  header->dead = false;
+  ptr_ += needed;
+  return header + 1;
+}
+
+void GCArena::newChunk(size_t minSize) {
+  size_t size = sizeof(Chunk) + minSize;
+  if (size < nextChunkSize_) {
+    size = nextChunkSize_;
+  }
+
+  if (nextChunkSize_ < MAX_CHUNK_SIZE) {
+    nextChunkSize_ *= 2;
+  }
+
+  if (chunks_ != NULL && ptr_ != NULL) {
+    chunks_->top = ptr_;
+  }
+
+  Chunk * chunk = reinterpret_cast<Chunk *>(malloc(size));
+  chunk->next = chunks_;
+  chunk->top = NULL;
+  chunks_ = chunk;
+  ptr_ = reinterpret_cast<char *>(chunk + 1);
+  end_ = reinterpret_cast<char *>(chunk) + size;
+}
+
+bool GCArena::sweep(size_t & total, size_t & reclaimed) {
+  // Only closed arenas are swept, so no more objects will be allocated from the
+  // first chunk; record its extent like any other.
+  if (chunks_ != NULL) {
+    chunks_->top = ptr_;
+    ptr_ = end_ = NULL;
+  }
+
+  bool live = false;
+  Chunk ** chunkPtr = &chunks_;
+  while (Chunk * chunk = *chunkPtr) {
+    bool chunkLive = false;
+    for (char * p = reinterpret_cast<char *>(chunk + 1); p < chunk->top;) {
+      Header * header = reinterpret_cast<Header *>(p);
+      p += header->size;
+      if (header->dead) {
+        continue;
+      }
+
+      GC * gc = reinterpret_cast<GC *>(header + 1);
+      ++total;
+      if (gc->cycle_ == GC::cycleIndex_) {
+        chunkLive = true;
+      } else {
+        ++reclaimed;
+        gc->~GC();
+        header->dead = true;
+        #if GC_DEBUG
+          memset(gc, 0xDF, header->size - sizeof(Header));
+        #endif
+      }
+    }
+
+    if (chunkLive) {
+      live = true;
+      chunkPtr = &chunk->next;
+    } else {
+      // Objects which escape the analysis only keep their own chunk alive.
+      *chunkPtr = chunk->next;
+      free(chunk);
+      ++numChunksReleased;
+    }
+  }
+
+  return !live;
+}
+
+// -------------------------------------------------------------------
+// GCArenaScope
+
+GCArenaScope::GCArenaScope(Sharing sharing) : arena_(NULL) {
+  if (sharing == ShareEnclosing && GC::currentArena_ != NULL) {
+    return;
+  }
+
+  arena_ = new GCArena();
+  arena_->outer_ = GC::currentArena_;
+  GC::currentArena_ = arena_;
+}
+
+GCArenaScope::~GCArenaScope() {
+  if (arena_ == NULL) {
+    return;
+  }
+
+  DASSERT(GC::currentArena_ == arena_);
+  GC::currentArena_ = arena_->outer_;
+  if (arena_->empty()) {
+    delete arena_;
+  } else {
+    arena_->next_ = GC::arenas_;
+    GC::arenas_ = arena_;
+  }
+}
+
 // -------------------------------------------------------------------
 // GC
 
 GC * GC::allocList_ = NULL;
+GCArena * GC::arenas_ = NULL;
+GCArena * GC::currentArena_ = NULL;
 GCRootBase * GC::roots_ = NULL;
 GC::CallbackList GC::uninitCallbacks_;
+GC::CallbackList GC::sweepCallbacks_;
 GC::WeakPtrList GC::weakPtrs_;
 GC::ObjectList GC::toTrace_;
 
@@ -42,6 +232,14 @@ unsigned char GC::cycleIndex_ = 0;
 
 void * GC::operator new(size_t size) {
   DASSERT(initialized);
+  if (currentArena_ != NULL) {
+    ++numArenaObjects;
+    GC * gc = reinterpret_cast<GC *>(currentArena_->allocate(size));
+    gc->next_ = NULL;
+    gc->cycle_ = cycleIndex_;
+    return gc;
+  }
+
   GC * gc = reinterpret_cast<GC *>(malloc(size));
   #if GC_DEBUG
     memset(gc, 0xDB, size);
@@ -74,10 +272,20 @@ void GC::registerUninitCallback(Callback * cb) {
   uninitCallbacks_.push_back(cb);
 }
 
+void GC::registerSweepCallback(Callback * cb) {
+  sweepCallbacks_.push_back(cb);
+}
+
 void GC::sweep() {
+  PhaseScope scope(Phase::GCSweep);
+  ++numSweeps;
   reclaimed = 0;
   total = 0;
 
+  for (CallbackList::iterator it = sweepCallbacks_.begin(); it != sweepCallbacks_.end(); ++it) {
+    (*it)->call();
+  }
+
   // Increment the collection cycle index
   ++cycleIndex_;
 
@@ -107,9 +315,11 @@ void GC::sweep() {
   // Delete any allocated object not marked.
   GC ** ptr = &allocList_;
   while (GC * gc = *ptr) {
+    ++total;
     if (gc->cycle_ == cycleIndex_) {
       ptr = &gc->next_;
     } else {
+      ++reclaimed;
       *ptr = gc->next_;
       gc->~GC();
       #if GC_DEBUG
@@ -120,6 +330,20 @@ void GC::sweep() {
     }
   }
 
+  // Sweep the closed arenas, releasing those with no live objects. Arenas
+  // which are still open may hold objects that are not yet reachable.
+  GCArena ** arenaPtr = &arenas_;
+  while (GCArena * arena = *arenaPtr) {
+    if (arena->sweep(total, reclaimed)) {
+      *arenaPtr = arena->next_;
+      delete arena;
+      ++numArenasReleased;
+    } else {
+      arenaPtr = &arena->next_;
+    }
+  }
+
+  numReclaimed += reclaimed;
   if (debugLevel) {
     diag.info(SourceLocation()) << "GC: " << reclaimed <<
         " objects reclaimed, " << (total - reclaimed) << " in use";
@@ -0,0 +1,85 @@
+/* ================================================================ *
+    TART - A Sweet Programming Language.
+ * ================================================================ */
+
+#include "tart/Common/IdentTable.h"
+#include "tart/Common/CompilerStats.h"
+
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/Allocator.h"
+#include "llvm/Support/DataTypes.h"
+
+namespace tart {
+namespace IdentTable {
+
+namespace {
+  typedef llvm::StringMap<IdentInfo, llvm::BumpPtrAllocator> IdentMap;
+
+  /** The table is created on first use, since identifiers may be interned by
+      static constructors. */
+  IdentMap & idents() {
+    static IdentMap table;
+    return table;
+  }
+
+  // Recently used identifiers, indexed by the address of their text.
+  const unsigned RECENT_SIZE = 64;
+  const Ident * recent[RECENT_SIZE];
+
+  inline const Ident *& recentSlot(const char * text) {
+    return recent[(reinterpret_cast<uintptr_t>(text) >> 3) & (RECENT_SIZE - 1)];
+  }
+
+  StatCounter numIdentLookups("ident-lookups", "Identifier table lookups");
+  StatCounter numIdentHashes("ident-hashes", "Identifier table lookups which hashed the name");
+
+  /** Return true if 'str' is the text of 'ident' itself, rather than a copy. Since
+      the text of an identifier is never freed or changed, this means that they are
+      the same. */
+  inline bool isTextOf(StringRef str, const Ident * ident) {
+    return ident != NULL && str.data() == ident->getKeyData() &&
+        str.size() == ident->getKeyLength();
+  }
+}
+
+const Ident * get(StringRef str) {
+  ++numIdentLookups;
+  const Ident * cached = recentSlot(str.data());
+  if (isTextOf(str, cached)) {
+    return cached;
+  }
+
+  ++numIdentHashes;
+  Ident & ident = idents().GetOrCreateValue(str);
+  if (ident.getValue().id == 0) {
+    ident.getValue().id = idents().size();
+    ident.getValue().hash = llvm::HashString(str);
+  }
+
+  recentSlot(ident.getKeyData()) = &ident;
+  return &ident;
+}
+
+const Ident * find(StringRef str) {
+  ++numIdentLookups;
+  const Ident * cached = recentSlot(str.data());
+  if (isTextOf(str, cached)) {
+    return cached;
+  }
+
+  ++numIdentHashes;
+  IdentMap::const_iterator it = idents().find(str);
+  if (it == idents().end()) {
+    return NULL;
+  }
+
+  recentSlot(it->getKeyData()) = &*it;
+  return &*it;
+}
+
+unsigned count() {
+  return idents().size();
+}
+
+}
+}
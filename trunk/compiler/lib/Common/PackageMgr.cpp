@@ -5,6 +5,8 @@
 #include "config.h"
 
 #include "tart/Common/PackageMgr.h"
+#include "tart/Common/CompilerStats.h"
+#include "tart/Common/GC.h"
 #include "tart/Common/SourceFile.h"
 #include "tart/Common/Diagnostics.h"
 
@@ -40,6 +42,7 @@ PackageMgr PackageMgr::instance_;
 
 static cl::opt<bool>
 ShowImports("show-imports", cl::desc("Display imports"));
+static Diagnostics::DebugOption ShowImportsDebug(ShowImports);
 
 namespace {
   llvm::sys::TimeValue filetime(StringRef path) {
@@ -90,9 +93,9 @@ bool DirectoryImporter::load(StringRef qualName, Module *& module) {
     if (module == NULL) {
       module = new Module(qualName, &Builtins::module);
     } else if (module->timestamp() > timestamp) {
-      diag.debug() << "Import: Module '" << qualName << "' exists, and is newer than timestamp";
+      DDEBUG() << "Import: Module '" << qualName << "' exists, and is newer than timestamp";
     } else {
-      diag.debug() << "Import: Module '" << qualName << "' exists, and is older than timestamp";
+      DDEBUG() << "Import: Module '" << qualName << "' exists, and is older than timestamp";
     }
 
     module->setModuleSource(new SourceFile(filepath));
@@ -100,6 +103,8 @@ bool DirectoryImporter::load(StringRef qualName, Module *& module) {
       diag.debug() << "Import: Found source module '" << qualName << "' at " << filepath;
     }
 
+    PhaseScope scope(Phase::Parse);
+    GCArenaScope arena;
     Parser parser(module->moduleSource(), module);
     if (parser.parse()) {
       return true;
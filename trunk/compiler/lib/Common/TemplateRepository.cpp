@@ -0,0 +1,324 @@
+/* ================================================================ *
+    TART - A Sweet Programming Language.
+ * ================================================================ */
+
+#include "config.h"
+
+#include "tart/Common/TemplateRepository.h"
+#include "tart/Common/Diagnostics.h"
+
+#include "tart/Defn/FunctionDefn.h"
+#include "tart/Defn/Module.h"
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/system_error.h"
+
+#include <fstream>
+#include <errno.h>
+
+#if HAVE_FCNTL_H
+#include <fcntl.h>
+#endif
+#if HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+namespace tart {
+
+using namespace llvm;
+
+static cl::opt<std::string>
+RepositoryPath("template-repo",
+    cl::desc("File which records which module owns each template instance method"),
+    cl::value_desc("filename"));
+
+/// -------------------------------------------------------------------
+/// An exclusive lock on the repository, held while it is read, merged
+/// and written back. Compiles of different modules in the same build
+/// run in parallel, and without the lock they would drop each other's
+/// entries. The lock is an fcntl lock on a separate '.lock' file, so it
+/// is released by the OS if the compiler dies while holding it.
+class RepositoryLock {
+public:
+  RepositoryLock(StringRef repoPath);
+  ~RepositoryLock();
+
+  /** True if the lock was acquired. */
+  bool isLocked() const { return locked_; }
+
+  /** The name of the lock file. */
+  StringRef path() const { return path_; }
+
+private:
+  SmallString<128> path_;
+  int fd_;
+  bool locked_;
+};
+
+RepositoryLock::RepositoryLock(StringRef repoPath)
+  : path_(repoPath)
+  , fd_(-1)
+  , locked_(false)
+{
+  path_ += ".lock";
+#if HAVE_FCNTL_H && HAVE_UNISTD_H
+  fd_ = ::open(path_.c_str(), O_RDWR | O_CREAT, 0666);
+  if (fd_ < 0) {
+    return;
+  }
+
+  struct flock fl;
+  fl.l_type = F_WRLCK;
+  fl.l_whence = SEEK_SET;
+  fl.l_start = 0;
+  fl.l_len = 0;
+  while (::fcntl(fd_, F_SETLKW, &fl) < 0) {
+    if (errno != EINTR) {
+      return;
+    }
+  }
+
+  locked_ = true;
+#else
+  // No file locking on this platform; modules sharing a repository must not be
+  // compiled in parallel.
+  locked_ = true;
+#endif
+}
+
+RepositoryLock::~RepositoryLock() {
+#if HAVE_FCNTL_H && HAVE_UNISTD_H
+  // Closing the file releases the lock.
+  if (fd_ >= 0) {
+    ::close(fd_);
+  }
+#endif
+}
+
+TemplateRepository TemplateRepository::instance_;
+
+bool TemplateRepository::isEnabled() const {
+  return !RepositoryPath.empty();
+}
+
+StringRef TemplateRepository::path() {
+  return RepositoryPath;
+}
+
+void TemplateRepository::setPath(StringRef path) {
+  RepositoryPath = path.str();
+}
+
+void TemplateRepository::beginModule(const Module * mod) {
+  module_ = mod;
+  released_.clear();
+  if (!isEnabled()) {
+    return;
+  }
+
+  if (!loaded_) {
+    read(entries_);
+    loaded_ = true;
+  }
+
+  // Release everything this module owned the last time it was compiled, but
+  // remember who imported it. Also forget what it imported, since it will
+  // claim those instances again if it still uses them.
+  std::string moduleName = mod->qualifiedName().str();
+  for (EntryMap::iterator it = entries_.begin(); it != entries_.end();) {
+    EntryMap::iterator entry = it++;
+    if (entry->second.owner == moduleName) {
+      released_[entry->first()].swap(entry->second.importers);
+      entries_.erase(entry);
+    } else {
+      entry->second.importers.erase(moduleName);
+    }
+  }
+}
+
+void TemplateRepository::endModule(const Module * mod,
+    SmallVectorImpl<std::string> & staleModules) {
+  DASSERT(module_ == mod);
+  module_ = NULL;
+  if (!isEnabled()) {
+    return;
+  }
+
+  // Another compiler process may have updated the repository since we read it,
+  // so merge our claims into the current contents of the file. Where two
+  // modules have claimed the same instance, the one already on disk wins;
+  // both will have emitted the body, and the linker keeps just one of them.
+  // The lock is held until the merged repository has been written back.
+  RepositoryLock lock(RepositoryPath);
+  if (!lock.isLocked()) {
+    diag.error() << "Cannot lock template repository '" << lock.path() << "'";
+    released_.clear();
+    return;
+  }
+
+  std::string moduleName = mod->qualifiedName().str();
+  EntryMap merged;
+  read(merged);
+  for (EntryMap::iterator it = merged.begin(); it != merged.end();) {
+    EntryMap::iterator entry = it++;
+    if (entry->second.owner == moduleName) {
+      merged.erase(entry);
+    } else {
+      entry->second.importers.erase(moduleName);
+    }
+  }
+
+  for (EntryMap::const_iterator it = entries_.begin(); it != entries_.end(); ++it) {
+    const Entry & entry = it->second;
+    EntryMap::iterator current = merged.find(it->first());
+    if (entry.owner == moduleName) {
+      if (current == merged.end()) {
+        merged[it->first()] = entry;
+      }
+    } else if (entry.importers.count(moduleName)) {
+      if (current != merged.end()) {
+        current->second.importers.insert(moduleName);
+      } else {
+        // The owner was recompiled by another process while this module was
+        // being compiled, and no longer generates the instance.
+        diag.error() << "Template instance '" << it->first() << "' imported by module '" <<
+            moduleName << "' is no longer generated by '" << entry.owner <<
+            "'; module '" << moduleName << "' must be compiled again.";
+      }
+    }
+  }
+
+  // Modules which imported an instance that this module no longer generates
+  // only have a declaration for it, unless some other module has claimed it
+  // in the meantime.
+  ModuleSet stale;
+  for (ImporterMap::const_iterator it = released_.begin(); it != released_.end(); ++it) {
+    if (merged.find(it->first()) == merged.end()) {
+      stale.insert(it->second.begin(), it->second.end());
+    }
+  }
+
+  released_.clear();
+  staleModules.append(stale.begin(), stale.end());
+
+  // Write to a temporary file and then rename it, so that a concurrent reader
+  // never sees a partially written repository.
+  SmallString<128> tempPath(RepositoryPath);
+  tempPath += ".tmp";
+  {
+    std::string errorInfo;
+    raw_fd_ostream out(tempPath.c_str(), errorInfo);
+    if (!errorInfo.empty()) {
+      diag.error() << "Cannot write template repository '" << tempPath.str() << "': " <<
+          errorInfo;
+      return;
+    }
+
+    for (EntryMap::const_iterator it = merged.begin(); it != merged.end(); ++it) {
+      out << it->second.owner << '\t' << it->first();
+      for (ModuleSet::const_iterator m = it->second.importers.begin();
+          m != it->second.importers.end(); ++m) {
+        out << '\t' << *m;
+      }
+
+      out << '\n';
+    }
+  }
+
+  if (error_code ec = sys::fs::rename(tempPath.str(), RepositoryPath)) {
+    diag.error() << "Cannot write template repository '" << RepositoryPath << "': " <<
+        ec.message();
+    return;
+  }
+
+  entries_.swap(merged);
+}
+
+bool TemplateRepository::claim(const Defn * de, const Module * mod) {
+  if (!isEnabled() || mod != module_ || !isShareable(de)) {
+    return true;
+  }
+
+  std::string moduleName = mod->qualifiedName().str();
+  EntryMap::iterator it = entries_.find(de->linkageName());
+  if (it != entries_.end()) {
+    if (it->second.owner == moduleName) {
+      return true;
+    }
+
+    it->second.importers.insert(moduleName);
+    return false;
+  }
+
+  // If this module owned the instance before, it keeps the same importers.
+  Entry & entry = entries_[de->linkageName()];
+  entry.owner = moduleName;
+  ImporterMap::iterator prev = released_.find(de->linkageName());
+  if (prev != released_.end()) {
+    entry.importers.swap(prev->second);
+    released_.erase(prev);
+  }
+
+  return true;
+}
+
+bool TemplateRepository::isOwner(const Defn * de, const Module * mod) const {
+  if (!isEnabled() || !isShareable(de)) {
+    return false;
+  }
+
+  EntryMap::const_iterator it = entries_.find(de->linkageName());
+  return it != entries_.end() && it->second.owner == mod->qualifiedName();
+}
+
+bool TemplateRepository::isShareable(const Defn * de) {
+  const FunctionDefn * fn = dyn_cast<FunctionDefn>(de);
+  if (fn == NULL || !fn->isSynthetic() || !fn->isSingular() || fn->isScaffold()) {
+    return false;
+  }
+
+  // Reflection metadata for a method is emitted alongside its body.
+  if (fn->isReflected()) {
+    return false;
+  }
+
+  if (fn->isIntrinsic() || fn->isUndefined() || fn->isAbstract() || fn->isInterfaceMethod() ||
+      !fn->hasBody()) {
+    return false;
+  }
+
+  // Nested functions are generated along with the function that contains them.
+  if (fn->parentDefn() != NULL && fn->parentDefn()->defnType() == Defn::Function) {
+    return false;
+  }
+
+  return true;
+}
+
+void TemplateRepository::read(EntryMap & entries) {
+  std::ifstream in(RepositoryPath.c_str());
+  if (!in) {
+    // The repository doesn't exist until the first module has been compiled.
+    return;
+  }
+
+  // Each line is the owning module, the linkage name of the instance, and the
+  // modules that import it, separated by tabs.
+  std::string line;
+  while (std::getline(in, line)) {
+    SmallVector<StringRef, 8> fields;
+    StringRef(line).split(fields, "\t");
+    if (fields.size() >= 2) {
+      Entry & entry = entries[fields[1]];
+      entry.owner = fields[0].str();
+      for (size_t i = 2; i < fields.size(); ++i) {
+        entry.importers.insert(fields[i].str());
+      }
+    }
+  }
+}
+
+} // namespace tart
@@ -9,8 +9,10 @@
 #include "tart/Sema/DefnAnalyzer.h"
 #include "tart/Sema/ScopeBuilder.h"
 
+#include "tart/Common/CodeGenOption.h"
 #include "tart/Common/Diagnostics.h"
 #include "tart/Common/PackageMgr.h"
+#include "tart/Common/TemplateRepository.h"
 
 #include "tart/Meta/MDReader.h"
 
@@ -20,8 +22,9 @@
 static llvm::cl::opt<std::string>
 DebugXDefs("debug-xdefs",
     llvm::cl::desc("Debug xdefs for module"), llvm::cl::value_desc("filename"));
+static tart::Diagnostics::DebugOption DebugXDefsDebug(DebugXDefs);
 
-llvm::cl::opt<bool>
+static tart::CodeGenOption<bool>
 NoReflect("noreflect", llvm::cl::desc("Don't generate reflection data"));
 
 namespace tart {
@@ -200,14 +203,8 @@ llvm::Module * Module::irModule() {
 bool Module::addSymbol(Defn * de) {
   if (passes_.isFinished(CompletionPass)) {
     // It's ok to add it if it was already added.
-    if (de->module() == this || de->isSynthetic()) {
-      if (exportDefs_.count(de)) {
-        return false;
-      }
-    } else {
-      if (importDefs_.count(de)) {
-        return false;
-      }
+    if (exportDefs_.count(de) || importDefs_.count(de)) {
+      return false;
     }
     diag.fatal(de) << Format_Verbose << "Too late to add symbol '" << de <<
         "', analysis for module '" << this << "' has already finished.";
@@ -218,7 +215,7 @@ bool Module::addSymbol(Defn * de) {
   }
 
   DASSERT_OBJ(de->isSingular(), de);
-  if (de->module() == this || de->isSynthetic()) {
+  if (de->module() == this || (de->isSynthetic() && TemplateRepository::get().claim(de, this))) {
     if (exportDefs_.insert(de)) {
       DASSERT_OBJ(!importDefs_.count(de), de);
       queueSymbol(de);
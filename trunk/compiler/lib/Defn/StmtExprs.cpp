@@ -177,7 +177,7 @@ bool ForEachExpr::isSideEffectFree() const {
 
 bool ForEachExpr::isSingular() const {
   return iterator_->isSingular()
-      && next_->isSingular()
+      && (next_ == NULL || next_->isSingular())
       && test_->isSingular()
       && body_->isSingular()
       && all(assigns_.begin(), assigns_.end(), &Expr::isSingular);
@@ -4,19 +4,138 @@
 
 #include "tart/Defn/Defn.h"
 #include "tart/Defn/SymbolTable.h"
+#include "tart/Common/CompilerStats.h"
+#include "tart/Common/Diagnostics.h"
+
+#include "llvm/Support/Allocator.h"
 
 namespace tart {
 
+namespace {
+  // Tables with no more names than this are searched without an index.
+  const size_t LINEAR_SEARCH_LIMIT = 8;
+
+  StatCounter numSymbolLookups("symbol-lookups", "Symbol table lookups");
+  StatCounter numSymbolProbes("symbol-probes", "Symbol table buckets examined");
+
+  /** Storage for the buckets of all symbol tables. */
+  llvm::BumpPtrAllocator & bucketAllocator() {
+    static llvm::BumpPtrAllocator allocator;
+    return allocator;
+  }
+}
+
+SymbolTable::SymbolTable(const SymbolTable & other)
+  : firstBucket_(NULL)
+  , lastBucket_(NULL)
+  , size_(0)
+{
+  DASSERT(other.size_ == 0) << "Copying a non-empty symbol table is not supported.";
+}
+
 SymbolTable::Entry * SymbolTable::add(Defn * member) {
   DASSERT(!member->name().empty());
-  Entry & entry = map_.GetOrCreateValue(member->name()).getValue();
-  entry.push_back(member);
-  return &entry;
+  const Ident * ident = IdentTable::get(member->name());
+  Bucket * bucket = findBucket(ident);
+  if (bucket == NULL) {
+    bucket = new (bucketAllocator().Allocate<Bucket>()) Bucket(ident);
+    if (lastBucket_ != NULL) {
+      lastBucket_->next = bucket;
+    } else {
+      firstBucket_ = bucket;
+    }
+
+    lastBucket_ = bucket;
+    ++size_;
+    if (size_ > LINEAR_SEARCH_LIMIT) {
+      if (size_ * 2 > index_.size()) {
+        rebuildIndex();
+      } else {
+        addToIndex(bucket);
+      }
+    }
+  }
+
+  bucket->second.push_back(member);
+  return &bucket->second;
+}
+
+const SymbolTable::Entry * SymbolTable::findSymbol(StringRef key) const {
+  ++numSymbolLookups;
+  if (size_ == 0) {
+    return NULL;
+  }
+
+  // A name which has never been interned can't be in any symbol table.
+  const Ident * ident = IdentTable::find(key);
+  if (ident == NULL) {
+    return NULL;
+  }
+
+  Bucket * bucket = findBucket(ident);
+  return bucket != NULL ? &bucket->second : NULL;
+}
+
+SymbolTable::Bucket * SymbolTable::findBucket(const Ident * ident) const {
+  if (index_.empty()) {
+    for (Bucket * bucket = firstBucket_; bucket != NULL; bucket = bucket->next) {
+      ++numSymbolProbes;
+      if (bucket->first == ident) {
+        return bucket;
+      }
+    }
+
+    return NULL;
+  }
+
+  size_t mask = index_.size() - 1;
+  for (size_t i = ident->getValue().hash & mask;; i = (i + 1) & mask) {
+    ++numSymbolProbes;
+    Bucket * bucket = index_[i];
+    if (bucket == NULL || bucket->first == ident) {
+      return bucket;
+    }
+  }
+}
+
+void SymbolTable::addToIndex(Bucket * bucket) {
+  size_t mask = index_.size() - 1;
+  size_t i = bucket->first->getValue().hash & mask;
+  while (index_[i] != NULL) {
+    i = (i + 1) & mask;
+  }
+
+  index_[i] = bucket;
+}
+
+void SymbolTable::rebuildIndex() {
+  size_t indexSize = 16;
+  while (indexSize < size_ * 4) {
+    indexSize *= 2;
+  }
+
+  index_.assign(indexSize, NULL);
+  for (Bucket * bucket = firstBucket_; bucket != NULL; bucket = bucket->next) {
+    addToIndex(bucket);
+  }
+}
+
+void SymbolTable::clear() {
+  // The memory for the buckets belongs to the allocator, and is not reused.
+  for (Bucket * bucket = firstBucket_; bucket != NULL;) {
+    Bucket * next = bucket->next;
+    bucket->~Bucket();
+    bucket = next;
+  }
+
+  firstBucket_ = lastBucket_ = NULL;
+  size_ = 0;
+  index_.clear();
 }
 
 void SymbolTable::trace() const {
-  for (NameDefnMap::const_iterator it = map_.begin(); it != map_.end(); ++it) {
-    const SymbolTable::Entry & entry = it->second;
+  for (const Bucket * bucket = firstBucket_; bucket != NULL; bucket = bucket->next) {
+    const SymbolTable::Entry & entry = bucket->second;
     for (SymbolTable::Entry::const_iterator si = entry.begin(); si != entry.end(); ++si) {
       (*si)->markDeferred();
     }
@@ -26,13 +145,13 @@ void SymbolTable::trace() const {
 void SymbolTable::getDebugSummary(FormatStream & out) const {
   size_t count = 0;
   out << "{";
-  for (NameDefnMap::const_iterator it = map_.begin(); it != map_.end(); ++it) {
+  for (const_iterator it = begin(); it != end(); ++it) {
     if (count > 8) {
-      out << " + " << map_.size() - count << " more...";
+      out << " + " << size_ - count << " more...";
       break;
     }
 
-    if (it != map_.begin()) {
+    if (it != begin()) {
       out << ", ";
     }
 
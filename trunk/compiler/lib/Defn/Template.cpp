@@ -20,6 +20,7 @@
 #include "tart/Sema/ScopeBuilder.h"
 #include "tart/Sema/TypeTransform.h"
 
+#include "tart/Common/CompilerStats.h"
 #include "tart/Common/Diagnostics.h"
 
 #include "tart/Objects/Builtins.h"
@@ -27,6 +28,9 @@
 
 namespace tart {
 
+static StatCounter numInstances("template-instances", "Template instances created");
+static StatCounter numInstanceHits("template-instance-hits", "Template instances found in cache");
+
 // -------------------------------------------------------------------
 // Class to discover all pattern variables in a type parameter list.
 
@@ -203,6 +207,7 @@ Defn * Template::instantiate(const SourceLocation & loc, const QualifiedTypeVarM
       if (trace) {
         diag.debug(loc) << "Found " << value_ << " with params " << typeArgs << " in cache.";
       }
+      ++numInstanceHits;
       return sp;
     }
   }
@@ -212,6 +217,7 @@ Defn * Template::instantiate(const SourceLocation & loc, const QualifiedTypeVarM
   }
 
   // Create the template instance
+  ++numInstances;
   DASSERT(value_->definingScope() != NULL);
   TemplateInstance * tinst = new TemplateInstance(value_, typeArgs, TupleType::get(paramValues));
   tinst->instantiatedFrom() = loc;
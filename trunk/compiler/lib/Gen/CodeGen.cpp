@@ -3,9 +3,12 @@
  * ================================================================ */
 
 #include "tart/Gen/CodeGenerator.h"
+#include "tart/Gen/FunctionCache.h"
 #include "tart/Gen/StructBuilder.h"
 #include "tart/Gen/RuntimeTypeInfo.h"
 
+#include "tart/Common/CodeGenOption.h"
+#include "tart/Common/CompilerStats.h"
 #include "tart/Common/Diagnostics.h"
 #include "tart/Common/SourceFile.h"
 
@@ -25,6 +28,7 @@
 #include "tart/Objects/TargetSelection.h"
 
 #include "llvm/Config/config.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Module.h"
 #include "llvm/PassManager.h"
@@ -54,12 +58,16 @@ ShowGen("show-generated", llvm::cl::desc("Display generated symbols"));
 static llvm::cl::opt<bool>
 Debug("g", llvm::cl::desc("Generate source-level debugging information"));
 
-llvm::cl::opt<bool>
+CodeGenOption<bool>
 NoGC("nogc", llvm::cl::desc("Don't generate garbage-collection intrinsics"));
 
-llvm::cl::opt<bool>
+CodeGenOption<bool>
 SsGC("ssgc", llvm::cl::desc("Don't generate garbage-collection intrinsics"));
 
+static llvm::cl::opt<std::string>
+FunctionCacheDir("fn-cache", llvm::cl::desc("Directory of cached generated functions"),
+    llvm::cl::value_desc("dir"), llvm::cl::init(""));
+
 extern SystemNamespaceMember<FunctionDefn> gc_alloc;
 
 CodeGenerator::CodeGenerator(Module * mod)
@@ -74,6 +82,7 @@ CodeGenerator::CodeGenerator(Module * mod)
   , moduleInitBlock_(NULL)
   , reflector_(*this)
   , gcEnabled_(!NoGC)
+  , functionCache_(NULL)
   , diBuilder_(*mod->irModule())
   , blockExits_(NULL)
   , isUnwindBlock_(false)
@@ -92,6 +101,19 @@ CodeGenerator::CodeGenerator(Module * mod)
   methodPtrType_ = builder_.getInt8PtrTy();
 
   voidValue_ = llvm::UndefValue::get(builder_.getVoidTy());
+
+  // Cached functions carry no debugging information, so don't use the cache with -g.
+  if (!FunctionCacheDir.empty() && !debug_) {
+    // Whether reflection is enabled depends on the module as well as on -noreflect.
+    std::string options;
+    CodeGenOptionBase::describeAll(options);
+    options += reflector_.enabled() ? "reflect" : "noreflect";
+    functionCache_ = new FunctionCache(FunctionCacheDir, options, irModule_);
+  }
+}
+
+CodeGenerator::~CodeGenerator() {
+  delete functionCache_;
 }
 
 void CodeGenerator::generate() {
@@ -171,6 +193,11 @@ void CodeGenerator::generate() {
 
   genModuleMetadata();
 
+  // Link in the functions which were found in the cache.
+  if (functionCache_ != NULL && diag.getErrorCount() == 0) {
+    functionCache_->finish();
+  }
+
   if (Dump) {
     if (diag.getErrorCount() == 0) {
       fprintf(stderr, "------------------------------------------------\n");
@@ -210,16 +237,15 @@ llvm::ConstantInt * CodeGenerator::getInt64Val(int64_t value) {
 }
 
 void CodeGenerator::verifyModule() {
+  PhaseScope scope(Phase::Verify);
   llvm::PassManager passManager;
   //passManager.add(new llvm::TargetData(irModule_));
   passManager.add(llvm::createVerifierPass()); // Verify that input is correct
   passManager.run(*irModule_);
 }
 
-void CodeGenerator::outputModule() {
-  // File handle for output bitcode
+std::string CodeGenerator::outputPath(StringRef moduleName) {
   llvm::sys::Path binPath(outputDir);
-  StringRef moduleName = module_->linkageName();
   size_t pos = 0;
   for (;;) {
     size_t dot = moduleName.find('.', pos);
@@ -238,7 +264,13 @@ void CodeGenerator::outputModule() {
   }
 
   binPath.appendSuffix("bc");
+  return binPath.str();
+}
 
+void CodeGenerator::outputModule() {
+  PhaseScope scope(Phase::Output);
+  // File handle for output bitcode
+  llvm::sys::Path binPath(outputPath(module_->linkageName()));
   llvm::sys::Path binDir(binPath);
   if (binDir.eraseComponent()) {
     if (!binDir.isEmpty()) {
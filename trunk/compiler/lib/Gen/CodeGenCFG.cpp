@@ -70,8 +70,7 @@ void CodeGenerator::genLocalVar(VariableDefn * var, Value * initialVal) {
     DASSERT_OBJ(cellType != NULL, var);
     llvm::Type * irType = cellType->irEmbeddedType();
 
-    Value * cellValue = builder_.CreateCall2(
-            getGcAlloc(), gcAllocContext_,
+    Value * cellValue = genAlloc(
             llvm::ConstantExpr::getIntegerCast(
                 llvm::ConstantExpr::getSizeOf(cellType->irTypeComplete()), intPtrType_, false),
             var->name() + StringRef(".shared.alloc"));
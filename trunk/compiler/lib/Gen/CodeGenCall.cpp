@@ -11,6 +11,7 @@
 
 #include "tart/Gen/CodeGenerator.h"
 
+#include "tart/Common/CodeGenOption.h"
 #include "tart/Common/Diagnostics.h"
 
 #include "tart/Objects/Builtins.h"
@@ -18,11 +19,23 @@
 #include "tart/Objects/SystemDefs.h"
 
 #include "llvm/Function.h"
+#include "llvm/Support/CommandLine.h"
 
 namespace tart {
 
 using namespace llvm;
 
+static CodeGenOption<bool>
+DisableInlineAlloc("disable-inline-alloc",
+    cl::desc("Always call the collector to allocate objects"));
+
+// Field indices for tart.gc.AllocContext. Field 0 is the Object header.
+enum AllocContextFields {
+  ALLOC_CONTEXT_POS = 1,
+  ALLOC_CONTEXT_LIMIT,
+  ALLOC_CONTEXT_COUNT,
+};
+
 Value * CodeGenerator::genCall(const tart::FnCallExpr* in) {
   const FunctionDefn * fn = in->function();
   const FunctionType * fnType = fn->functionType();
@@ -113,6 +126,8 @@ Value * CodeGenerator::genCall(const tart::FnCallExpr* in) {
     result = selfArg;
   } else if (fnType->isStructReturn()) {
     result = retVal;
+  } else if (fnType->isRegisterReturn()) {
+    result = genReturnTemp(result);
   }
 
   // Clear out all the temporary roots
@@ -156,6 +171,11 @@ Value * CodeGenerator::genIndirectCall(const tart::IndirectCallExpr* in) {
   }
 
   llvm::Value * result = genCallInstr(fnValue, args, "indirect");
+  if (const FunctionType * ft = dyn_cast<FunctionType>(fnType)) {
+    if (ft->isRegisterReturn()) {
+      result = genReturnTemp(result);
+    }
+  }
 
   // Clear out all the temporary roots
   popRootStack(savedRootCount);
@@ -310,10 +330,11 @@ Value * CodeGenerator::genNew(const tart::NewExpr* in) {
       }
       return builder_.CreateAlloca(type, 0, ctdef->typeDefn()->name());
     } else if (ctdef->typeClass() == Type::Class) {
-      DASSERT(gcAllocContext_ != NULL);
-      Function * alloc = getGcAlloc();
-      Value * newObj = builder_.CreateCall2(
-          alloc, gcAllocContext_,
+      if (in->isStackAlloc()) {
+        return genStackNew(ctdef);
+      }
+
+      Value * newObj = genAlloc(
           llvm::ConstantExpr::getIntegerCast(
               llvm::ConstantExpr::getSizeOf(type),
               intPtrType_, false),
@@ -327,13 +348,125 @@ Value * CodeGenerator::genNew(const tart::NewExpr* in) {
   DFAIL("IllegalState");
 }
 
+Value * CodeGenerator::genStackNew(const CompositeType * ctdef) {
+  llvm::Type * type = ctdef->irTypeComplete();
+  llvm::Constant * zeroObj = ConstantAggregateZero::get(type);
+
+  // Allocate the object in the prologue block, so that there's only one instance per
+  // call even if the allocation is inside a loop. The object is cleared immediately,
+  // since the collector traces its fields from then on.
+  IRBuilderBase::InsertPoint savePt = builder_.saveIP();
+  builder_.SetInsertPoint(&currentFn_->getBasicBlockList().front());
+  Value * newObj = builder_.CreateAlloca(type, NULL, Twine(ctdef->typeDefn()->name(), "_stack"));
+  builder_.CreateStore(zeroObj, newObj);
+  if (gcEnabled_) {
+    llvm::GlobalVariable * traceTable = getTraceTable(ctdef);
+    if (traceTable != NULL) {
+      markGCRoot(newObj, traceTable, newObj->getName());
+    }
+  }
+
+  builder_.restoreIP(savePt);
+
+  // Constructors expect a zero-filled instance with a valid type info pointer. The
+  // 'gcstate' word stays zero, which the collector treats as a non-heap object.
+  builder_.CreateStore(zeroObj, newObj);
+  genInitObjVTable(ctdef, newObj);
+  return newObj;
+}
+
+Value * CodeGenerator::genStackArray(const CompositeType * arrayType, size_t length) {
+  // The same layout as the array class, with room for exactly 'length' elements in
+  // place of the flexible array.
+  llvm::StructType * arrayIrType = cast<llvm::StructType>(arrayType->irTypeComplete());
+  llvm::Type * elementIrType = arrayType->typeParam(0)->irEmbeddedType();
+  llvm::Type * fieldTypes[3];
+  fieldTypes[0] = arrayIrType->getElementType(0);
+  fieldTypes[1] = arrayIrType->getElementType(1);
+  fieldTypes[2] = llvm::ArrayType::get(elementIrType, length);
+  llvm::StructType * type = llvm::StructType::get(context_, fieldTypes);
+  llvm::Constant * zeroArray = ConstantAggregateZero::get(type);
+
+  // As with genStackNew, there is one instance per call, which is traced from the
+  // start. The trace table reads the element count from the array itself, so the
+  // elements are ignored until the size has been set.
+  IRBuilderBase::InsertPoint savePt = builder_.saveIP();
+  builder_.SetInsertPoint(&currentFn_->getBasicBlockList().front());
+  Value * stackArray = builder_.CreateAlloca(type, NULL, "ArrayLiteral_stack");
+  builder_.CreateStore(zeroArray, stackArray);
+  if (gcEnabled_) {
+    llvm::GlobalVariable * traceTable = getTraceTable(arrayType);
+    if (traceTable != NULL) {
+      markGCRoot(stackArray, traceTable, stackArray->getName());
+    }
+  }
+
+  builder_.restoreIP(savePt);
+
+  builder_.CreateStore(zeroArray, stackArray);
+  Value * result = builder_.CreatePointerCast(stackArray, arrayType->irEmbeddedType());
+  genInitObjVTable(arrayType, result);
+  builder_.CreateStore(getIntVal(length), builder_.CreateStructGEP(result, 1, "size"));
+  return result;
+}
+
 Value * CodeGenerator::defaultAlloc(const tart::Expr * size) {
-  DASSERT(gcAllocContext_ != NULL);
   Value * sizeVal = genExpr(size);
+  return builder_.CreatePointerCast(genAlloc(sizeVal, "newInstance"), builder_.getInt8PtrTy());
+}
+
+Value * CodeGenerator::genAlloc(Value * size, const Twine & name) {
+  DASSERT(gcAllocContext_ != NULL);
   Function * alloc = getGcAlloc();
-  return builder_.CreatePointerCast(
-      builder_.CreateCall2(alloc, gcAllocContext_, sizeVal, "newInstance"),
-      builder_.getInt8PtrTy());
+
+  // Round the size up to a multiple of 8. Sizes are almost always constant, in which
+  // case this folds away.
+  size = builder_.CreateAnd(
+      builder_.CreateAdd(size, ConstantInt::get(intPtrType_, 7)),
+      ConstantInt::get(intPtrType_, ~uint64_t(7)), "size");
+
+  if (DisableInlineAlloc) {
+    return builder_.CreateCall2(alloc, gcAllocContext_, size, name);
+  }
+
+  // See tart.gc.AllocContext for the allocation protocol.
+  llvm::Type * contextType = Builtins::typeAllocContext->irTypeComplete();
+  Value * context = builder_.CreatePointerCast(gcAllocContext_, contextType->getPointerTo());
+  Value * posAddr = builder_.CreateStructGEP(context, ALLOC_CONTEXT_POS, "alloc.pos.addr");
+  Value * pos = builder_.CreateLoad(posAddr, "alloc.pos");
+  Value * newPos = builder_.CreateGEP(pos, size, "alloc.next");
+  Value * limit = builder_.CreateLoad(
+      builder_.CreateStructGEP(context, ALLOC_CONTEXT_LIMIT), "alloc.limit");
+
+  BasicBlock * blkFast = BasicBlock::Create(context_, "alloc.fast", currentFn_);
+  BasicBlock * blkSlow = BasicBlock::Create(context_, "alloc.slow", currentFn_);
+  BasicBlock * blkDone = BasicBlock::Create(context_, "alloc.done", currentFn_);
+  builder_.CreateCondBr(builder_.CreateICmpULE(newPos, limit), blkFast, blkSlow);
+
+  // Fast path: bump the pointer, record the size in the object header, and count it.
+  moveToEnd(blkFast);
+  builder_.SetInsertPoint(blkFast);
+  builder_.CreateStore(newPos, posAddr);
+  Value * fastObj = builder_.CreatePointerCast(pos, alloc->getReturnType());
+  Value * header = builder_.CreatePointerCast(pos, Builtins::typeObject->irType()->getPointerTo());
+  builder_.CreateStore(size, builder_.CreateStructGEP(header, 1, "gcstate"));
+  Value * countAddr = builder_.CreateStructGEP(context, ALLOC_CONTEXT_COUNT);
+  builder_.CreateStore(
+      builder_.CreateAdd(builder_.CreateLoad(countAddr), builder_.getInt64(1)), countAddr);
+  builder_.CreateBr(blkDone);
+
+  // Slow path: let the collector find some more room.
+  moveToEnd(blkSlow);
+  builder_.SetInsertPoint(blkSlow);
+  Value * slowObj = builder_.CreateCall2(alloc, gcAllocContext_, size);
+  builder_.CreateBr(blkDone);
+
+  moveToEnd(blkDone);
+  builder_.SetInsertPoint(blkDone);
+  PHINode * result = builder_.CreatePHI(alloc->getReturnType(), 2, name);
+  result->addIncoming(fastObj, blkFast);
+  result->addIncoming(slowObj, blkSlow);
+  return result;
 }
 
 Value * CodeGenerator::genCallInstr(Value * func, ArrayRef<Value *> args, const Twine & name) {
@@ -357,6 +490,18 @@ Value * CodeGenerator::genCallInstr(Value * func, ArrayRef<Value *> args, const
   }
 }
 
+Value * CodeGenerator::genReturnTemp(Value * value) {
+  // The temporary goes in the prologue block, so that there's one per call site even
+  // inside a loop, and the optimizer can break it up into registers again.
+  IRBuilderBase::InsertPoint savePt = builder_.saveIP();
+  builder_.SetInsertPoint(&currentFn_->getBasicBlockList().front());
+  Value * temp = builder_.CreateAlloca(value->getType(), NULL, "rret");
+  builder_.restoreIP(savePt);
+
+  builder_.CreateStore(value, temp);
+  return temp;
+}
+
 void CodeGenerator::checkCallingArgs(const llvm::Value * fn, ArrayRef<Value *> args) {
 #if !NDEBUG
   const llvm::FunctionType * fnType = cast<llvm::FunctionType>(fn->getType()->getContainedType(0));
@@ -59,6 +59,9 @@ Value * CodeGenerator::genCast(Value * in, const Type * fromType, const Type * t
       args.push_back(in);
       genCallInstr(fnVal, args, "convert");
       return sret;
+    } else if (converter->functionType()->isRegisterReturn()) {
+      args.push_back(in);
+      return genReturnTemp(genCallInstr(fnVal, args, "convert"));
     } else {
       args.push_back(in);
       return genCallInstr(fnVal, args, "convert");
@@ -3,8 +3,11 @@
  * ================================================================ */
 
 #include "tart/Gen/CodeGenerator.h"
+#include "tart/Gen/FunctionCache.h"
+#include "tart/Common/CodeGenOption.h"
 #include "tart/Common/Diagnostics.h"
 #include "tart/Common/SourceFile.h"
+#include "tart/Common/TemplateRepository.h"
 
 #include "tart/Defn/Module.h"
 #include "tart/Defn/Defn.h"
@@ -28,7 +31,7 @@ namespace tart {
 
 extern SystemNamespaceMember<FunctionDefn> gc_allocContext;
 
-extern llvm::cl::opt<bool> SsGC;
+extern CodeGenOption<bool> SsGC;
 
 using namespace llvm;
 
@@ -155,7 +158,13 @@ bool CodeGenerator::genFunction(FunctionDefn * fdef) {
     FunctionType * ftype = fdef->functionType();
 
     if (fdef->isSynthetic()) {
-      f->setLinkage(GlobalValue::LinkOnceODRLinkage);
+      // The owner of a shared template instance must keep the body, since other
+      // modules only have a declaration.
+      if (TemplateRepository::get().isOwner(fdef, module_)) {
+        f->setLinkage(GlobalValue::WeakODRLinkage);
+      } else {
+        f->setLinkage(GlobalValue::LinkOnceODRLinkage);
+      }
     }
 
     if (gcEnabled_) {
@@ -166,6 +175,15 @@ bool CodeGenerator::genFunction(FunctionDefn * fdef) {
       }
     }
 
+    uint64_t cacheKey = 0;
+    int errorCount = diag.getErrorCount();
+    if (functionCache_ != NULL) {
+      cacheKey = functionCache_->key(fdef, f);
+      if (cacheKey != 0 && functionCache_->load(cacheKey, f)) {
+        return true;
+      }
+    }
+
     if (debug_) {
       dbgContext_ = genDISubprogram(fdef);
       //dbgContext_ = genLexicalBlock(fdef->location());
@@ -318,6 +336,10 @@ bool CodeGenerator::genFunction(FunctionDefn * fdef) {
       }
     }
 
+    if (cacheKey != 0 && diag.getErrorCount() == errorCount) {
+      functionCache_->add(cacheKey, f);
+    }
+
     //if (debug_ && !dbgContext_.isNull() && !dbgContext_.Verify()) {
     //  dbgContext_.Verify();
     //  DFAIL("BAD DBG");
@@ -474,10 +496,23 @@ llvm::Constant * CodeGenerator::genGlobalVar(const VariableDefn * var) {
         }
 
         if (varType->isReferenceType()) {
-          initValue = new GlobalVariable(
-              *irModule_, initValue->getType(), false, linkType, initValue,
+          // The object is a static instance (with a gcstate of zero). If the object's
+          // type is immutable, it can go in read-only data; otherwise it must be
+          // registered as a root, since its fields may later point into the heap.
+          bool isMutable = true;
+          if (const CompositeType * ctype =
+              dyn_cast<CompositeType>(initExpr->type().unqualified())) {
+            isMutable = ctype->isMutable();
+          }
+
+          GlobalVariable * initVar = new GlobalVariable(
+              *irModule_, initValue->getType(), !isMutable, linkType, initValue,
               var->linkageName() + ".init");
-          initValue = llvm::ConstantExpr::getPointerCast(initValue, varType->irEmbeddedType());
+          if (isMutable) {
+            addStaticRoot(initVar, initExpr->type().unqualified());
+          }
+
+          initValue = llvm::ConstantExpr::getPointerCast(initVar, varType->irEmbeddedType());
         }
 
         gv->setInitializer(initValue);
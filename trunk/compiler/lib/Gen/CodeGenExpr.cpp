@@ -58,6 +58,9 @@ FormatStream & operator<<(FormatStream & out, const ValueList & values) {
 using namespace llvm;
 
 namespace {
+// Array literals shorter than this are always built with one store per element.
+const size_t MIN_ARRAY_TEMPLATE_LENGTH = 8;
+
 /** Return the type that would be generated from a GEP instruction. */
 llvm::Type * getGEPType(llvm::Type * type, ValueList::const_iterator first,
     ValueList::const_iterator last) {
@@ -284,6 +287,9 @@ llvm::Constant * CodeGenerator::genConstExpr(const Expr * in) {
     case Expr::ConstInt:
       return static_cast<const ConstantInteger *>(in)->value();
 
+    case Expr::ConstFloat:
+      return static_cast<const ConstantFloat *>(in)->value();
+
     case Expr::ConstObjRef:
       return genConstantObject(static_cast<const ConstantObjectRef *>(in));
 
@@ -1088,18 +1094,72 @@ Value * CodeGenerator::genArrayLiteral(const ArrayLiteralExpr * in) {
 
  //diag.debug() << "Generating array literal of type " << elementType << ", length " << arrayLength;
 
-  // Arguments to the array-creation function
-  ValueList args;
-  args.push_back(getIntVal(arrayLength));
-  Constant * allocFunc = findMethod(arrayType, "alloc");
-  Value * result = genCallInstr(allocFunc, args, "ArrayLiteral");
+  // Find out which of the elements are constants. Constant expressions have no side
+  // effects, so it doesn't matter that they are evaluated first.
+  const Type * elementType = arrayType->typeParam(0).unqualified();
+  ConstantList constVals;
+  constVals.resize(arrayLength);
+  size_t constCount = 0;
+  if (elementType->typeShape() != Shape_Large_Value) {
+    llvm::Type * elementIrType = elementType->irEmbeddedType();
+    for (size_t i = 0; i < arrayLength; ++i) {
+      Expr * arg = in->args()[i];
+      if (arg->isConstant()) {
+        Constant * el = dyn_cast_or_null<Constant>(genExpr(arg));
+        if (el != NULL && el->getType() == elementIrType) {
+          constVals[i] = el;
+          ++constCount;
+        }
+      }
+    }
+  }
+
+  // An array literal whose type doesn't allow it to be modified can share a single
+  // static instance.
+  QualifiedType literalType = in->type();
+  if (constCount == arrayLength && (literalType.isReadOnly() || literalType.isImmutable())) {
+    GlobalVariable * array = genConstantArrayLiteral(arrayType, constVals);
+    return llvm::ConstantExpr::getPointerCast(array, arrayType->irEmbeddedType());
+  }
+
+  Value * result;
+  if (in->isStackAlloc()) {
+    result = genStackArray(arrayType, arrayLength);
+  } else {
+    // Arguments to the array-creation function
+    ValueList args;
+    args.push_back(getIntVal(arrayLength));
+    Constant * allocFunc = findMethod(arrayType, "alloc");
+    result = genCallInstr(allocFunc, args, "ArrayLiteral");
+  }
+
+  Value * arrayData = builder_.CreateStructGEP(result, 2, "data");
+
+  // If most of the elements are constants, copy them all at once from a static copy
+  // of the array, and only store the rest one by one. For short arrays the stores are
+  // cheaper than the copy.
+  bool useTemplate = arrayLength >= MIN_ARRAY_TEMPLATE_LENGTH && constCount * 2 > arrayLength;
+  if (useTemplate) {
+    GlobalVariable * arrayTemplate = genConstantArrayLiteral(arrayType, constVals);
+    Constant * indices[2];
+    indices[0] = getInt32Val(0);
+    indices[1] = getInt32Val(2);
+    Constant * templateData = llvm::ConstantExpr::getInBoundsGetElementPtr(
+        arrayTemplate, indices);
+    builder_.CreateMemCpy(arrayData, templateData,
+        llvm::ConstantExpr::getSizeOf(templateData->getType()->getContainedType(0)), 0);
+  }
 
-  // Evaluate the array elements.
+  // Evaluate the remaining array elements.
   ValueList arrayVals;
   arrayVals.resize(arrayLength);
   for (size_t i = 0; i < arrayLength; ++i) {
+    if (useTemplate && constVals[i] != NULL) {
+      continue;
+    }
+
     Expr * arg = in->args()[i];
-    Value * el = genExpr(arg);
+    Value * el = constVals[i] != NULL ? constVals[i] : genExpr(arg);
     if (el == NULL) {
       return NULL;
     }
@@ -1111,17 +1171,46 @@ Value * CodeGenerator::genArrayLiteral(const ArrayLiteralExpr * in) {
   }
 
   // Store the array elements into their slots.
-  Value * arrayData = builder_.CreateStructGEP(result, 2, "data");
   for (size_t i = 0; i < arrayLength; ++i) {
-    Value * arraySlot = builder_.CreateStructGEP(arrayData, i);
-    builder_.CreateStore(arrayVals[i], arraySlot);
+    if (arrayVals[i] != NULL) {
+      Value * arraySlot = builder_.CreateStructGEP(arrayData, i);
+      builder_.CreateStore(arrayVals[i], arraySlot);
+    }
   }
 
-  // TODO: Optimize array creation when most of the elements are constants.
-
   return result;
 }
 
+GlobalVariable * CodeGenerator::genConstantArrayLiteral(const CompositeType * arrayType,
+    ArrayRef<Constant *> elements) {
+  // Elements which are not constants are left as zero, to be filled in later.
+  llvm::Type * elementType = arrayType->typeParam(0)->irEmbeddedType();
+  ConstantList elementValues;
+  for (ArrayRef<Constant *>::iterator it = elements.begin(); it != elements.end(); ++it) {
+    elementValues.push_back(*it != NULL ? *it : llvm::Constant::getNullValue(elementType));
+  }
+
+  // The object header has a gcstate of zero, so the collector knows that the array
+  // is not in the heap.
+  StructBuilder sb(*this);
+  sb.createObjectHeader(arrayType);
+  sb.addField(getIntVal(elements.size()));
+  sb.addArrayField(arrayType->typeParam(0).unqualified(), elementValues);
+  Constant * arrayStruct = sb.buildAnon();
+
+  // Constants are uniqued, so literals with the same type and contents share one copy.
+  // Nothing in it can be modified, or point to the heap, so it isn't a static root.
+  GlobalVariable *& array = constantArrayMap_[arrayStruct];
+  if (array == NULL) {
+    array = new GlobalVariable(*irModule_,
+        arrayStruct->getType(), true, GlobalValue::PrivateLinkage, arrayStruct,
+        ".arrayLiteral");
+    array->setUnnamedAddr(true);
+  }
+
+  return array;
+}
+
 Value * CodeGenerator::genClosureEnv(const ClosureEnvExpr * in) {
   if (in->members().count() == 0) {
     return llvm::ConstantPointerNull::get(in->type()->irType()->getPointerTo());
@@ -1130,8 +1219,7 @@ Value * CodeGenerator::genClosureEnv(const ClosureEnvExpr * in) {
     DASSERT(envType->super() != NULL);
 
     // Allocate the environment.
-    Value * env = builder_.CreateCall2(
-        getGcAlloc(), gcAllocContext_,
+    Value * env = genAlloc(
         llvm::ConstantExpr::getIntegerCast(
             llvm::ConstantExpr::getSizeOf(envType->irTypeComplete()),
             intPtrType_, false),
@@ -1188,7 +1276,7 @@ Value * CodeGenerator::genVarSizeAlloc(const Type * objType, Value * sizeValue)
   DASSERT(sizeValue->getType() == intPtrType_);
   StrFormatStream labelStream;
   labelStream << objType;
-  Value * alloc = builder_.CreateCall2(getGcAlloc(), gcAllocContext_, sizeValue, labelStream.str());
+  Value * alloc = genAlloc(sizeValue, labelStream.str());
   Value * instance = builder_.CreateBitCast(alloc, resultType);
 
   if (const CompositeType * classType = dyn_cast<CompositeType>(objType)) {
@@ -1207,20 +1295,43 @@ GlobalVariable * CodeGenerator::genConstantObjectPtr(const ConstantObjectRef * o
     }
   }
 
+  const CompositeType * type = cast<CompositeType>(obj->type().unqualified());
+  type->createIRTypeFields();
+  bool isMutable = type->isMutable();
+  GlobalValue::LinkageTypes linkage =
+      synthetic ? GlobalValue::LinkOnceODRLinkage : GlobalValue::ExternalLinkage;
+
+  // Register the variable before generating the contents, so that references back
+  // to the root object from within the object graph resolve to this variable and
+  // not to a second copy of the object.
+  GlobalVariable * var = new GlobalVariable(*irModule_, type->irType(), !isMutable, linkage,
+      NULL, name);
+  constantObjectPtrMap_[obj] = var;
+
   Constant * constObject = genConstantObject(obj);
   if (constObject == NULL) {
     return NULL;
   }
 
-  bool isMutable = false;
-  if (const CompositeType * ctype = dyn_cast<CompositeType>(obj->type().unqualified())) {
-    isMutable = ctype->isMutable();
+  // Objects with a flexible array field have an anonymous struct type, which differs
+  // from the placeholder's type.
+  if (constObject->getType() != type->irType()) {
+    if (!var->use_empty()) {
+      diag.error(obj) << "Constant object of variable size cannot refer to itself.";
+      return NULL;
+    }
+
+    GlobalVariable * sizedVar = new GlobalVariable(*irModule_, constObject->getType(),
+        !isMutable, linkage, NULL);
+    sizedVar->takeName(var);
+    var->eraseFromParent();
+    var = sizedVar;
+    constantObjectPtrMap_[obj] =
+        llvm::ConstantExpr::getPointerCast(var, type->irType()->getPointerTo());
   }
-  GlobalVariable * var = new GlobalVariable(
-      *irModule_, constObject->getType(), !isMutable,
-      synthetic ? GlobalValue::LinkOnceODRLinkage : GlobalValue::ExternalLinkage,
-      constObject, name);
-  addStaticRoot(var, obj->type().unqualified());
+
+  var->setInitializer(constObject);
+  addStaticRoot(var, type);
   return var;
 }
 
@@ -1238,6 +1349,55 @@ Constant * CodeGenerator::genConstantObject(const ConstantObjectRef * obj) {
   return structVal;
 }
 
+Constant * CodeGenerator::genConstantObjectRef(const ConstantObjectRef * obj) {
+  ConstantObjectMap::iterator it = constantObjectPtrMap_.find(obj);
+  if (it != constantObjectPtrMap_.end()) {
+    return it->second;
+  }
+
+  const CompositeType * type = cast<CompositeType>(obj->type().unqualified());
+  type->createIRTypeFields();
+  bool isMutable = type->isMutable();
+
+  // Register a placeholder before generating the contents, so that references back
+  // to this object from within the object graph resolve to the same variable.
+  llvm::PointerType * ptrType = type->irType()->getPointerTo();
+  GlobalVariable * var = new GlobalVariable(*irModule_, type->irType(), !isMutable,
+      GlobalValue::InternalLinkage, NULL, ".constObj");
+  constantObjectPtrMap_[obj] = var;
+
+  Constant * structVal = genConstantObject(obj);
+  if (structVal == NULL) {
+    return NULL;
+  }
+
+  // Objects with a flexible array field have an anonymous struct type, which differs
+  // from the placeholder's type.
+  if (structVal->getType() != type->irType()) {
+    if (!var->use_empty()) {
+      diag.error(obj) << "Constant object of variable size cannot refer to itself.";
+      return NULL;
+    }
+
+    GlobalVariable * sizedVar = new GlobalVariable(*irModule_, structVal->getType(),
+        !isMutable, GlobalValue::InternalLinkage, NULL, ".constObj");
+    var->eraseFromParent();
+    var = sizedVar;
+  }
+
+  var->setInitializer(structVal);
+
+  // A mutable object's fields can later be made to point into the heap, so the
+  // collector needs to know about it.
+  if (isMutable) {
+    addStaticRoot(var, type);
+  }
+
+  Constant * result = llvm::ConstantExpr::getPointerCast(var, ptrType);
+  constantObjectPtrMap_[obj] = result;
+  return result;
+}
+
 Constant * CodeGenerator::genConstantObjectStruct(
     const ConstantObjectRef * obj, const CompositeType * type) {
   ConstantList fieldValues;
@@ -1272,7 +1432,17 @@ Constant * CodeGenerator::genConstantObjectStruct(
           return NULL;
         }
 
-        Constant * irValue = genConstExpr(value);
+        // Objects referred to by a field are generated as variables of their own.
+        Constant * irValue;
+        if (value->exprType() == Expr::ConstObjRef && value->type()->isReferenceType()) {
+          irValue = genConstantObjectRef(static_cast<const ConstantObjectRef *>(value));
+          if (irValue != NULL) {
+            irValue = llvm::ConstantExpr::getPointerCast(irValue, var->type()->irEmbeddedType());
+          }
+        } else {
+          irValue = genConstExpr(value);
+        }
+
         if (irValue == NULL) {
           return NULL;
         }
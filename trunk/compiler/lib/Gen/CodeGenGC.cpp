@@ -12,6 +12,7 @@
 #include "tart/Defn/Defn.h"
 #include "tart/Defn/TypeDefn.h"
 #include "tart/Type/FunctionType.h"
+#include "tart/Type/NativeType.h"
 #include "tart/Defn/FunctionDefn.h"
 #include "tart/Type/PrimitiveType.h"
 #include "tart/Type/CompositeType.h"
@@ -35,6 +36,15 @@ using namespace llvm;
 
 extern SystemClassMember<VariableDefn> tib_traceTable;
 
+// Flag bits for the first field of a trace descriptor. Must agree with
+// tart.gc.TraceDescriptor and the TraceDescriptorFlags enum in the runtime.
+enum TraceDescFlags {
+  TRACE_DESC_LAST = (1<<0),
+  TRACE_DESC_DELTA_OFFSETS = (1<<1),
+  TRACE_DESC_ARRAY = (1<<2),
+  TRACE_DESC_VOID_OR_REF = (1<<3),
+};
+
 // Members of tart.gc.TraceAction.
 SystemClassMember<FunctionDefn> traceAction_tracePointer(Builtins::typeTraceAction, "tracePointer");
 SystemClassMember<FunctionDefn> traceAction_traceDescriptors(
@@ -254,8 +264,9 @@ llvm::GlobalVariable * CodeGenerator::createTraceTable(const Type * type) {
   // Mark the last entry in the table. This needs to be done by replacing, rather than by
   // patching the entry.
   llvm::ConstantStruct * finalEntry = cast<ConstantStruct>(traceTable.back());
+  int64_t finalFlags = cast<ConstantInt>(finalEntry->getOperand(0))->getSExtValue();
   StructBuilder sbFinalEntry(*this);
-  sbFinalEntry.addField(getInt16Val(1));
+  sbFinalEntry.addField(getInt16Val(finalFlags | TRACE_DESC_LAST));
   sbFinalEntry.addField(finalEntry->getOperand(1));
   sbFinalEntry.addField(finalEntry->getOperand(2));
   sbFinalEntry.addField(finalEntry->getOperand(3));
@@ -313,6 +324,12 @@ void CodeGenerator::createTraceTableEntries(const Type * type, llvm::Constant *
         fieldOffset = llvm::ConstantExpr::getPtrToInt(fieldOffset, intPtrType_);
         fieldOffsets.push_back(fieldOffset);
         break;
+      } else if (ut->isRefOrVoidType() &&
+          ut->getDiscriminatorType() == builder_.getInt8Ty()) {
+        // Only void has no reference to trace, so the collector can test the
+        // discriminator itself rather than calling a trace method.
+        createRefOrVoidTraceTableEntry(ut, basePtr, traceTable, indices);
+        break;
       } else if (ut->containsReferenceType()) {
         llvm::Function * traceMethod = getUnionTraceMethod(ut);
         DASSERT(traceMethod != NULL);
@@ -349,6 +366,7 @@ void CodeGenerator::createCompositeTraceTableEntries(const CompositeType * type,
     indices.resize(indicesSize);
   }
 
+  const VariableDefn * prevField = NULL;
   for (DefnList::const_iterator it = type->instanceFields().begin();
       it != type->instanceFields().end(); ++it) {
     if (*it == NULL) {
@@ -377,12 +395,17 @@ void CodeGenerator::createCompositeTraceTableEntries(const CompositeType * type,
         break;
 
       case Type::FlexibleArray:
-        //DFAIL("Implement");
+        // A class with a custom trace method is responsible for tracing its own array.
+        if (type->traceMethods().empty()) {
+          createArrayTraceTableEntry(var, prevField, basePtr, traceTable, indices);
+        }
         break;
 
       default:
         break;
     }
+
+    prevField = var;
   }
 
   llvm::PointerType * fieldOffsetArrayType = intPtrType_->getPointerTo();
@@ -400,6 +423,125 @@ void CodeGenerator::createCompositeTraceTableEntries(const CompositeType * type,
   }
 }
 
+void CodeGenerator::createArrayTraceTableEntry(const VariableDefn * arrayField,
+    const VariableDefn * lengthField, llvm::Constant * basePtr, ConstantList & traceTable,
+    ConstantList & indices) {
+  const FlexibleArrayType * arrayType = cast<FlexibleArrayType>(arrayField->type().unqualified());
+  const Type * elementType = arrayType->elementType().unqualified();
+
+  // Arrays of primitive values need no tracing at all.
+  if (!elementType->isReferenceType() && !elementType->containsReferenceType()) {
+    return;
+  }
+
+  // The element count is read from the integer field which precedes the array. This
+  // may be 32 or 64 bits wide - 'int', as used by Array, is pointer-sized.
+  const PrimitiveType * lengthType = lengthField != NULL ?
+      dyn_cast<PrimitiveType>(lengthField->type().unqualified()) : NULL;
+  unsigned lengthSize = 0;
+  if (lengthType != NULL) {
+    switch (lengthType->typeId()) {
+      case TypeId_SInt32:
+      case TypeId_UInt32:
+        lengthSize = 4;
+        break;
+
+      case TypeId_SInt64:
+      case TypeId_UInt64:
+        lengthSize = 8;
+        break;
+
+      default:
+        break;
+    }
+  }
+
+  if (lengthSize == 0) {
+    diag.error(arrayField) << "Flexible array '" << arrayField <<
+        "' must be preceded by a 32 or 64-bit integer length field, " <<
+        "or traced by a trace method.";
+    return;
+  }
+
+  size_t indicesSize = indices.size();
+  indices.push_back(getInt32Val(lengthField->memberIndex()));
+  llvm::Constant * lengthOffset = llvm::ConstantExpr::getInBoundsGetElementPtr(basePtr, indices);
+  lengthOffset = llvm::ConstantExpr::getPtrToInt(lengthOffset, builder_.getInt32Ty());
+  indices.resize(indicesSize);
+
+  indices.push_back(getInt32Val(arrayField->memberIndex()));
+  indices.push_back(getInt32Val(0));
+  llvm::Constant * elementOffset = llvm::ConstantExpr::getInBoundsGetElementPtr(basePtr, indices);
+  elementOffset = llvm::ConstantExpr::getPtrToInt(elementOffset, builder_.getInt32Ty());
+  indices.resize(indicesSize);
+
+  // Reference elements are traced directly; value elements use their own trace table.
+  llvm::PointerType * traceTablePtrType =
+      cast<llvm::PointerType>(tib_traceTable->type()->irType());
+  llvm::Constant * elementTraceTable = llvm::ConstantPointerNull::get(traceTablePtrType);
+  if (!elementType->isReferenceType()) {
+    elementTraceTable = llvm::ConstantExpr::getPointerCast(
+        getTraceTable(elementType), traceTablePtrType);
+  }
+
+  // Matches the layout of tart.gc.ArrayTraceInfo.
+  StructBuilder sbInfo(*this);
+  sbInfo.addField(lengthOffset);
+  sbInfo.addField(getInt32Val(lengthSize));
+  sbInfo.addField(llvm::ConstantExpr::getTruncOrBitCast(
+      llvm::ConstantExpr::getSizeOf(elementType->irEmbeddedType()), builder_.getInt32Ty()));
+  sbInfo.addField(elementTraceTable);
+  llvm::Constant * info = sbInfo.buildAnon();
+
+  llvm::SmallString<64> infoName(".arraytrace.");
+  typeLinkageName(infoName, arrayField->definingClass());
+  GlobalVariable * infoVar = new GlobalVariable(*irModule_,
+      info->getType(), true, GlobalValue::LinkOnceODRLinkage, info, Twine(infoName));
+
+  llvm::PointerType * fieldOffsetArrayType = intPtrType_->getPointerTo();
+  StructBuilder sbEntry(*this);
+  sbEntry.addField(getInt16Val(TRACE_DESC_ARRAY));
+  sbEntry.addField(getInt16Val(0));
+  sbEntry.addField(elementOffset);
+  sbEntry.addField(llvm::ConstantExpr::getPointerCast(infoVar, fieldOffsetArrayType));
+  traceTable.push_back(sbEntry.build(Builtins::typeTraceDescriptor));
+}
+
+void CodeGenerator::createRefOrVoidTraceTableEntry(const UnionType * utype,
+    llvm::Constant * basePtr, ConstantList & traceTable, ConstantList & indices) {
+  int voidIndex = utype->getTypeIndex(&VoidType::instance);
+  DASSERT(voidIndex >= 0);
+
+  // The descriptor's offset is that of the discriminator; the offset of the reference,
+  // relative to the discriminator, is the single entry in the field offset table.
+  llvm::Constant * discOffset = llvm::ConstantExpr::getInBoundsGetElementPtr(basePtr, indices);
+  discOffset = llvm::ConstantExpr::getPtrToInt(discOffset, builder_.getInt32Ty());
+
+  llvm::Constant * unionBase = llvm::ConstantPointerNull::get(utype->irType()->getPointerTo());
+  llvm::Constant * valueIndices[2] = { getInt32Val(0), getInt32Val(1) };
+  llvm::Constant * valueOffset =
+      llvm::ConstantExpr::getInBoundsGetElementPtr(unionBase, valueIndices);
+  valueOffset = llvm::ConstantExpr::getPtrToInt(valueOffset, intPtrType_);
+
+  llvm::SmallString<64> offsetsName(".uoffsets.");
+  typeLinkageName(offsetsName, utype);
+  GlobalVariable * offsetsVar = irModule_->getGlobalVariable(offsetsName, true);
+  if (offsetsVar == NULL) {
+    llvm::Constant * offsets = ConstantArray::get(
+        llvm::ArrayType::get(intPtrType_, 1), llvm::ArrayRef<llvm::Constant *>(valueOffset));
+    offsetsVar = new GlobalVariable(*irModule_, offsets->getType(), true,
+        GlobalValue::LinkOnceODRLinkage, offsets, Twine(offsetsName));
+  }
+
+  llvm::PointerType * fieldOffsetArrayType = intPtrType_->getPointerTo();
+  StructBuilder sbEntry(*this);
+  sbEntry.addField(getInt16Val(TRACE_DESC_VOID_OR_REF));
+  sbEntry.addField(getInt16Val(voidIndex));
+  sbEntry.addField(discOffset);
+  sbEntry.addField(llvm::ConstantExpr::getPointerCast(offsetsVar, fieldOffsetArrayType));
+  traceTable.push_back(sbEntry.build(Builtins::typeTraceDescriptor));
+}
+
 llvm::Function * CodeGenerator::getUnionTraceMethod(const UnionType * utype) {
   TraceMethodMap::const_iterator it = traceMethodMap_.find(utype);
   if (it != traceMethodMap_.end()) {
@@ -265,7 +265,8 @@ Constant * CodeGenerator::genMethodArray(const MethodList & methods) {
       }
     } else {
       DASSERT_OBJ(method->isSingular(), method);
-      if (method->isSynthetic() && module_->exportDefs().count(method) == 0) {
+      if (method->isSynthetic() && module_->exportDefs().count(method) == 0 &&
+          module_->importDefs().count(method) == 0) {
         diag.fatal() << Format_Verbose << "Attempting to refer to synthetic method " <<
             method << " but it has not been imported into the module.";
       }
@@ -695,6 +696,8 @@ llvm::Function * CodeGenerator::genCallAdapterFn(const FunctionType * fnType) {
     QualifiedType returnType = fnType->returnType();
     if (sret != NULL) {
       returnVal = sret;
+    } else if (fnType->isRegisterReturn()) {
+      returnVal = genReturnTemp(returnVal);
     }
 
     returnVal = genCast(returnVal, returnType.unqualified(), Builtins::typeObject);
@@ -0,0 +1,843 @@
+/* ================================================================ *
+    TART - A Sweet Programming Language.
+ * ================================================================ */
+
+#include "tart/Gen/FunctionCache.h"
+
+#include "tart/Defn/FunctionDefn.h"
+#include "tart/Defn/VariableDefn.h"
+#include "tart/Defn/Scope.h"
+
+#include "tart/Expr/Exprs.h"
+#include "tart/Expr/StmtExprs.h"
+#include "tart/Expr/Constant.h"
+
+#include "tart/Type/CompositeType.h"
+#include "tart/Type/FunctionType.h"
+
+#include "tart/Sema/CFGPass.h"
+
+#include "tart/Common/CompilerStats.h"
+#include "tart/Common/Diagnostics.h"
+
+#include "llvm/Constants.h"
+#include "llvm/Function.h"
+#include "llvm/GlobalAlias.h"
+#include "llvm/GlobalVariable.h"
+#include "llvm/Instructions.h"
+#include "llvm/LLVMContext.h"
+#include "llvm/Linker.h"
+#include "llvm/Module.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/system_error.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+#include "llvm/Transforms/Utils/ValueMapper.h"
+
+#include <algorithm>
+#include <stdio.h>
+
+namespace tart {
+
+using llvm::Function;
+using llvm::GlobalValue;
+using llvm::GlobalVariable;
+using llvm::Value;
+
+namespace {
+  /** Changing the code generator can change what is generated for the same input,
+      so this is part of every key. Bump it whenever such a change is made. */
+  const uint64_t CACHE_VERSION = 7;
+
+  const size_t NO_CUT = size_t(-1);
+
+  StatCounter numCacheHits("fncache-hits", "Functions loaded from the function cache");
+  StatCounter numCacheMisses("fncache-misses", "Functions not found in the function cache");
+  StatCounter numUncacheable("fncache-uncacheable", "Functions which can't be cached");
+  StatCounter numWriteErrors("fncache-write-errors",
+      "Functions which couldn't be written to the function cache");
+
+  /// -------------------------------------------------------------------
+  /// A 64-bit FNV-1a hash.
+  class KeyHasher {
+  public:
+    KeyHasher() : hash_(14695981039346656037ULL) {}
+
+    void add(uint64_t value) {
+      for (int i = 0; i < 8; ++i) {
+        addByte(uint8_t(value >> (i * 8)));
+      }
+    }
+
+    void add(StringRef str) {
+      add(uint64_t(str.size()));
+      for (StringRef::const_iterator it = str.begin(); it != str.end(); ++it) {
+        addByte(uint8_t(*it));
+      }
+    }
+
+    uint64_t get() const { return hash_; }
+
+  private:
+    uint64_t hash_;
+
+    void addByte(uint8_t b) {
+      hash_ ^= b;
+      hash_ *= 1099511628211ULL;
+    }
+  };
+
+  /// -------------------------------------------------------------------
+  /// Copies a function into another module, along with any linkonce
+  /// functions and constants it refers to. Everything else that it uses
+  /// is declared, and will be found by name when the copy is linked back.
+  class FunctionExtractor {
+  public:
+    FunctionExtractor(llvm::Module * module) : module_(module) {}
+
+    /** Copy 'fn'. Returns false if it refers to something which can't be moved
+        between modules by name. */
+    bool extract(Function * fn);
+
+  private:
+    llvm::Module * module_;
+    llvm::ValueToValueMapTy vmap_;
+    llvm::SmallPtrSet<const Value *, 64> seen_;
+    llvm::SmallVector<Function *, 8> bodies_;
+    llvm::SmallVector<GlobalVariable *, 8> vars_;
+
+    bool visitBody(Function * fn);
+    bool visitValue(Value * v);
+    bool visitGlobal(GlobalValue * gv);
+    Function * declare(Function * fn);
+    GlobalVariable * declare(GlobalVariable * gv);
+  };
+
+  bool FunctionExtractor::extract(Function * fn) {
+    seen_.insert(fn);
+    declare(fn);
+    bodies_.push_back(fn);
+
+    // Copying a body may add more bodies to copy.
+    for (size_t i = 0; i < bodies_.size(); ++i) {
+      if (!visitBody(bodies_[i])) {
+        return false;
+      }
+    }
+
+    for (size_t i = 0; i < vars_.size(); ++i) {
+      GlobalVariable * var = vars_[i];
+      GlobalVariable * copy = llvm::cast<GlobalVariable>(vmap_[var]);
+      copy->setInitializer(llvm::cast<llvm::Constant>(
+          llvm::MapValue(var->getInitializer(), vmap_)));
+    }
+
+    for (size_t i = 0; i < bodies_.size(); ++i) {
+      Function * f = bodies_[i];
+      Function * copy = llvm::cast<Function>(vmap_[f]);
+      Function::arg_iterator dest = copy->arg_begin();
+      for (Function::arg_iterator arg = f->arg_begin(); arg != f->arg_end(); ++arg, ++dest) {
+        dest->setName(arg->getName());
+        vmap_[arg] = dest;
+      }
+
+      llvm::SmallVector<llvm::ReturnInst *, 4> returns;
+      llvm::CloneFunctionInto(copy, f, vmap_, true, returns);
+      copy->setLinkage(f->getLinkage());
+    }
+
+    return true;
+  }
+
+  bool FunctionExtractor::visitBody(Function * fn) {
+    for (Function::iterator bb = fn->begin(); bb != fn->end(); ++bb) {
+      for (llvm::BasicBlock::iterator inst = bb->begin(); inst != bb->end(); ++inst) {
+        // Metadata refers to things by position, not by name.
+        if (inst->hasMetadata()) {
+          return false;
+        }
+
+        for (llvm::User::op_iterator op = inst->op_begin(); op != inst->op_end(); ++op) {
+          if (!visitValue(*op)) {
+            return false;
+          }
+        }
+      }
+    }
+
+    return true;
+  }
+
+  bool FunctionExtractor::visitValue(Value * v) {
+    if (v == NULL || !seen_.insert(v)) {
+      return true;
+    }
+
+    if (GlobalValue * gv = llvm::dyn_cast<GlobalValue>(v)) {
+      return visitGlobal(gv);
+    } else if (llvm::isa<llvm::MDNode>(v) || llvm::isa<llvm::BlockAddress>(v)) {
+      return false;
+    } else if (llvm::Constant * c = llvm::dyn_cast<llvm::Constant>(v)) {
+      for (llvm::User::op_iterator op = c->op_begin(); op != c->op_end(); ++op) {
+        if (!visitValue(*op)) {
+          return false;
+        }
+      }
+    }
+
+    return true;
+  }
+
+  bool FunctionExtractor::visitGlobal(GlobalValue * gv) {
+    if (Function * fn = llvm::dyn_cast<Function>(gv)) {
+      if (fn->isDeclaration()) {
+        declare(fn);
+      } else if (fn->hasLocalLinkage()) {
+        return false;
+      } else if (fn->hasLinkOnceLinkage() || fn->hasWeakLinkage()) {
+        declare(fn);
+        bodies_.push_back(fn);
+      } else {
+        declare(fn);
+      }
+
+      return true;
+    } else if (GlobalVariable * var = llvm::dyn_cast<GlobalVariable>(gv)) {
+      if (var->isDeclaration() || var->hasExternalLinkage()) {
+        declare(var);
+        return true;
+      } else if (var->isConstant() && var->hasInitializer() &&
+          (var->hasLocalLinkage() || var->hasLinkOnceLinkage() || var->hasWeakLinkage())) {
+        declare(var)->setLinkage(var->getLinkage());
+        vars_.push_back(var);
+        return visitValue(var->getInitializer());
+      }
+    }
+
+    // Aliases, and variables which hold state of their own.
+    return false;
+  }
+
+  Function * FunctionExtractor::declare(Function * fn) {
+    Function * copy = Function::Create(
+        fn->getFunctionType(), GlobalValue::ExternalLinkage, fn->getName(), module_);
+    copy->copyAttributesFrom(fn);
+    vmap_[fn] = copy;
+    return copy;
+  }
+
+  GlobalVariable * FunctionExtractor::declare(GlobalVariable * gv) {
+    GlobalVariable * copy = new GlobalVariable(*module_, gv->getType()->getElementType(),
+        gv->isConstant(), GlobalValue::ExternalLinkage, NULL, gv->getName(), NULL,
+        gv->isThreadLocal(), gv->getType()->getAddressSpace());
+    copy->copyAttributesFrom(gv);
+    vmap_[gv] = copy;
+    return copy;
+  }
+}
+
+/// -------------------------------------------------------------------
+/// Computes the cache key of a function, by walking its analyzed body.
+/// Other definitions are identified by their linkage names, and local
+/// variables by the order in which they are first seen, so that the key
+/// doesn't depend on anything which changes from one run to the next.
+class FunctionKeyBuilder : public CFGPass {
+public:
+  FunctionKeyBuilder(FunctionCache & cache) : cache_(cache), cacheable_(true) {}
+
+  void addFunction(const FunctionDefn * fdef);
+  void addLocal(const VariableDefn * var);
+  void addDefn(const Defn * de);
+  void addType(QualifiedType type);
+
+  bool cacheable() const { return cacheable_; }
+  KeyHasher & hasher() { return hasher_; }
+
+  Expr * visitExpr(Expr * in);
+  Expr * visitSeq(SeqExpr * in);
+  Expr * visitTupleCtor(TupleCtorExpr * in);
+  Expr * visitSharedValue(SharedValueExpr * in);
+
+private:
+  typedef llvm::DenseMap<const void *, unsigned> IdMap;
+
+  FunctionCache & cache_;
+  KeyHasher hasher_;
+  IdMap localIds_;
+  IdMap sharedIds_;
+  llvm::SmallPtrSet<const Defn *, 16> initValuesSeen_;
+  bool cacheable_;
+
+  enum Marker {
+    NULL_EXPR = 0x100,
+    END_EXPR,
+    NULL_TYPE,
+    LOCAL,
+    NONLOCAL
+  };
+};
+
+void FunctionKeyBuilder::addFunction(const FunctionDefn * fdef) {
+  hasher_.add(fdef->linkageName());
+  hasher_.add(fdef->flags());
+  hasher_.add(fdef->storageClass());
+  hasher_.add(cache_.layoutHash(fdef->functionType()));
+  hasher_.add(fdef->functionType()->isStructReturn());
+
+  const FunctionType * ftype = fdef->functionType();
+  if (ftype->selfParam() != NULL) {
+    addLocal(ftype->selfParam());
+  }
+
+  for (ParameterList::const_iterator it = ftype->params().begin();
+      it != ftype->params().end(); ++it) {
+    addLocal(*it);
+  }
+
+  for (LocalScopeList::const_iterator it = fdef->localScopes().begin();
+      it != fdef->localScopes().end(); ++it) {
+    for (Defn * de = (*it)->firstMember(); de != NULL; de = de->nextInScope()) {
+      addDefn(de);
+    }
+  }
+
+  visitExpr(fdef->body());
+}
+
+void FunctionKeyBuilder::addLocal(const VariableDefn * var) {
+  IdMap::iterator it = localIds_.find(var);
+  if (it != localIds_.end()) {
+    hasher_.add(LOCAL);
+    hasher_.add(it->second);
+    return;
+  }
+
+  unsigned id = localIds_.size();
+  localIds_[var] = id;
+  hasher_.add(LOCAL);
+  hasher_.add(id);
+  hasher_.add(var->defnType());
+  addType(var->type());
+  hasher_.add(var->flags());
+  hasher_.add(var->hasStorage());
+  hasher_.add(var->isSharedRef());
+  if (var->isSharedRef()) {
+    hasher_.add(cache_.layoutHash(var->sharedRefType()));
+  }
+
+  if (const ParameterDefn * param = llvm::dyn_cast<ParameterDefn>(var)) {
+    // LValueParam is left out, since it is set while the function is generated.
+    addType(param->internalType());
+    hasher_.add(param->getFlag(ParameterDefn::Variadic));
+    hasher_.add(param->getFlag(ParameterDefn::Reference));
+    hasher_.add(param->getFlag(ParameterDefn::KeywordOnly));
+  }
+
+  if (!var->hasStorage()) {
+    visitExpr(const_cast<Expr *>(var->initValue()));
+  }
+}
+
+void FunctionKeyBuilder::addDefn(const Defn * de) {
+  if (de == NULL) {
+    hasher_.add(NULL_EXPR);
+    return;
+  }
+
+  if (de->storageClass() == Storage_Local) {
+    if (const VariableDefn * var = llvm::dyn_cast<VariableDefn>(de)) {
+      addLocal(var);
+      return;
+    }
+
+    // Local functions and types are generated separately.
+    cacheable_ = false;
+    return;
+  }
+
+  hasher_.add(NONLOCAL);
+  hasher_.add(de->defnType());
+  hasher_.add(de->linkageName());
+  hasher_.add(de->storageClass());
+
+  if (const FunctionDefn * fn = llvm::dyn_cast<FunctionDefn>(de)) {
+    hasher_.add(cache_.layoutHash(fn->functionType()));
+    hasher_.add(fn->flags());
+    hasher_.add(uint64_t(int64_t(fn->dispatchIndex())));
+    if (fn->mergeTo() != NULL) {
+      hasher_.add(fn->mergeTo()->linkageName());
+    }
+  } else if (const VariableDefn * var = llvm::dyn_cast<VariableDefn>(de)) {
+    addType(var->type());
+    hasher_.add(var->flags());
+    hasher_.add(uint64_t(int64_t(var->memberIndex())));
+    hasher_.add(var->hasStorage());
+
+    // Constants without storage are generated in place, so their values are part
+    // of the code that uses them.
+    if (!var->hasStorage() && initValuesSeen_.insert(var)) {
+      visitExpr(const_cast<Expr *>(var->initValue()));
+    }
+  } else if (const ValueDefn * value = llvm::dyn_cast<ValueDefn>(de)) {
+    addType(value->type());
+  }
+}
+
+void FunctionKeyBuilder::addType(QualifiedType type) {
+  if (type.isNull()) {
+    hasher_.add(NULL_TYPE);
+    return;
+  }
+
+  hasher_.add(type.qualifiers());
+  hasher_.add(cache_.layoutHash(type.unqualified()));
+}
+
+Expr * FunctionKeyBuilder::visitExpr(Expr * in) {
+  if (in == NULL) {
+    hasher_.add(NULL_EXPR);
+    return NULL;
+  }
+
+  hasher_.add(in->exprType());
+  addType(in->type());
+
+  switch (in->exprType()) {
+    case Expr::ConstInt: {
+      const llvm::APInt & value = static_cast<ConstantInteger *>(in)->value()->getValue();
+      hasher_.add(value.getBitWidth());
+      for (unsigned i = 0; i < value.getNumWords(); ++i) {
+        hasher_.add(value.getRawData()[i]);
+      }
+      break;
+    }
+
+    case Expr::ConstFloat: {
+      llvm::APInt value =
+          static_cast<ConstantFloat *>(in)->value()->getValueAPF().bitcastToAPInt();
+      hasher_.add(value.getBitWidth());
+      for (unsigned i = 0; i < value.getNumWords(); ++i) {
+        hasher_.add(value.getRawData()[i]);
+      }
+      break;
+    }
+
+    case Expr::ConstString:
+      hasher_.add(static_cast<ConstantString *>(in)->value());
+      break;
+
+    case Expr::TypeLiteral:
+      addType(static_cast<TypeLiteralExpr *>(in)->value());
+      break;
+
+    case Expr::LValue:
+      addDefn(static_cast<LValueExpr *>(in)->value());
+      break;
+
+    case Expr::BoundMethod:
+      addDefn(static_cast<BoundMethodExpr *>(in)->method());
+      break;
+
+    case Expr::FnCall:
+    case Expr::CtorCall:
+    case Expr::VTableCall:
+      addDefn(static_cast<FnCallExpr *>(in)->function());
+      break;
+
+    case Expr::BinaryOpcode:
+      hasher_.add(static_cast<BinaryOpcodeExpr *>(in)->opCode());
+      break;
+
+    case Expr::Compare:
+      hasher_.add(static_cast<CompareExpr *>(in)->predicate());
+      break;
+
+    case Expr::InstanceOf:
+      hasher_.add(cache_.layoutHash(static_cast<InstanceOfExpr *>(in)->toType()));
+      break;
+
+    // Whether an allocation goes on the stack depends on what escape analysis found in
+    // the bodies of the functions it's passed to, which are not part of the key - so
+    // the decision itself has to be.
+    case Expr::New:
+      hasher_.add(static_cast<NewExpr *>(in)->isStackAlloc());
+      break;
+
+    case Expr::ArrayLiteral:
+      hasher_.add(static_cast<ArrayLiteralExpr *>(in)->isStackAlloc());
+      break;
+
+    case Expr::InitVar:
+      addDefn(static_cast<InitVarExpr *>(in)->var());
+      break;
+
+    case Expr::ClearVar:
+      addDefn(static_cast<ClearVarExpr *>(in)->var());
+      break;
+
+    case Expr::Catch:
+      addDefn(static_cast<CatchExpr *>(in)->var());
+      break;
+
+    // These hold values which only exist in this run of the compiler, or should
+    // have been removed by analysis.
+    case Expr::Invalid:
+    case Expr::IRValue:
+    case Expr::ClosureEnv:
+    case Expr::With:
+    case Expr::PatternVar:
+    case Expr::TypeName:
+    case Expr::Call:
+    case Expr::SuperCall:
+    case Expr::Construct:
+    case Expr::Specialize:
+      cacheable_ = false;
+      return in;
+
+    default:
+      break;
+  }
+
+  CFGPass::visitExpr(in);
+  hasher_.add(END_EXPR);
+  return in;
+}
+
+// The base class versions of these update the expression's type.
+
+Expr * FunctionKeyBuilder::visitSeq(SeqExpr * in) {
+  visitExprArgs(in);
+  return in;
+}
+
+Expr * FunctionKeyBuilder::visitTupleCtor(TupleCtorExpr * in) {
+  visitExprArgs(in);
+  return in;
+}
+
+Expr * FunctionKeyBuilder::visitSharedValue(SharedValueExpr * in) {
+  IdMap::iterator it = sharedIds_.find(in);
+  if (it != sharedIds_.end()) {
+    hasher_.add(it->second);
+    return in;
+  }
+
+  unsigned id = sharedIds_.size();
+  sharedIds_[in] = id;
+  hasher_.add(id);
+  visitExpr(in->arg());
+  return in;
+}
+
+/// -------------------------------------------------------------------
+/// FunctionCache
+
+FunctionCache::FunctionCache(StringRef dir, StringRef options, llvm::Module * irModule)
+  : dir_(dir)
+  , options_(options)
+  , irModule_(irModule)
+  , cutDepth_(NO_CUT)
+  , writeFailed_(false)
+{}
+
+FunctionCache::~FunctionCache() {
+  for (llvm::StringMap<llvm::Module *>::iterator it = loads_.begin(); it != loads_.end(); ++it) {
+    delete it->second;
+  }
+}
+
+uint64_t FunctionCache::key(const FunctionDefn * fdef, const llvm::Function * fn) {
+  FunctionKeyBuilder builder(*this);
+  KeyHasher & hasher = builder.hasher();
+  hasher.add(CACHE_VERSION);
+  hasher.add(options_);
+  hasher.add(irModule_->getDataLayout());
+  hasher.add(irModule_->getTargetTriple());
+  hasher.add(fn->getName());
+  hasher.add(fn->getLinkage());
+  hasher.add(fn->hasGC() ? StringRef(fn->getGC()) : StringRef());
+  builder.addFunction(fdef);
+
+  if (!builder.cacheable()) {
+    ++numUncacheable;
+    return 0;
+  }
+
+  // Zero means 'no key'.
+  return hasher.get() != 0 ? hasher.get() : 1;
+}
+
+bool FunctionCache::load(uint64_t key, llvm::Function * fn) {
+  if (loads_.count(fn->getName())) {
+    return true;
+  }
+
+  llvm::OwningPtr<llvm::MemoryBuffer> buffer;
+  if (llvm::MemoryBuffer::getFile(entryPath(key), buffer)) {
+    ++numCacheMisses;
+    return false;
+  }
+
+  std::string errMsg;
+  llvm::Module * entry = llvm::ParseBitcodeFile(buffer.get(), irModule_->getContext(), &errMsg);
+  if (entry == NULL) {
+    ++numCacheMisses;
+    return false;
+  }
+
+  llvm::Function * cached = entry->getFunction(fn->getName());
+  if (cached == NULL || cached->isDeclaration()) {
+    delete entry;
+    ++numCacheMisses;
+    return false;
+  }
+
+  // Until the body is linked in, 'fn' is a declaration.
+  fn->setLinkage(GlobalValue::ExternalLinkage);
+  loads_[fn->getName()] = entry;
+  ++numCacheHits;
+  return true;
+}
+
+void FunctionCache::add(uint64_t key, llvm::Function * fn) {
+  stores_.push_back(std::make_pair(key, fn));
+}
+
+void FunctionCache::finish() {
+  for (PendingList::iterator it = stores_.begin(); it != stores_.end(); ++it) {
+    switch (store(it->first, it->second)) {
+      case Stored:
+        break;
+
+      case Uncacheable:
+        ++numUncacheable;
+        break;
+
+      case WriteFailed:
+        ++numWriteErrors;
+        break;
+    }
+  }
+
+  stores_.clear();
+  if (loads_.empty()) {
+    return;
+  }
+
+  // The linker replaces each declaration with a new function at the end of the module.
+  // Remember the order of the functions, so that the output is the same as if none
+  // of them had come from the cache.
+  std::vector<std::string> order;
+  for (llvm::Module::iterator fn = irModule_->begin(); fn != irModule_->end(); ++fn) {
+    order.push_back(fn->getName());
+  }
+
+  for (llvm::StringMap<llvm::Module *>::iterator it = loads_.begin(); it != loads_.end(); ++it) {
+    llvm::Module * entry = it->second;
+    llvm::Function * fn = irModule_->getFunction(it->getKey());
+    if (fn != NULL) {
+      fn->setLinkage(GlobalValue::ExternalLinkage);
+    }
+
+    std::string errMsg;
+    if (llvm::Linker::LinkModules(irModule_, entry, llvm::Linker::DestroySource, &errMsg)) {
+      diag.error() << "Can't link function '" << it->getKey() <<
+          "' from the function cache: " << errMsg;
+    }
+
+    delete entry;
+  }
+
+  loads_.clear();
+
+  llvm::Module::FunctionListType & functions = irModule_->getFunctionList();
+  for (std::vector<std::string>::const_iterator it = order.begin(); it != order.end(); ++it) {
+    if (Function * fn = irModule_->getFunction(*it)) {
+      functions.splice(functions.end(), functions, fn);
+    }
+  }
+}
+
+uint64_t FunctionCache::nameHash(const Type * type) {
+  if (type == NULL) {
+    return 0;
+  }
+
+  TypeHashMap::iterator it = nameHashes_.find(type);
+  if (it != nameHashes_.end()) {
+    return it->second;
+  }
+
+  StrFormatStream fs;
+  fs.setFormatOptions(Format_Verbose);
+  fs << type;
+
+  KeyHasher hasher;
+  hasher.add(type->typeClass());
+  hasher.add(fs.str());
+  nameHashes_[type] = hasher.get();
+  return hasher.get();
+}
+
+uint64_t FunctionCache::layoutHash(const Type * type) {
+  if (type == NULL) {
+    return 0;
+  }
+
+  TypeHashMap::iterator it = layoutHashes_.find(type);
+  if (it != layoutHashes_.end()) {
+    return it->second;
+  }
+
+  // A type which contains itself is represented by its name the second time.
+  for (size_t i = 0; i < layoutStack_.size(); ++i) {
+    if (layoutStack_[i] == type) {
+      cutDepth_ = std::min(cutDepth_, i);
+      return nameHash(type);
+    }
+  }
+
+  size_t depth = layoutStack_.size();
+  layoutStack_.push_back(type);
+
+  KeyHasher hasher;
+  hasher.add(nameHash(type));
+  if (const CompositeType * ctype = llvm::dyn_cast<CompositeType>(type)) {
+    hasher.add(layoutHash(ctype->super()));
+    for (ClassList::const_iterator it = ctype->bases().begin(); it != ctype->bases().end(); ++it) {
+      hasher.add(nameHash(*it));
+    }
+
+    // Fields of reference type are pointers, whatever they point to.
+    for (DefnList::const_iterator it = ctype->instanceFields().begin();
+        it != ctype->instanceFields().end(); ++it) {
+      const VariableDefn * field = llvm::dyn_cast_or_null<VariableDefn>(*it);
+      if (field == NULL) {
+        hasher.add(0);
+        continue;
+      }
+
+      QualifiedType fieldType = field->type();
+      hasher.add(field->name());
+      hasher.add(fieldType.qualifiers());
+      hasher.add(fieldType->isReferenceType()
+          ? nameHash(fieldType.unqualified()) : layoutHash(fieldType.unqualified()));
+    }
+
+    for (MethodList::const_iterator it = ctype->instanceMethods().begin();
+        it != ctype->instanceMethods().end(); ++it) {
+      hasher.add(*it != NULL ? (*it)->linkageName() : StringRef());
+    }
+
+    hasher.add(ctype->isFinal());
+    hasher.add(ctype->isAbstract());
+  } else if (const FunctionType * ftype = llvm::dyn_cast<FunctionType>(type)) {
+    hasher.add(ftype->returnType().qualifiers());
+    hasher.add(layoutHash(ftype->returnType().unqualified()));
+    for (ParameterList::const_iterator it = ftype->params().begin();
+        it != ftype->params().end(); ++it) {
+      QualifiedType paramType = (*it)->type();
+      hasher.add(paramType.qualifiers());
+      hasher.add(layoutHash(paramType.unqualified()));
+      hasher.add((*it)->isVariadic());
+      hasher.add((*it)->isReference());
+      hasher.add((*it)->isKeywordOnly());
+    }
+
+    if (ftype->selfParam() != NULL) {
+      hasher.add(layoutHash(ftype->selfParam()->type().unqualified()));
+    }
+  } else {
+    for (size_t i = 0; i < type->numTypeParams(); ++i) {
+      QualifiedType param = type->typeParam(i);
+      hasher.add(param.qualifiers());
+      hasher.add(layoutHash(param.unqualified()));
+    }
+  }
+
+  layoutStack_.pop_back();
+
+  // If the hash was cut short at a type further out, it depends on where the
+  // walk started, so it can't be reused.
+  if (cutDepth_ == NO_CUT || cutDepth_ >= depth) {
+    layoutHashes_[type] = hasher.get();
+    cutDepth_ = NO_CUT;
+  }
+
+  return hasher.get();
+}
+
+std::string FunctionCache::entryPath(uint64_t key) const {
+  char name[24];
+  snprintf(name, sizeof(name), "%016llx.bc", (unsigned long long) key);
+  llvm::sys::Path path(dir_);
+  path.appendComponent(name);
+  return path.str();
+}
+
+FunctionCache::StoreResult FunctionCache::store(uint64_t key, llvm::Function * fn) {
+  // After one failure, the rest would almost certainly fail in the same way.
+  if (writeFailed_) {
+    return WriteFailed;
+  }
+
+  llvm::OwningPtr<llvm::Module> entry(
+      new llvm::Module(fn->getName(), irModule_->getContext()));
+  entry->setDataLayout(irModule_->getDataLayout());
+  entry->setTargetTriple(irModule_->getTargetTriple());
+
+  FunctionExtractor extractor(entry.get());
+  if (!extractor.extract(fn)) {
+    return Uncacheable;
+  }
+
+  std::string errMsg;
+  llvm::sys::Path dir(dir_);
+  if (!dir.exists() && dir.createDirectoryOnDisk(true, &errMsg)) {
+    return writeFailed("Can't create function cache directory '" + dir_ + "'", errMsg);
+  }
+
+  // Write to a temporary file first, so that a concurrent compile never sees part
+  // of an entry.
+  llvm::sys::Path tempPath(entryPath(key));
+  tempPath.appendSuffix("tmp");
+  if (tempPath.makeUnique(false, &errMsg)) {
+    return writeFailed("Can't create a temporary file in function cache directory '" +
+        dir_ + "'", errMsg);
+  }
+
+  {
+    llvm::raw_fd_ostream out(tempPath.c_str(), errMsg, llvm::raw_fd_ostream::F_Binary);
+    if (!errMsg.empty()) {
+      return writeFailed("Can't open '" + tempPath.str() + "'", errMsg);
+    }
+
+    llvm::WriteBitcodeToFile(entry.get(), out);
+    out.close();
+    if (out.has_error()) {
+      out.clear_error();
+      tempPath.eraseFromDisk(false, NULL);
+      return writeFailed("Can't write '" + tempPath.str() + "'", "I/O error");
+    }
+  }
+
+  if (tempPath.renamePathOnDisk(llvm::sys::Path(entryPath(key)), &errMsg)) {
+    tempPath.eraseFromDisk(false, NULL);
+    return writeFailed("Can't rename '" + tempPath.str() + "'", errMsg);
+  }
+
+  return Stored;
+}
+
+FunctionCache::StoreResult FunctionCache::writeFailed(
+    const std::string & what, const std::string & errMsg) {
+  diag.warn() << what << ": " << errMsg << " - no more functions will be cached.";
+  writeFailed_ = true;
+  return WriteFailed;
+}
+
+}
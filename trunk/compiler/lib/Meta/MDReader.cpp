@@ -4,6 +4,8 @@
 
 #include "tart/AST/Stmt.h"
 
+#include "tart/Common/CompilerStats.h"
+#include "tart/Common/IdentTable.h"
 #include "tart/Common/Diagnostics.h"
 
 #include "tart/Defn/Module.h"
@@ -40,6 +42,9 @@ namespace tart {
 
 using namespace llvm;
 
+static StatCounter numDefnsRead("md-defns-read", "Definitions read from metadata");
+static StatCounter numBodiesRead("md-bodies-read", "Function bodies read from metadata");
+
 // -------------------------------------------------------------------
 // NodeRef
 
@@ -260,6 +265,7 @@ bool MDReader::readMembers(NodeRef members, Scope * scope, Defn * parentDefn) {
 
 Defn * MDReader::readMember(NodeRef node, Scope * parent, StorageClass storage) {
   diag.recovered();
+  ++numDefnsRead;
 
   // Read the definition type
   meta::Defn::Tag tag = meta::Defn::Tag(node.intArg(FIELD_DEFN_TYPE));
@@ -324,7 +330,7 @@ Defn * MDReader::readMember(NodeRef node, Scope * parent, StorageClass storage)
         case meta::Defn::PROTOCOL: tc = Type::Protocol; break;
       }
 
-      TypeDefn * tdef = new TypeDefn(module_, module_->internString(name));
+      TypeDefn * tdef = new TypeDefn(module_, IdentTable::intern(name));
       tdef->setLocation(location);
       tdef->setVisibility(visibility);
 
@@ -352,7 +358,7 @@ Defn * MDReader::readMember(NodeRef node, Scope * parent, StorageClass storage)
     }
 
     case meta::Defn::ENUM: {
-      TypeDefn * tdef = new TypeDefn(module_, module_->internString(name));
+      TypeDefn * tdef = new TypeDefn(module_, IdentTable::intern(name));
       tdef->setVisibility(visibility);
       tdef->setLocation(location);
 
@@ -369,7 +375,7 @@ Defn * MDReader::readMember(NodeRef node, Scope * parent, StorageClass storage)
     }
 
     case meta::Defn::TYPEALIAS: {
-      TypeDefn * tdef = new TypeDefn(module_, module_->internString(name));
+      TypeDefn * tdef = new TypeDefn(module_, IdentTable::intern(name));
       tdef->setLocation(location);
       tdef->setVisibility(visibility);
       tdef->setStorageClass(storage);
@@ -383,7 +389,7 @@ Defn * MDReader::readMember(NodeRef node, Scope * parent, StorageClass storage)
     }
 
     case meta::Defn::NAMESPACE: {
-      NamespaceDefn * ns = new NamespaceDefn(module_, module_->internString(name));
+      NamespaceDefn * ns = new NamespaceDefn(module_, IdentTable::intern(name));
       ns->setLocation(location);
       ns->setVisibility(visibility);
       ns->setMDNode(node.node());
@@ -400,7 +406,7 @@ Defn * MDReader::readMember(NodeRef node, Scope * parent, StorageClass storage)
     case meta::Defn::MACRO: {
       FunctionDefn * fn = new FunctionDefn(
           tag == meta::Defn::MACRO ? Defn::Macro : Defn::Function, module_,
-              module_->internString(name));
+              IdentTable::intern(name));
       fn->setLocation(location);
       fn->setVisibility(visibility);
       fn->setStorageClass(storage);
@@ -444,7 +450,7 @@ Defn * MDReader::readMember(NodeRef node, Scope * parent, StorageClass storage)
     }
 
     case meta::Defn::PARAM: {
-      ParameterDefn * param = new ParameterDefn(module_, module_->internString(name));
+      ParameterDefn * param = new ParameterDefn(module_, IdentTable::intern(name));
       param->setLocation(location);
       const Type * type = readTypeRef(node.strArg(FIELD_PARAM_TYPE));
       if (type == NULL) {
@@ -477,7 +483,7 @@ Defn * MDReader::readMember(NodeRef node, Scope * parent, StorageClass storage)
     }
 
     case meta::Defn::PROPERTY: {
-      PropertyDefn * prop = new PropertyDefn(Defn::Property, module_, module_->internString(name));
+      PropertyDefn * prop = new PropertyDefn(Defn::Property, module_, IdentTable::intern(name));
       prop->setLocation(location);
       prop->setVisibility(visibility);
       prop->setStorageClass(storage);
@@ -486,7 +492,7 @@ Defn * MDReader::readMember(NodeRef node, Scope * parent, StorageClass storage)
     }
 
     case meta::Defn::INDEXER: {
-      IndexerDefn * idx = new IndexerDefn(Defn::Indexer, module_, module_->internString(name));
+      IndexerDefn * idx = new IndexerDefn(Defn::Indexer, module_, IdentTable::intern(name));
       idx->setLocation(location);
       idx->setVisibility(visibility);
       idx->setStorageClass(storage);
@@ -497,7 +503,7 @@ Defn * MDReader::readMember(NodeRef node, Scope * parent, StorageClass storage)
     case meta::Defn::VARIABLE:
     case meta::Defn::LET: {
       VariableDefn * var = new VariableDefn(tag == meta::Defn::LET ? Defn::Let : Defn::Var,
-          module_, module_->internString(name));
+          module_, IdentTable::intern(name));
       var->setLocation(location);
       var->setVisibility(visibility);
       var->setStorageClass(storage);
@@ -597,7 +603,7 @@ bool MDReader::readEnumConstants(TypeDefn * tdef) {
       return false;
     }
 
-    VariableDefn * var = new VariableDefn(Defn::Let, module_, module_->internString(name), value);
+    VariableDefn * var = new VariableDefn(Defn::Let, module_, IdentTable::intern(name), value);
     var->setStorageClass(Storage_Static);
     var->setType(ety);
     var->setLocation(tdef->location());
@@ -655,6 +661,7 @@ const Stmt * MDReader::readFunctionBody(FunctionDefn * fn) {
   if (astStr.empty()) {
     return NULL;
   }
+  ++numBodiesRead;
   //diag.debug() << Format_QualifiedName << "Reading body for: " << fn;
   ASTReader reader(fn->location(), module_->moduleStrings(), astStr);
   return cast_or_null<Stmt>(reader.read());
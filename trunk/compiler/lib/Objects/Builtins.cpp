@@ -15,6 +15,7 @@
 #include "tart/Objects/Builtins.h"
 #include "tart/Objects/SystemDefs.h"
 
+#include "tart/Common/CompilerStats.h"
 #include "tart/Common/PackageMgr.h"
 #include "tart/Common/Diagnostics.h"
 #include "tart/Sema/AnalyzerBase.h"
@@ -75,6 +76,7 @@ SystemClass Builtins::typeFieldList("tart.reflect.FieldList");
 SystemClass Builtins::typeAttribute("tart.core.Attribute");
 SystemClass Builtins::typeIntrinsicAttribute("tart.annex.Intrinsic");
 
+SystemClass Builtins::typeAllocContext("tart.gc.AllocContext");
 SystemClass Builtins::typeStaticRoot("tart.gc.StaticRoot");
 SystemClass Builtins::typeTraceAction("tart.gc.TraceAction");
 SystemClass Builtins::typeTraceDescriptor("tart.gc.TraceDescriptor");
@@ -202,6 +204,7 @@ void Builtins::loadSystemClasses() {
 }
 
 bool Builtins::compileBuiltins(ProgramSource & source) {
+  PhaseScope scope(Phase::Parse);
   Parser parser(&source, &module);
   return parser.parse();
 }
@@ -1027,6 +1027,26 @@ Expr * NoInlineApplyIntrinsic::eval(const SourceLocation & loc, Module * calling
   return args[0];
 }
 
+// -------------------------------------------------------------------
+// NoEscapeApplyIntrinsic
+NoEscapeApplyIntrinsic NoEscapeApplyIntrinsic::instance;
+
+Expr * NoEscapeApplyIntrinsic::eval(const SourceLocation & loc, Module * callingModule,
+    const FunctionDefn * method, Expr * self, const ExprList & args, Type * expectedReturn) const {
+  assert(args.size() == 1);
+  if (LValueExpr * lval = dyn_cast<LValueExpr>(args[0])) {
+    if (FunctionDefn * fn = dyn_cast<FunctionDefn>(lval->value())) {
+      // Parameter types aren't resolved yet, so a function without a variadic
+      // parameter is not diagnosed here; the flag simply has no effect.
+      fn->setFlag(FunctionDefn::NoEscapeVarArgs, true);
+      return args[0];
+    }
+  }
+
+  diag.error(loc) << "Invalid target for 'NoEscape'";
+  return args[0];
+}
+
 // -------------------------------------------------------------------
 // AssociativeApplyIntrinsic
 AssociativeApplyIntrinsic AssociativeApplyIntrinsic::instance;
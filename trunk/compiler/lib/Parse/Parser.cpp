@@ -5,6 +5,7 @@
 #include "tart/Parse/Parser.h"
 #include "tart/Parse/OperatorStack.h"
 #include "tart/Common/Diagnostics.h"
+#include "tart/Common/IdentTable.h"
 #include "tart/AST/Stmt.h"
 #include "tart/Type/PrimitiveType.h"
 #include "tart/Type/NativeType.h"
@@ -93,8 +94,8 @@ inline bool Parser::match(TokenType tok) {
 
 StringRef Parser::matchIdent() {
   if (token == Token_Ident) {
-    // Save the token value as a string
-    StringRef value = module->internString(lexer.tokenValue());
+    // Save the token value as an identifier
+    StringRef value = IdentTable::intern(lexer.tokenValue());
 
     // Get the next token
     next();
@@ -102,10 +103,10 @@ StringRef Parser::matchIdent() {
   } else if (token == Token_Get) {
     // 'get' and 'set' are allowed as identifiers except in accessor lists.
     next();
-    return module->internString("get");
+    return IdentTable::intern("get");
   } else if (token == Token_Set) {
     next();
-    return module->internString("set");
+    return IdentTable::intern("set");
   }
   return StringRef();
 }
@@ -964,7 +965,7 @@ bool Parser::accessorMethodList(ASTPropertyDecl * parent,
       }
 
       ASTFunctionDecl * fc = new ASTFunctionDecl(ASTNode::Function, loc,
-          module->internString(accessorName), params, (ASTNode *)NULL, mods);
+          IdentTable::intern(accessorName), params, (ASTNode *)NULL, mods);
       fc->attributes().append(attributes.begin(), attributes.end());
 
 #if 0
@@ -33,6 +33,7 @@
 #include "tart/Type/TypeLiteral.h"
 #include "tart/Type/TypeRelation.h"
 
+#include "tart/Common/CompilerStats.h"
 #include "tart/Common/PackageMgr.h"
 #include "tart/Common/Diagnostics.h"
 
@@ -45,6 +46,7 @@ llvm::cl::opt<std::string> AnalyzerBase::traceDef_("trace-def",
     llvm::cl::desc("Enable debugging messages for this definition"),
     llvm::cl::value_desc("defn-name"),
     llvm::cl::init("-"));
+Diagnostics::DebugOption AnalyzerBase::traceDefDebug_(traceDef_);
 
 class RecursionGuard {
 public:
@@ -807,6 +809,7 @@ bool AnalyzerBase::analyzeType(const Type * in, AnalysisTask task) {
 }
 
 bool AnalyzerBase::analyzeModule(Module * mod) {
+  PhaseScope scope(Phase::Analyze);
   DefnAnalyzer da(mod, mod, mod, NULL);
   return da.analyzeModule();
 }
@@ -34,6 +34,7 @@
 
 static llvm::cl::opt<bool>
 DebugUnify("debug-unify", llvm::cl::desc("Debug unification"), llvm::cl::init(false));
+static tart::Diagnostics::DebugOption DebugUnifyDebug(DebugUnify);
 
 namespace tart {
 
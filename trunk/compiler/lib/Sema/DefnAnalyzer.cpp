@@ -114,6 +114,7 @@ bool DefnAnalyzer::analyzeModule() {
     analyzeFunction(Builtins::funcDispatchError, Task_PrepTypeGeneration);
     analyzeFunction(gc_allocContext, Task_PrepCodeGeneration);
     analyzeFunction(gc_alloc, Task_PrepConstruction);
+    analyzeType(Builtins::typeAllocContext.get(), Task_PrepConstruction);
   }
   analyzeDefn(reflect::FunctionType::CallAdapterFnType.get(), Task_PrepCodeGeneration);
 
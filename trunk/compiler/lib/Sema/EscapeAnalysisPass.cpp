@@ -0,0 +1,291 @@
+/* ================================================================ *
+    TART - A Sweet Programming Language.
+ * ================================================================ */
+
+#include "tart/Expr/Exprs.h"
+#include "tart/Expr/StmtExprs.h"
+#include "tart/Type/CompositeType.h"
+#include "tart/Type/FunctionType.h"
+#include "tart/Defn/FunctionDefn.h"
+#include "tart/Defn/VariableDefn.h"
+
+#include "tart/Sema/EscapeAnalysisPass.h"
+#include "tart/Sema/AnalyzerBase.h"
+
+#include "tart/Common/CodeGenOption.h"
+#include "tart/Common/Diagnostics.h"
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/CommandLine.h"
+
+static tart::CodeGenOption<bool>
+NoStackAlloc("no-stack-alloc",
+    llvm::cl::desc("Allocate all objects on the heap, even if they don't escape"));
+
+namespace tart {
+
+namespace {
+
+/// -------------------------------------------------------------------
+/// Collects local variables which are initialized with a newly
+/// constructed object.
+class FindStackCandidatesPass : public CFGPass {
+public:
+  typedef llvm::SmallVector<InitVarExpr *, 8> CandidateList;
+
+  FindStackCandidatesPass(CandidateList & candidates) : candidates_(candidates) {}
+
+  Expr * visitInitVar(InitVarExpr * in) {
+    VariableDefn * var = in->var();
+    if (var->storageClass() == Storage_Local && !var->isSharedRef() &&
+        in->initExpr()->exprType() == Expr::CtorCall) {
+      FnCallExpr * ctorCall = static_cast<FnCallExpr *>(in->initExpr());
+      if (NewExpr * newExpr = dyn_cast_or_null<NewExpr>(ctorCall->selfArg())) {
+        if (newExpr->type()->typeClass() == Type::Class) {
+          candidates_.push_back(in);
+        }
+      }
+    }
+
+    return CFGPass::visitInitVar(in);
+  }
+
+private:
+  CandidateList & candidates_;
+};
+
+/// -------------------------------------------------------------------
+/// Collects calls which pass a newly built array to a variadic parameter.
+class FindVarArgsCallsPass : public CFGPass {
+public:
+  typedef llvm::SmallVector<std::pair<FnCallExpr *, ArrayLiteralExpr *>, 8> CallList;
+
+  FindVarArgsCallsPass(CallList & calls) : calls_(calls) {}
+
+  Expr * visitFnCall(FnCallExpr * in) {
+    if (in->function() != NULL) {
+      const ParameterList & params = in->function()->functionType()->params();
+      for (size_t i = 0; i < params.size() && i < in->args().size(); ++i) {
+        if (params[i]->isVariadic()) {
+          // Empty argument lists already share a static instance.
+          ArrayLiteralExpr * arrayArg = dyn_cast<ArrayLiteralExpr>(in->args()[i]);
+          if (arrayArg != NULL && !arrayArg->args().empty()) {
+            calls_.push_back(std::make_pair(in, arrayArg));
+          }
+          break;
+        }
+      }
+    }
+
+    return CFGPass::visitFnCall(in);
+  }
+
+private:
+  CallList & calls_;
+};
+
+}
+
+/// -------------------------------------------------------------------
+/// EscapeAnalysisPass
+
+void EscapeAnalysisPass::run(FunctionDefn * fn) {
+  if (NoStackAlloc || fn->body() == NULL) {
+    return;
+  }
+
+  FindStackCandidatesPass::CandidateList candidates;
+  FindStackCandidatesPass(candidates).visitExpr(fn->body());
+  for (FindStackCandidatesPass::CandidateList::iterator it = candidates.begin();
+      it != candidates.end(); ++it) {
+    InitVarExpr * initVar = *it;
+    FnCallExpr * ctorCall = static_cast<FnCallExpr *>(initVar->initExpr());
+    if (isSelfNonEscaping(ctorCall->function()) && !escapes(fn, initVar->var())) {
+      cast<NewExpr>(ctorCall->selfArg())->setStackAlloc(true);
+    }
+  }
+
+  FindVarArgsCallsPass::CallList calls;
+  FindVarArgsCallsPass(calls).visitExpr(fn->body());
+  for (FindVarArgsCallsPass::CallList::iterator it = calls.begin(); it != calls.end(); ++it) {
+    FnCallExpr * call = it->first;
+    if (isVarArgsNonEscaping(call->function(), call->exprType() == Expr::VTableCall)) {
+      it->second->setStackAlloc(true);
+    }
+  }
+}
+
+bool EscapeAnalysisPass::isSelfNonEscaping(FunctionDefn * fn) {
+  if (fn->flags() & FunctionDefn::SelfEscapeKnown) {
+    return (fn->flags() & FunctionDefn::NonEscapingSelf) != 0;
+  }
+
+  // Mark the result as known before looking at the body, so that a recursive call
+  // sees the conservative answer.
+  fn->setFlag(FunctionDefn::SelfEscapeKnown);
+  ParameterDefn * selfParam = fn->functionType()->selfParam();
+  if (selfParam == NULL || fn->isIntrinsic() || fn->isExtern() || fn->isAbstract() ||
+      fn->isUndefined() || fn->isInterfaceMethod()) {
+    return false;
+  }
+
+  if (!AnalyzerBase::analyzeFunction(fn, Task_PrepEvaluation) || fn->body() == NULL) {
+    return false;
+  }
+
+  bool result = !escapes(fn, selfParam);
+  fn->setFlag(FunctionDefn::NonEscapingSelf, result);
+  return result;
+}
+
+bool EscapeAnalysisPass::isVarArgsNonEscaping(FunctionDefn * fn, bool isVirtual) {
+  // A dispatched call may reach an override which retains the array, and overrides
+  // are never checked against the 'NoEscape' promise, so don't trust it here.
+  if (isVirtual || fn->isInterfaceMethod()) {
+    return false;
+  } else if (fn->flags() & FunctionDefn::NoEscapeVarArgs) {
+    return true;
+  }
+
+  if (fn->flags() & FunctionDefn::VarArgsEscapeKnown) {
+    return (fn->flags() & FunctionDefn::NonEscapingVarArgs) != 0;
+  }
+
+  fn->setFlag(FunctionDefn::VarArgsEscapeKnown);
+  if (fn->isIntrinsic() || fn->isExtern() || fn->isAbstract() || fn->isUndefined()) {
+    return false;
+  }
+
+  ParameterDefn * varArgsParam = NULL;
+  const ParameterList & params = fn->functionType()->params();
+  for (ParameterList::const_iterator it = params.begin(); it != params.end(); ++it) {
+    if ((*it)->isVariadic()) {
+      varArgsParam = *it;
+      break;
+    }
+  }
+
+  if (varArgsParam == NULL) {
+    return false;
+  }
+
+  if (!AnalyzerBase::analyzeFunction(fn, Task_PrepEvaluation) || fn->body() == NULL) {
+    return false;
+  }
+
+  bool result = !escapes(fn, varArgsParam);
+  fn->setFlag(FunctionDefn::NonEscapingVarArgs, result);
+  return result;
+}
+
+bool EscapeAnalysisPass::escapes(FunctionDefn * fn, const ValueDefn * value) {
+  EscapeAnalysisPass instance(value);
+
+  // An alias may be used in a block which is visited before the one that defines it,
+  // so keep going until no new aliases turn up.
+  size_t aliasCount;
+  do {
+    aliasCount = instance.aliases_.size();
+    instance.visitExpr(fn->body());
+  } while (!instance.escapes_ && instance.aliases_.size() != aliasCount);
+
+  return instance.escapes_;
+}
+
+bool EscapeAnalysisPass::isValueRef(const Expr * in) const {
+  while (in != NULL && (in->exprType() == Expr::UpCast || in->exprType() == Expr::BitCast ||
+      in->exprType() == Expr::QualCast)) {
+    in = static_cast<const CastExpr *>(in)->arg();
+  }
+
+  if (const LValueExpr * lval = dyn_cast_or_null<LValueExpr>(in)) {
+    return lval->base() == NULL && isTracked(lval->value());
+  }
+
+  return false;
+}
+
+Expr * EscapeAnalysisPass::visitExpr(Expr * in) {
+  // No need to look any further once the value has been found to escape.
+  if (escapes_) {
+    return in;
+  }
+
+  return CFGPass::visitExpr(in);
+}
+
+Expr * EscapeAnalysisPass::visitInitVar(InitVarExpr * in) {
+  VariableDefn * var = in->var();
+  if (var->storageClass() == Storage_Local && !var->isSharedRef() &&
+      isValueRef(in->initExpr())) {
+    aliases_.insert(var);
+    return in;
+  }
+
+  return CFGPass::visitInitVar(in);
+}
+
+Expr * EscapeAnalysisPass::visitLValue(LValueExpr * in) {
+  if (in->base() == NULL) {
+    // Any reference to the value which isn't handled by one of the cases below
+    // is assumed to let it escape.
+    if (isTracked(in->value())) {
+      escapes_ = true;
+    }
+    return in;
+  }
+
+  // Reading or writing a field doesn't let the object escape.
+  if (isValueRef(in->base()) && in->value()->storageClass() == Storage_Instance &&
+      isa<VariableDefn>(in->value())) {
+    return in;
+  }
+
+  return CFGPass::visitLValue(in);
+}
+
+Expr * EscapeAnalysisPass::visitAssign(AssignmentExpr * in) {
+  // Storing a different value into the variable itself is fine.
+  if (isValueRef(in->toExpr())) {
+    in->setFromExpr(visitExpr(in->fromExpr()));
+    return in;
+  }
+
+  return CFGPass::visitAssign(in);
+}
+
+Expr * EscapeAnalysisPass::visitFnCall(FnCallExpr * in) {
+  if (in->exprType() != Expr::VTableCall && isValueRef(in->selfArg()) &&
+      isSelfNonEscaping(in->function())) {
+    visitExprArgs(in);
+    return in;
+  }
+
+  return CFGPass::visitFnCall(in);
+}
+
+Expr * EscapeAnalysisPass::visitRefEq(BinaryExpr * in) {
+  if (!isValueRef(in->first())) {
+    in->setFirst(visitExpr(in->first()));
+  }
+
+  if (!isValueRef(in->second())) {
+    in->setSecond(visitExpr(in->second()));
+  }
+
+  return in;
+}
+
+Expr * EscapeAnalysisPass::visitYield(ReturnExpr * in) {
+  // The locals of a generator outlive each call to it.
+  escapes_ = true;
+  return in;
+}
+
+Expr * EscapeAnalysisPass::visitClosureScope(ClosureEnvExpr * in) {
+  // Closure environments are not traversed, so assume that they capture the value.
+  escapes_ = true;
+  return in;
+}
+
+} // namespace tart
@@ -16,8 +16,22 @@
 #include "tart/Expr/Constant.h"
 #include "tart/Sema/EvalPass.h"
 #include "tart/Sema/AnalyzerBase.h"
+#include "tart/Common/CodeGenOption.h"
+#include "tart/Common/CompilerStats.h"
 #include "tart/Common/Diagnostics.h"
 
+#include "llvm/Support/CommandLine.h"
+
+static tart::CodeGenOption<unsigned>
+StaticEvalLimit("static-eval-limit",
+    llvm::cl::desc("Maximum number of expressions evaluated for one static initializer"),
+    llvm::cl::init(10000));
+
+static tart::CodeGenOption<unsigned>
+StaticEvalDepth("static-eval-depth",
+    llvm::cl::desc("Maximum depth of calls evaluated for one static initializer"),
+    llvm::cl::init(64));
+
 namespace tart {
 
 static ConstantNull nullValue = ConstantNull(SourceLocation());
@@ -26,15 +40,77 @@ static ConstantNull nullValue = ConstantNull(SourceLocation());
 /// EvalPass
 
 Expr * EvalPass::eval(Module * module, Expr * in, bool allowPartial) {
+  PhaseScope scope(Phase::Eval);
   allowPartial = false;
   return EvalPass(module, allowPartial).evalExpr(in);
 }
 
+Expr * EvalPass::evalStaticInitializer(Module * module, Expr * in) {
+  PhaseScope scope(Phase::Eval);
+  Expr * result = EvalPass(module, true).evalExpr(in);
+  if (result == NULL || isErrorResult(result)) {
+    return NULL;
+  }
+
+  // Only accept the result if every object in the graph was fully constructed.
+  llvm::SmallPtrSet<Expr *, 16> visited;
+  if (!isCompleteConstant(result, visited)) {
+    return NULL;
+  }
+
+  return result;
+}
+
+bool EvalPass::isCompleteConstant(Expr * in, llvm::SmallPtrSet<Expr *, 16> & visited) {
+  if (in == NULL || !in->isConstant()) {
+    return false;
+  }
+
+  if (!visited.insert(in)) {
+    return true;
+  }
+
+  if (ConstantObjectRef * obj = dyn_cast<ConstantObjectRef>(in)) {
+    for (ExprList::const_iterator it = obj->members().begin(); it != obj->members().end(); ++it) {
+      if (!isCompleteConstant(*it, visited)) {
+        return false;
+      }
+    }
+  } else if (ConstantNativeArray * array = dyn_cast<ConstantNativeArray>(in)) {
+    for (ExprList::const_iterator it = array->elements().begin();
+        it != array->elements().end(); ++it) {
+      if (!isCompleteConstant(*it, visited)) {
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+Expr * EvalPass::cannotEval(Expr * in, const char * msg) {
+  if (!allowPartial_) {
+    diag.error(in) << msg << ": " << in;
+    showCallStack();
+    DFAIL("Cannot evaluate");
+  }
+
+  return NULL;
+}
+
 Expr * EvalPass::evalExpr(Expr * in) {
   if (in == NULL) {
     return NULL;
   }
 
+  // Every callee that is reached gets analyzed, so a runaway static initializer
+  // would otherwise pull in (and spin on) an unbounded amount of code. Only the
+  // snapshot of static initializers is limited; when it gives up, the initializer
+  // is run at startup instead. Constants and attributes must always be evaluated.
+  if (allowPartial_ && ++steps_ > StaticEvalLimit) {
+    return cannotEval(in, "Too many steps to evaluate at compile time");
+  }
+
   switch (in->exprType()) {
     case Expr::Invalid:
       return &Expr::ErrorVal;
@@ -175,6 +251,10 @@ Expr * EvalPass::evalExpr(Expr * in) {
       break;
   }
 
+  if (allowPartial_) {
+    return NULL;
+  }
+
   diag.error(in) << "Expr type not handled in eval: " <<
       exprTypeName(in->exprType()) << " : " << in;
   showCallStack();
@@ -254,6 +334,10 @@ bool EvalPass::evalBlocks(BlockList & blocks) {
 #endif
 
 Expr * EvalPass::evalFnCall(FnCallExpr * in) {
+  if (allowPartial_ && callDepth_ >= StaticEvalDepth) {
+    return cannotEval(in, "Calls nested too deeply to evaluate at compile time");
+  }
+
   FunctionDefn * func = in->function();
   AnalyzerBase::analyzeFunction(func, Task_PrepEvaluation);
   CallFrame frame(callFrame_);
@@ -299,9 +383,17 @@ Expr * EvalPass::evalFnCall(FnCallExpr * in) {
   DASSERT_OBJ(func->body() != NULL, func);
 
   CallFrame * prevFrame = setCallFrame(&frame);
-  evalExpr(func->body());
+  ++callDepth_;
+  Expr * bodyResult = evalExpr(func->body());
+  --callDepth_;
   setCallFrame(prevFrame);
 
+  // If any part of the body could not be evaluated, then the whole call fails -
+  // otherwise side effects would be silently dropped.
+  if (bodyResult == NULL) {
+    return NULL;
+  }
+
   if (in->exprType() == Expr::CtorCall) {
     return frame.selfArg();
   }
@@ -335,6 +427,9 @@ Expr * EvalPass::evalLValue(LValueExpr * in) {
 
     switch (var->storageClass()) {
       case Storage_Global:
+        if (allowPartial_) {
+          return NULL;
+        }
         DFAIL("IMPLEMENT Storage_Global");
         break;
 
@@ -347,6 +442,8 @@ Expr * EvalPass::evalLValue(LValueExpr * in) {
 
         if (ConstantObjectRef * inst = dyn_cast<ConstantObjectRef>(base)) {
           return inst->getMemberValue(var);
+        } else if (allowPartial_) {
+          return NULL;
         } else {
           diag.fatal(base) << "Base not handled " << base;
         }
@@ -354,6 +451,9 @@ Expr * EvalPass::evalLValue(LValueExpr * in) {
       }
 
       case Storage_Class:
+        if (allowPartial_) {
+          return NULL;
+        }
         DFAIL("IMPLEMENT Storage_Class");
         break;
 
@@ -370,6 +470,10 @@ Expr * EvalPass::evalLValue(LValueExpr * in) {
           return evalExpr(var->initValue());
         }
 
+        if (callFrame_ == NULL) {
+          return cannotEval(in, "Local variable outside of function");
+        }
+
         return callFrame_->getLocal(var);
     }
   }
@@ -392,23 +496,29 @@ Expr * EvalPass::evalAssign(AssignmentExpr * in) {
     return NULL;
   }
 
-  store(from, in->toExpr());
+  if (!store(from, in->toExpr())) {
+    return NULL;
+  }
+
   return in->toExpr();
 }
 
-void EvalPass::store(Expr * value, Expr * dest) {
+bool EvalPass::store(Expr * value, Expr * dest) {
   if (dest->exprType() == Expr::LValue) {
     LValueExpr * lvalue = static_cast<LValueExpr *>(dest);
     if (VariableDefn * var = dyn_cast<VariableDefn>(lvalue->value())) {
       if (var->defnType() == Defn::Let) {
         if (var->storageClass() == Storage_Global || var->storageClass() == Storage_Static) {
           DFAIL("Invalid assignment to constant");
-          return;
+          return false;
         }
       }
 
       switch (var->storageClass()) {
         case Storage_Global:
+          if (allowPartial_) {
+            return false;
+          }
           DFAIL("IMPLEMENT Storage_Global");
           break;
 
@@ -416,11 +526,14 @@ void EvalPass::store(Expr * value, Expr * dest) {
           DASSERT(lvalue->base() != NULL);
           Expr * base = evalExpr(lvalue->base());
           if (base == NULL) {
-            return;
+            return false;
           }
 
           if (ConstantObjectRef * inst = dyn_cast<ConstantObjectRef>(base)) {
             inst->setMemberValue(var, value);
+            return true;
+          } else if (allowPartial_) {
+            return false;
           } else {
             diag.fatal(base) << "Base not handled " << base;
           }
@@ -428,38 +541,57 @@ void EvalPass::store(Expr * value, Expr * dest) {
         }
 
         case Storage_Class:
+          if (allowPartial_) {
+            return false;
+          }
           DFAIL("IMPLEMENT Storage_Class");
           break;
 
         case Storage_Static:
-          if (!allowPartial_) {
-            diag.fatal(dest) << "Not a constant: " << var;
+          // Writing to a static variable is a side effect, so the expression cannot be
+          // evaluated at compile time.
+          if (allowPartial_) {
+            return false;
           }
 
-          diag.debug(var) << var;
+          diag.fatal(dest) << "Not a constant: " << var;
           DFAIL("IMPLEMENT Storage_Static");
           break;
 
         case Storage_Local:
+          if (callFrame_ == NULL) {
+            return cannotEval(dest, "Local variable outside of function") != NULL;
+          }
+
           callFrame_->setLocal(var, value);
-          break;
+          return true;
       }
     } else if (ParameterDefn * param = dyn_cast<ParameterDefn>(lvalue->value())) {
       (void)param;
+      if (allowPartial_) {
+        return false;
+      }
+
       diag.debug() << dest;
       DFAIL("Implement assign to param");
     }
   } else {
+    if (allowPartial_) {
+      return false;
+    }
+
     diag.debug() << dest;
     DFAIL("Implement assign to non-lvalue");
   }
+
+  return false;
 }
 
 Expr * EvalPass::evalSeq(SeqExpr * in) {
-  Expr * result = NULL;
+  Expr * result = &Expr::VoidVal;
   for (SeqExpr::const_iterator it = in->begin(), itEnd = in->end(); it != itEnd; ++it) {
     result = evalExpr(*it);
-    if (result == NULL || callFrame_->runState() != RUNNING) {
+    if (result == NULL || (callFrame_ != NULL && callFrame_->runState() != RUNNING)) {
       break;
     }
   }
@@ -467,6 +599,10 @@ Expr * EvalPass::evalSeq(SeqExpr * in) {
 }
 
 Expr * EvalPass::evalReturn(ReturnExpr * in) {
+  if (callFrame_ == NULL) {
+    return cannotEval(in, "Return outside of function");
+  }
+
   if (in->arg() != NULL) {
     callFrame_->setReturnVal(evalExpr(in->arg()));
   } else {
@@ -498,6 +634,10 @@ Expr * EvalPass::evalComplement(UnaryExpr * in) {
     return ConstantInteger::get(in->location(), in->type().unqualified(), cint);
   }
 
+  if (allowPartial_) {
+    return NULL;
+  }
+
   diag.debug(in) << in;
   DFAIL("Implement");
 }
@@ -566,6 +706,10 @@ Expr * EvalPass::evalUnionCtorCast(CastExpr *in) {
       }
       DASSERT(index >= 0);
 
+      if (allowPartial_) {
+        return NULL;
+      }
+
       DFAIL("Implement");
 #if 0
       Value * indexVal = ConstantInt::get(utype->irType()->getContainedType(0), index);
@@ -610,6 +754,10 @@ Expr * EvalPass::evalBinaryOpcode(BinaryOpcodeExpr *in) {
       break;
   }
 
+  if (allowPartial_) {
+    return NULL;
+  }
+
   diag.debug(in) << in;
   DFAIL("Implement");
 }
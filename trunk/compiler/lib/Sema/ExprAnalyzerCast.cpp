@@ -69,6 +69,22 @@ Expr * ExprAnalyzer::doImplicitCast(Expr * in, QualifiedType toType, unsigned op
       return in;
     }
 
+    case Expr::FnCall: {
+      // 'Array.of' simply returns its variadic argument. If the result is only ever
+      // seen through a read-only reference, replace the call with the array literal
+      // itself, qualified to match, so that it can be generated as a shared constant.
+      FnCallExpr * call = static_cast<FnCallExpr *>(in);
+      if ((toType.isReadOnly() || toType.isImmutable()) && isArrayOfCall(call)) {
+        ArrayLiteralExpr * alit = static_cast<ArrayLiteralExpr *>(call->arg(0));
+        if (alit->type().unqualified() == dealias(toType.unqualified())) {
+          alit->setType(QualifiedType(alit->type().unqualified(),
+              toType.qualifiers() & QualifiedType::MUTABILITY_MASK));
+          return alit;
+        }
+      }
+      break;
+    }
+
     case Expr::Return:
     case Expr::Yield:
     case Expr::Break:
@@ -357,4 +373,16 @@ Defn * ExprAnalyzer::findBestSpecialization(SpecializeExpr * spe) {
   return spBest->def();
 }
 
+bool ExprAnalyzer::isArrayOfCall(const FnCallExpr * call) {
+  const FunctionDefn * fn = call->function();
+  if (fn == NULL || fn->name() != "of" || call->argCount() != 1 ||
+      call->arg(0)->exprType() != Expr::ArrayLiteral) {
+    return false;
+  }
+
+  const Defn * parent = fn->parentDefn();
+  return parent != NULL && parent->templateInstance() != NULL &&
+      parent->templateInstance()->templateDefn() == Builtins::typeArray.typeDefn();
+}
+
 }
@@ -129,7 +129,7 @@ Expr * ExprAnalyzer::reduceAnonFn(const ASTFunctionDecl * ast, QualifiedType exp
                 expected << ".";
             return &Expr::ErrorVal;
           }
-          diag.debug() << expected << " : " << paramListType << " : " << paramType;
+          DDEBUG() << expected << " : " << paramListType << " : " << paramType;
           param->setType(paramType);
           DASSERT(!param->isVariadic());
           param->setInternalType(paramType);
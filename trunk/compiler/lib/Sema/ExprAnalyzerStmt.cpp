@@ -7,6 +7,7 @@
 #include "tart/Defn/FunctionDefn.h"
 #include "tart/Defn/Module.h"
 #include "tart/Defn/PropertyDefn.h"
+#include "tart/Defn/Template.h"
 #include "tart/Defn/TypeDefn.h"
 
 #include "tart/Expr/Exprs.h"
@@ -39,6 +40,58 @@ namespace tart {
 
 #define CHECK_EXPR(e) if (isErrorResult(e)) return &Expr::ErrorVal
 
+namespace {
+
+/// -------------------------------------------------------------------
+/// A final collection class whose elements are stored contiguously, so that 'for'
+/// loops over it can be compiled as indexed loops.
+struct IndexedCollection {
+  const char * typeName;          // Qualified name of the collection template.
+  const char * sizeField;         // Field holding the number of elements.
+  const char * dataField;         // Field holding the elements.
+};
+
+const IndexedCollection indexedCollections[] = {
+  { "tart.core.Array", "_size", "_data" },
+  { "tart.collections.ArrayList", "dataSize", "data" },
+};
+
+/** Return the entry for 'type' in the table above, or NULL if there is none. */
+const IndexedCollection * findIndexedCollection(const Type * type) {
+  TypeDefn * tdef = type->typeDefn();
+  if (type->typeClass() != Type::Class || tdef == NULL || tdef->templateInstance() == NULL) {
+    return NULL;
+  }
+
+  StringRef name = tdef->templateInstance()->templateDefn()->qualifiedName();
+  for (size_t i = 0; i < sizeof(indexedCollections) / sizeof(indexedCollections[0]); ++i) {
+    if (name == indexedCollections[i].typeName) {
+      return &indexedCollections[i];
+    }
+  }
+
+  return NULL;
+}
+
+/** Return the instance variable 'name' of 'type', or NULL if there is none. */
+VariableDefn * findField(const Type * type, const char * name) {
+  if (!AnalyzerBase::analyzeType(type, Task_PrepMemberLookup)) {
+    return NULL;
+  }
+
+  const CompositeType * ctype = cast<CompositeType>(type);
+  VariableDefn * field = dyn_cast_or_null<VariableDefn>(
+      ctype->memberScope()->lookupSingleMember(name));
+  if (field == NULL || field->storageClass() != Storage_Instance ||
+      !AnalyzerBase::analyzeDefn(field, Task_PrepTypeComparison)) {
+    return NULL;
+  }
+
+  return field;
+}
+
+}
+
 Expr * ExprAnalyzer::reduceBlockStmt(const BlockStmt * st, QualifiedType expected) {
   LocalScope * blockScope = createLocalScope("block-scope");
   Scope * savedScope = setActiveScope(blockScope);
@@ -244,8 +297,6 @@ Expr * ExprAnalyzer::reduceForEachStmt(const ForEachStmt * st, QualifiedType exp
   setActiveScope(forScope);
 
   SourceLocation stLoc = st->location();
-  SourceLocation iterLoc = st->iterExpr()->location();
-
   ForEachExpr * foreach = new ForEachExpr(stLoc, forScope);
 
   Expr * iteratorExpr = inferTypes(reduceExpr(st->iterExpr(), NULL), NULL);
@@ -258,72 +309,14 @@ Expr * ExprAnalyzer::reduceForEachStmt(const ForEachStmt * st, QualifiedType exp
     return &Expr::ErrorVal;
   }
 
-  Qualified<CompositeType> iterType = iteratorExpr->type().as<CompositeType>();
-  AnalyzerBase::analyzeType(iterType.unqualified(), Task_PrepMemberLookup);
-  FunctionDefn * nextFn = findInterfaceMethod(
-      iterType.unqualified(), Builtins::typeIterator, "next");
-  if (nextFn == NULL) {
-    // If it's not an Iterator, see if it's an Iterable.
-    FunctionDefn * iterate = findInterfaceMethod(
-        iterType.unqualified(), Builtins::typeIterable, "iterate");
-    if (iterate == NULL) {
-      diag.error(iteratorExpr) << "Invalid iterator type: " << iteratorExpr->type();
-      return &Expr::ErrorVal;
-    }
-
-    LValueExpr * iterMethod = LValueExpr::get(iterLoc, iteratorExpr, iterate);
-    iteratorExpr = inferTypes(callExpr(iterLoc, iterMethod, ASTNodeList(), NULL), NULL);
-    if (iteratorExpr == NULL) {
-      return &Expr::ErrorVal;
-    }
-
-    if (!iteratorExpr->type().isa<CompositeType>()) {
-      diag.error(iteratorExpr) << "Invalid iterator type: " << iteratorExpr->type();
-      return &Expr::ErrorVal;
-    }
-
-    iterType = iteratorExpr->type().as<CompositeType>();
-    AnalyzerBase::analyzeType(iterType.unqualified(), Task_PrepMemberLookup);
-    nextFn = findInterfaceMethod(iterType.unqualified(), Builtins::typeIterator, "next");
-    if (nextFn == NULL) {
-      diag.error(iteratorExpr) << "Invalid iterator type: " << iteratorExpr->type();
-      return &Expr::ErrorVal;
-    }
-  }
-
-  // Create a variable to hold the iterator - we need this to ensure that the garbage
-  // collector doesn't free the iterator before we're done.
-  VariableDefn * iteratorVar = createTempVar(
-      iteratorExpr->location(), Defn::Let, iteratorExpr->type(), "foreach.iter");
-  foreach->setIterator(new InitVarExpr(iteratorVar->location(), iteratorVar, iteratorExpr));
-
-  // The list of expressions to be evaluated at the start of each iteration.
-  ExprList loopExprs;
-  LValueExpr * iteratorValue = LValueExpr::get(iteratorVar->location(), NULL, iteratorVar);
-  LValueExpr * nextFnExpr = LValueExpr::get(stLoc, iteratorValue, nextFn);
-  Expr * nextCall = inferTypes(callExpr(iteratorExpr->location(), nextFnExpr, ASTNodeList(), NULL),
-      NULL);
-  CHECK_EXPR(nextCall);
-
-  Expr * nextValueExpr = SharedValueExpr::get(nextCall);
-  foreach->setNext(nextValueExpr);
-
-  const UnionType * utype = dyn_cast<UnionType>(nextCall->type().unqualified());
-  DASSERT(utype != NULL);
-  DASSERT(utype->members().size() == 2);
-  const Type * iterVarType;
-  for (TupleType::const_iterator it = utype->members().begin(); it != utype->members().end();
-      ++it) {
-    const Type * ty = it->type();
-    if (!ty->isVoidType()) {
-      iterVarType = ty;
-    }
+  // Arrays and array lists are iterated by index, without creating an iterator.
+  Expr * iterValue = NULL;
+  const Type * iterVarType = NULL;
+  if (!reduceIndexedLoop(foreach, iteratorExpr, iterValue, iterVarType) &&
+      !reduceIteratorLoop(foreach, iteratorExpr, iterValue, iterVarType)) {
+    return &Expr::ErrorVal;
   }
 
-  Expr * testExpr = new InstanceOfExpr(stLoc, nextValueExpr, &VoidType::instance);
-  foreach->setTest(testExpr);
-  Expr * iterValue = new CastExpr(Expr::UnionMemberCast, stLoc, iterVarType, nextValueExpr);
-
   // Assign the next value to the iteration variable.
   if (st->loopVars()->nodeType() == ASTNode::Var) {
     const ASTVarDecl * initDecl = static_cast<const ASTVarDecl *>(st->loopVars());
@@ -388,6 +381,156 @@ Expr * ExprAnalyzer::reduceForEachStmt(const ForEachStmt * st, QualifiedType exp
   return foreach;
 }
 
+bool ExprAnalyzer::reduceIndexedLoop(ForEachExpr * foreach, Expr * collection,
+    Expr *& iterValue, const Type *& iterVarType) {
+  const Type * collType = dealias(collection->type().unqualified());
+  const IndexedCollection * ic = findIndexedCollection(collType);
+  if (ic == NULL) {
+    return false;
+  }
+
+  // Find the size field, and the flexible array holding the elements - which may be
+  // inside another indexed collection, such as the array used by an array list.
+  VariableDefn * sizeField = findField(collType, ic->sizeField);
+  VariableDefn * dataField = findField(collType, ic->dataField);
+  VariableDefn * elementsField = NULL;
+  if (dataField != NULL) {
+    const Type * dataType = dataField->type().unqualified();
+    if (isa<FlexibleArrayType>(dataType)) {
+      elementsField = dataField;
+      dataField = NULL;
+    } else if (const IndexedCollection * dataIc = findIndexedCollection(dataType)) {
+      elementsField = findField(dataType, dataIc->dataField);
+    }
+  }
+
+  if (sizeField == NULL || elementsField == NULL ||
+      !isa<FlexibleArrayType>(elementsField->type().unqualified()) ||
+      !isa<PrimitiveType>(dealias(sizeField->type().unqualified()))) {
+    return false;
+  }
+
+  const FlexibleArrayType * faType = cast<FlexibleArrayType>(elementsField->type().unqualified());
+  QualifiedType elementType = faType->elementType();
+  if (!AnalyzerBase::analyzeType(elementType, Task_PrepTypeComparison)) {
+    return false;
+  }
+
+  // The loop is:
+  //
+  //   let coll = collection; var index = -1;
+  //   while (++index < coll.size) { let x = coll.data[index]; ... }
+  //
+  // The size and the elements are read from the collection on every iteration, just as
+  // the collection's own iterator would, so appending to or clearing an array list
+  // inside the loop behaves the same way.
+  //
+  // The index has the same type as the size field ('int', which is pointer-sized), so
+  // that the two can be compared directly.
+  SourceLocation loc = foreach->location();
+  const Type * indexType = dealias(sizeField->type().unqualified());
+  VariableDefn * collVar = createTempVar(
+      collection->location(), Defn::Let, collection->type(), "foreach.coll");
+  VariableDefn * indexVar = createTempVar(loc, Defn::Var, indexType, "foreach.index");
+  foreach->setIterator(new BinaryExpr(Expr::Prog2, loc, &VoidType::instance,
+      new InitVarExpr(loc, collVar, collection),
+      new InitVarExpr(loc, indexVar, ConstantInteger::get(loc, indexType, -1))));
+
+  Expr * nextIndex = new AssignmentExpr(Expr::Assign, loc,
+      LValueExpr::get(loc, NULL, indexVar),
+      new BinaryOpcodeExpr(llvm::Instruction::Add, loc, indexType,
+          LValueExpr::get(loc, NULL, indexVar), ConstantInteger::get(loc, indexType, 1)));
+  Expr * atEnd = new CompareExpr(loc, llvm::CmpInst::ICMP_SGE,
+      LValueExpr::get(loc, NULL, indexVar),
+      LValueExpr::get(loc, LValueExpr::get(loc, NULL, collVar), sizeField));
+  foreach->setTest(new BinaryExpr(Expr::Prog2, loc, &BoolType::instance, nextIndex, atEnd));
+
+  Expr * elements = LValueExpr::get(loc, NULL, collVar);
+  if (dataField != NULL) {
+    elements = LValueExpr::get(loc, elements, dataField);
+  }
+
+  elements = LValueExpr::get(loc, elements, elementsField);
+  iterValue = new BinaryExpr(Expr::ElementRef, loc, elementType, elements,
+      LValueExpr::get(loc, NULL, indexVar));
+  iterVarType = elementType.type();
+  return true;
+}
+
+bool ExprAnalyzer::reduceIteratorLoop(ForEachExpr * foreach, Expr * iteratorExpr,
+    Expr *& iterValue, const Type *& iterVarType) {
+  SourceLocation loc = foreach->location();
+  SourceLocation iterLoc = iteratorExpr->location();
+
+  Qualified<CompositeType> iterType = iteratorExpr->type().as<CompositeType>();
+  AnalyzerBase::analyzeType(iterType.unqualified(), Task_PrepMemberLookup);
+  FunctionDefn * nextFn = findInterfaceMethod(
+      iterType.unqualified(), Builtins::typeIterator, "next");
+  if (nextFn == NULL) {
+    // If it's not an Iterator, see if it's an Iterable.
+    FunctionDefn * iterate = findInterfaceMethod(
+        iterType.unqualified(), Builtins::typeIterable, "iterate");
+    if (iterate == NULL) {
+      diag.error(iteratorExpr) << "Invalid iterator type: " << iteratorExpr->type();
+      return false;
+    }
+
+    LValueExpr * iterMethod = LValueExpr::get(iterLoc, iteratorExpr, iterate);
+    iteratorExpr = inferTypes(callExpr(iterLoc, iterMethod, ASTNodeList(), NULL), NULL);
+    if (iteratorExpr == NULL) {
+      return false;
+    }
+
+    if (!iteratorExpr->type().isa<CompositeType>()) {
+      diag.error(iteratorExpr) << "Invalid iterator type: " << iteratorExpr->type();
+      return false;
+    }
+
+    iterType = iteratorExpr->type().as<CompositeType>();
+    AnalyzerBase::analyzeType(iterType.unqualified(), Task_PrepMemberLookup);
+    nextFn = findInterfaceMethod(iterType.unqualified(), Builtins::typeIterator, "next");
+    if (nextFn == NULL) {
+      diag.error(iteratorExpr) << "Invalid iterator type: " << iteratorExpr->type();
+      return false;
+    }
+  }
+
+  // Create a variable to hold the iterator - we need this to ensure that the garbage
+  // collector doesn't free the iterator before we're done.
+  VariableDefn * iteratorVar = createTempVar(
+      iteratorExpr->location(), Defn::Let, iteratorExpr->type(), "foreach.iter");
+  foreach->setIterator(new InitVarExpr(iteratorVar->location(), iteratorVar, iteratorExpr));
+
+  // The list of expressions to be evaluated at the start of each iteration.
+  ExprList loopExprs;
+  LValueExpr * iteratorValue = LValueExpr::get(iteratorVar->location(), NULL, iteratorVar);
+  LValueExpr * nextFnExpr = LValueExpr::get(loc, iteratorValue, nextFn);
+  Expr * nextCall = inferTypes(callExpr(iteratorExpr->location(), nextFnExpr, ASTNodeList(), NULL),
+      NULL);
+  if (isErrorResult(nextCall)) {
+    return false;
+  }
+
+  Expr * nextValueExpr = SharedValueExpr::get(nextCall);
+  foreach->setNext(nextValueExpr);
+
+  const UnionType * utype = dyn_cast<UnionType>(nextCall->type().unqualified());
+  DASSERT(utype != NULL);
+  DASSERT(utype->members().size() == 2);
+  for (TupleType::const_iterator it = utype->members().begin(); it != utype->members().end();
+      ++it) {
+    const Type * ty = it->type();
+    if (!ty->isVoidType()) {
+      iterVarType = ty;
+    }
+  }
+
+  Expr * testExpr = new InstanceOfExpr(loc, nextValueExpr, &VoidType::instance);
+  foreach->setTest(testExpr);
+  iterValue = new CastExpr(Expr::UnionMemberCast, loc, iterVarType, nextValueExpr);
+  return true;
+}
+
 Expr * ExprAnalyzer::reduceSwitchStmt(const SwitchStmt * st, QualifiedType expected) {
   Scope * savedScope = activeScope();
   Scope * caseValScope = activeScope();
@@ -14,6 +14,7 @@
 
 #include "tart/Sema/FunctionAnalyzer.h"
 #include "tart/Sema/FunctionMergePass.h"
+#include "tart/Sema/EscapeAnalysisPass.h"
 #include "tart/Sema/TypeAnalyzer.h"
 #include "tart/Sema/StmtAnalyzer.h"
 #include "tart/Sema/VarAnalyzer.h"
@@ -58,7 +59,8 @@ static const FunctionDefn::PassSet PASS_SET_CODEGEN = FunctionDefn::PassSet::of(
   FunctionDefn::ReturnTypePass,
   FunctionDefn::MergePass,
   FunctionDefn::ReflectionPass,
-  FunctionDefn::CompletionPass
+  FunctionDefn::CompletionPass,
+  FunctionDefn::EscapePass
 );
 
 static const FunctionDefn::PassSet PASS_SET_REFLECT = FunctionDefn::PassSet::of(
@@ -107,6 +109,10 @@ bool FunctionAnalyzer::runPasses(FunctionDefn::PassSet passesToRun) {
     return true;
   }
 
+  // Temporaries created while analyzing this function are allocated in an arena.
+  // Functions analyzed re-entrantly share the arena of the outermost one.
+  GCArenaScope arena(GCArenaScope::ShareEnclosing);
+
   if (passesToRun.contains(FunctionDefn::AttributePass)) {
     if (!resolveAttributes(target)) {
       return false;
@@ -152,6 +158,10 @@ bool FunctionAnalyzer::runPasses(FunctionDefn::PassSet passesToRun) {
     return false;
   }
 
+  if (passesToRun.contains(FunctionDefn::EscapePass) && !analyzeEscapes()) {
+    return false;
+  }
+
   if (passesToRun.contains(FunctionDefn::PrepConversionPass) &&
       !analyzeRecursive(Task_PrepConversion, FunctionDefn::PrepConversionPass)) {
     return false;
@@ -366,6 +376,11 @@ bool FunctionAnalyzer::resolveParameterTypes() {
     }
 
     if (ftype != NULL) {
+      // External functions return values using the C calling convention.
+      if (target->isExtern()) {
+        ftype->setIsExtern(true);
+      }
+
       ParameterList & params = ftype->params();
       for (ParameterList::iterator it = params.begin(); it != params.end(); ++it) {
         ParameterDefn * param = *it;
@@ -603,6 +618,18 @@ bool FunctionAnalyzer::merge() {
   return success;
 }
 
+bool FunctionAnalyzer::analyzeEscapes() {
+  if (target->passes().begin(FunctionDefn::EscapePass)) {
+    if (target->hasBody() && target->isSingular() && diag.getErrorCount() == 0) {
+      EscapeAnalysisPass::run(target);
+    }
+
+    target->passes().finish(FunctionDefn::EscapePass);
+  }
+
+  return true;
+}
+
 bool FunctionAnalyzer::createReflectionData() {
   if (target->passes().begin(FunctionDefn::ReflectionPass)) {
     FunctionType * ftype = target->functionType();
@@ -57,7 +57,9 @@ bool FunctionMergePass::visitExpr(Expr * from, Expr * to) {
   }
 
   if (from == NULL || to == NULL) {
-    diag.debug() << "Merge failure: null expression";
+    if (showMessages_) {
+      diag.debug() << "Merge failure: null expression";
+    }
     return false;
   }
 
@@ -641,7 +643,9 @@ bool FunctionMergePass::areTypesCompatible(const Type * from, const Type * to) {
     }
 
     default:
-      diag.debug() << "Type not handled: " << from;
+      if (showMessages_) {
+        diag.debug() << "Type not handled: " << from;
+      }
       return false;
   }
 }
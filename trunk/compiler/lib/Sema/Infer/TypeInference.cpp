@@ -24,6 +24,7 @@
 #include "tart/Sema/Infer/TypeAssignment.h"
 #include "tart/Sema/Infer/TypeInference.h"
 
+#include "tart/Common/CompilerStats.h"
 #include "tart/Common/Diagnostics.h"
 
 #include "llvm/Support/CommandLine.h"
@@ -33,19 +34,43 @@ namespace tart {
 static llvm::cl::opt<bool>
 optShowInference("show-inference",
     llvm::cl::desc("Display debugging information for type inference"));
+static Diagnostics::DebugOption optShowInferenceDebug(optShowInference);
+
+static llvm::cl::opt<unsigned>
+optSearchLimit("inference-search-limit",
+    llvm::cl::desc("Maximum number of overload choices tried during type inference"),
+    llvm::cl::init(5000));
 
 bool unifyVerbose = false;
 bool showInference = false;
 
+static StatCounter numInferenceRuns("inference-runs", "Type inference runs");
+static StatCounter numBacktracks("inference-backtracks", "Type inference backtracks");
+static StatCounter numSearchChoices("inference-choices", "Type inference overload choices tried");
+static StatCounter numPropagationCulls("inference-propagation-culls",
+    "Type inference candidates culled by propagation");
+static StatCounter numSearchLimitHits("inference-limit-hits",
+    "Type inference searches that reached the search limit");
+
 // -------------------------------------------------------------------
 // TypeInference
 
 Expr * TypeInferencePass::run(Module * module, Expr * in, BindingEnv & env,
     QualifiedType expected, bool strict) {
+  PhaseScope scope(Phase::TypeInference);
+  ++numInferenceRuns;
   TypeInferencePass instance(module, in, env, expected, strict);
   return instance.runImpl();
 }
 
+unsigned TypeInferencePass::searchLimit() {
+  return optSearchLimit;
+}
+
+void TypeInferencePass::setSearchLimit(unsigned limit) {
+  optSearchLimit = limit;
+}
+
 Expr * TypeInferencePass::runImpl() {
   showInference = optShowInference;
 
@@ -600,7 +625,18 @@ void TypeInferencePass::cullByElimination() {
       reportRanks(INTERMEDIATE);
       diag.indent();
     }
-    cullByElimination(calls_.begin(), calls_.end());
+
+    searchCount_ = 0;
+    searchLimitExceeded_ = false;
+    searchByElimination();
+    if (searchLimitExceeded_) {
+      ++numSearchLimitHits;
+      diag.warn(rootExpr_) << "Type inference gave up after trying " << searchCount_ <<
+          " overload choices for '" << rootExpr_ << "'";
+      diag.info(rootExpr_) << "Adding explicit types to the arguments will reduce the " <<
+          "number of overloads to consider; or use -inference-search-limit to raise the limit.";
+    }
+
     if (bestSolutionCount_ == 1) {
       for (CallSites::iterator it = calls_.begin(); it != calls_.end(); ++it) {
         (*it)->cullAllExceptBest(searchDepth_);
@@ -615,45 +651,97 @@ void TypeInferencePass::cullByElimination() {
   }
 }
 
-void TypeInferencePass::cullByElimination(
-  CallSites::iterator first, CallSites::iterator last) {
-  while (first < last && underconstrained_) {
-    CallSite * cs = *first;
-    if (cs->remaining() <= 1) {
-      DASSERT(cs->remaining() > 0);
-      ++first;
-    } else {
-      int numChoices = cs->count();
-      for (int ch = 0; ch < numChoices; ++ch) {
-        if (cs->isCulled(ch)) {
-          continue;
-        }
+void TypeInferencePass::searchByElimination() {
+  CallSite * cs = selectSite();
+  if (cs == NULL) {
+    DASSERT(!overconstrained_);
+    checkSolution();
+    return;
+  }
 
-        if (showInference) {
-          diag.debug() << Format_Type << "Trying " << cs->expr();
-          diag.indent();
-        }
+  int numChoices = cs->count();
+  for (int ch = 0; ch < numChoices; ++ch) {
+    if (cs->isCulled(ch)) {
+      continue;
+    }
 
-        ++searchDepth_;
-        cs->cullAllExcept(ch, searchDepth_);
-        cullByElimination(first + 1, last);
-        backtrack();
+    if (searchCount_ >= optSearchLimit) {
+      searchLimitExceeded_ = true;
+      return;
+    }
 
-        if (showInference) {
-          diag.unindent();
-        }
-      }
+    ++searchCount_;
+    ++numSearchChoices;
+    if (showInference) {
+      diag.debug() << Format_Type << "Trying " << cs->candidate(ch);
+      diag.indent();
+    }
 
+    ++searchDepth_;
+    cs->cullAllExcept(ch, searchDepth_);
+    if (propagate()) {
+      searchByElimination();
+    } else if (showInference) {
+      diag.debug() << "No solution, backtracking";
+    }
+    backtrack();
+
+    if (showInference) {
+      diag.unindent();
+    }
+
+    if (searchLimitExceeded_) {
       return;
     }
   }
+}
 
-  update();
-  DASSERT(!overconstrained_);
-  checkSolution();
+bool TypeInferencePass::propagate() {
+  // The conversion rank of a candidate is the best rank it could have over all of the
+  // types that its arguments might still take on, so a candidate that is incompatible
+  // now will remain so however the other sites are decided. Removing it may in turn
+  // narrow the argument types of other sites, so repeat until nothing changes.
+  // Culls are made at the current search depth, so backtracking undoes them.
+  for (;;) {
+    update();
+    if (overconstrained_) {
+      return false;
+    }
+
+    int culled = 0;
+    for (CallSites::iterator it = calls_.begin(); it != calls_.end(); ++it) {
+      CallSite * site = *it;
+      if (site->remaining() > 1 && site->rank() == Incompatible) {
+        culled += site->cullByConversionRank(QualifierLoss, searchDepth_);
+      }
+    }
+
+    if (culled == 0) {
+      // A decided site that is incompatible rules out this branch, since no
+      // solution of rank Incompatible is ever chosen.
+      return lowestRank_ > Incompatible;
+    }
+
+    numPropagationCulls += culled;
+  }
+}
+
+CallSite * TypeInferencePass::selectSite() {
+  // Decide the most constrained site first; it has the fewest branches to explore
+  // and is the most likely to fail early.
+  CallSite * result = NULL;
+  for (CallSites::iterator it = calls_.begin(); it != calls_.end(); ++it) {
+    CallSite * site = *it;
+    if (site->remaining() > 1 && (result == NULL || site->remaining() < result->remaining())) {
+      result = site;
+    }
+  }
+
+  return result;
 }
 
 void TypeInferencePass::backtrack() {
+  ++numBacktracks;
   for (CallSites::iterator it = calls_.begin(); it != calls_.end(); ++it) {
     (*it)->backtrack(searchDepth_);
   }
@@ -15,6 +15,7 @@
 #include "tart/Sema/ScopeBuilder.h"
 #include "tart/Sema/TypeAnalyzer.h"
 
+#include "tart/Common/CompilerStats.h"
 #include "tart/Common/Diagnostics.h"
 
 #include "tart/Meta/MDReader.h"
@@ -26,6 +27,7 @@ namespace tart {
 typedef ASTDeclList::const_iterator decl_iterator;
 
 void ScopeBuilder::createScopeMembers(Defn * parent) {
+  PhaseScope scope(Phase::ScopeBuild);
   if (parent->mdNode()) {
     // Create definitions from Metadata Node.
     MDReader(parent->module(), parent).readMembers(parent);
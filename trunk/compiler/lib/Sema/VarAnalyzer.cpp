@@ -21,8 +21,15 @@
 
 #include "tart/Objects/Builtins.h"
 
+#include "tart/Common/CodeGenOption.h"
 #include "tart/Common/Diagnostics.h"
 
+#include "llvm/Support/CommandLine.h"
+
+static tart::CodeGenOption<bool>
+NoStaticEval("no-static-eval",
+    llvm::cl::desc("Don't evaluate static variable initializers at compile time"));
+
 namespace tart {
 
 static const VariableDefn::PassSet PASS_SET_RESOLVETYPE = VariableDefn::PassSet::of(
@@ -308,6 +315,14 @@ bool VarAnalyzer::resolveInitializers() {
                 diag.debug(initVal) << "Not a constant: " << initVal;
                 DFAIL("Implement");
               }
+            } else if (!initVal->isConstant() && !var->isThreadLocal() && !NoStaticEval) {
+              // If the initializer of a static variable is pure, evaluate it now so
+              // that the result can be emitted as static data instead of being
+              // computed by the module initialization function at startup.
+              Expr * constInitVal = EvalPass::evalStaticInitializer(module_, initVal);
+              if (constInitVal != NULL) {
+                var->setInitValue(constInitVal);
+              }
             }
           }
         }
@@ -11,27 +11,37 @@
 #include "tart/Sema/ParameterAssignments.h"
 #include "tart/Sema/TypeAnalyzer.h"
 
+#include "tart/Common/CodeGenOption.h"
 #include "tart/Common/Diagnostics.h"
 #include "tart/Common/Hashing.h"
 
 #include "tart/Objects/Builtins.h"
+#include "tart/Objects/TargetSelection.h"
 
 #include "llvm/DerivedTypes.h"
+#include "llvm/Support/CommandLine.h"
 
 namespace tart {
 
+static CodeGenOption<unsigned>
+RegisterReturnWords("reg-return-words",
+    llvm::cl::desc("Return value types of up to this many words in registers"),
+    llvm::cl::value_desc("words"), llvm::cl::init(3));
+
 // -------------------------------------------------------------------
 // FunctionType
 
 FunctionType::FunctionType(QualifiedType rtype, ParameterList & plist)
   : Type(Function)
   , isStatic_(false)
+  , isExtern_(false)
   , returnType_(rtype)
   , selfParam_(NULL)
   , paramTypes_(NULL)
   , irType_(NULL)
   , isCreatingType(false)
   , isStructReturn_(false)
+  , isRegisterReturn_(false)
   , isInvocable_(false)
 {
   for (ParameterList::iterator it = plist.begin(); it != plist.end(); ++it) {
@@ -42,12 +52,14 @@ FunctionType::FunctionType(QualifiedType rtype, ParameterList & plist)
 FunctionType::FunctionType(QualifiedType rtype, ParameterDefn ** plist, size_t pcount)
   : Type(Function)
   , isStatic_(false)
+  , isExtern_(false)
   , returnType_(rtype)
   , selfParam_(NULL)
   , paramTypes_(NULL)
   , irType_(NULL)
   , isCreatingType(false)
   , isStructReturn_(false)
+  , isRegisterReturn_(false)
   , isInvocable_(false)
 {
   for (size_t i = 0; i < pcount; ++i) {
@@ -59,12 +71,14 @@ FunctionType::FunctionType(
     QualifiedType rtype, ParameterDefn * selfParam, ParameterDefn ** plist, size_t pcount)
   : Type(Function)
   , isStatic_(false)
+  , isExtern_(false)
   , returnType_(rtype)
   , selfParam_(selfParam)
   , paramTypes_(NULL)
   , irType_(NULL)
   , isCreatingType(false)
   , isStructReturn_(false)
+  , isRegisterReturn_(false)
   , isInvocable_(false)
 {
   for (size_t i = 0; i < pcount; ++i) {
@@ -116,6 +130,12 @@ bool FunctionType::isStructReturn() const {
   return isStructReturn_;
 }
 
+bool FunctionType::isRegisterReturn() const {
+  DASSERT(irType_ != NULL) << "Getting isRegisterReturn before irType has been settled.";
+
+  return isRegisterReturn_;
+}
+
 llvm::Type * FunctionType::irType() const {
   if (irType_ == NULL) {
     if (!isCreatingType) {
@@ -154,12 +174,24 @@ llvm::FunctionType * FunctionType::createIRFunctionType(
   // Types of the function parameters.
   std::vector<llvm::Type *> parameterTypes;
 
-  // See if we need to use a struct return.
+  // See if we need to use a struct return. Tuples, structs and unions of only a few
+  // words can be returned in registers instead - but not from C functions, which return
+  // them in memory.
   llvm::Type * rType = returnType->irReturnType();
   if (returnType->typeShape() == Shape_Large_Value) {
-    parameterTypes.push_back(rType);
-    rType = llvm::Type::getVoidTy(llvm::getGlobalContext());
-    isStructReturn_ = true;
+    const Type * rt = returnType.dealias().unqualified();
+    const llvm::TargetData * td = TargetSelection::instance.targetData();
+    if (!isExtern_ &&
+        (rt->typeClass() == Type::Tuple || rt->typeClass() == Type::Struct ||
+            rt->typeClass() == Type::Union) &&
+        td->getTypeAllocSize(rt->irTypeComplete()) <= RegisterReturnWords * td->getPointerSize()) {
+      rType = rt->irType();
+      isRegisterReturn_ = true;
+    } else {
+      parameterTypes.push_back(rType);
+      rType = llvm::Type::getVoidTy(llvm::getGlobalContext());
+      isStructReturn_ = true;
+    }
   }
 
   // Insert the 'self' parameter if it's an instance method
@@ -263,6 +263,10 @@ bool FlexibleArrayType::isSingular() const {
   return typeArgs_->isSingular();
 }
 
+bool FlexibleArrayType::containsReferenceType() const {
+  return elementType()->isReferenceType() || elementType()->containsReferenceType();
+}
+
 void FlexibleArrayType::format(FormatStream & out) const {
   out << "FlexibleArray[" << elementType() << "]";
 }
@@ -20,6 +20,7 @@
 #include "tart/Type/TupleType.h"
 #include "tart/Type/TypeFunction.h"
 #include "tart/Type/TypeLiteral.h"
+#include "tart/Type/TypeQueryCache.h"
 #include "tart/Type/TypeRelation.h"
 #include "tart/Type/UnionType.h"
 #include "tart/Type/UnitType.h"
@@ -753,7 +754,7 @@ ConversionRank convertToTypeLiteral(
   return Incompatible;
 }
 
-ConversionRank convert(
+static ConversionRank convertImpl(
     const QualifiedType & srcType, Expr * srcExpr,
     const QualifiedType & dstType, Expr ** dstExpr, int options) {
 
@@ -1054,5 +1055,23 @@ ConversionRank convert(
   return Incompatible;
 }
 
+ConversionRank convert(
+    const QualifiedType & srcType, Expr * srcExpr,
+    const QualifiedType & dstType, Expr ** dstExpr, int options) {
+  // When there is no expression to convert, the result depends only on the types.
+  if (srcExpr == NULL && dstExpr == NULL &&
+      TypeQueryCache::isCacheable(TypeQueryCache::Convert, srcType, dstType)) {
+    int result;
+    if (!TypeQueryCache::lookup(TypeQueryCache::Convert, srcType, dstType, options, result)) {
+      result = convertImpl(srcType, NULL, dstType, NULL, options);
+      TypeQueryCache::insert(TypeQueryCache::Convert, srcType, dstType, options, result);
+    }
+
+    return ConversionRank(result);
+  }
+
+  return convertImpl(srcType, srcExpr, dstType, dstExpr, options);
+}
+
 } // namespace TypeConversion
 } // namespace tart
@@ -0,0 +1,144 @@
+/* ================================================================ *
+    TART - A Sweet Programming Language.
+ * ================================================================ */
+
+#include "tart/Type/CompositeType.h"
+#include "tart/Type/EnumType.h"
+#include "tart/Type/TypeQueryCache.h"
+
+#include "tart/Common/CompilerStats.h"
+#include "tart/Common/GC.h"
+
+#include "llvm/ADT/DenseMap.h"
+
+namespace tart {
+namespace TypeQueryCache {
+
+namespace {
+
+  /** Key for a single query. */
+  struct QueryKey {
+    const Type * src;
+    const Type * dst;
+    unsigned srcQualifiers;
+    unsigned dstQualifiers;
+    int kind;
+    int options;
+
+    QueryKey(const Type * s, const Type * d, unsigned sq = 0, unsigned dq = 0, int k = 0,
+        int opts = 0)
+      : src(s), dst(d), srcQualifiers(sq), dstQualifiers(dq), kind(k), options(opts) {}
+
+    struct KeyInfo {
+      static inline QueryKey getEmptyKey() {
+        return QueryKey(Type::KeyInfo::getEmptyKey(), Type::KeyInfo::getEmptyKey());
+      }
+
+      static inline QueryKey getTombstoneKey() {
+        return QueryKey(Type::KeyInfo::getTombstoneKey(), Type::KeyInfo::getTombstoneKey());
+      }
+
+      static unsigned getHashValue(const QueryKey & val) {
+        return Type::KeyInfo::getHashValue(val.src) ^
+            (Type::KeyInfo::getHashValue(val.dst) << 1) ^
+            (val.srcQualifiers << 8) ^ (val.dstQualifiers << 16) ^
+            (val.kind << 24) ^ (val.options * 0x9e3779b9);
+      }
+
+      static bool isEqual(const QueryKey & lhs, const QueryKey & rhs) {
+        return lhs.src == rhs.src && lhs.dst == rhs.dst &&
+            lhs.srcQualifiers == rhs.srcQualifiers && lhs.dstQualifiers == rhs.dstQualifiers &&
+            lhs.kind == rhs.kind && lhs.options == rhs.options;
+      }
+
+      static bool isPod() { return true; }
+    };
+  };
+
+  typedef llvm::DenseMap<QueryKey, int, QueryKey::KeyInfo> QueryMap;
+
+  QueryMap results;
+  StatCounter numHits("type-query-hits", "Type query cache hits");
+  StatCounter numMisses("type-query-misses", "Type query cache misses");
+  StatCounter numClears("type-query-clears", "Type query cache clears");
+
+  /** The cache holds no references to the types in it; instead, it is
+      emptied whenever a collection happens. */
+  class SweepHook : public GC::Callback {
+    void call() {
+      clear();
+    }
+  };
+
+  SweepHook hook;
+  bool hookRegistered = false;
+
+  bool isClosedType(QueryKind kind, const Type * ty) {
+    switch (ty->typeClass()) {
+      case Type::Primitive:
+        return true;
+
+      case Type::Enum:
+        return static_cast<const EnumType *>(ty)->passes().isFinished(EnumType::BaseTypePass);
+
+      case Type::Class:
+      case Type::Struct:
+      case Type::Interface: {
+        // Subtype relations depend on the base class list, and conversions depend
+        // on the list of coercers, so don't cache anything until they are known.
+        const CompositeType * ctype = static_cast<const CompositeType *>(ty);
+        if (!ctype->isSingular() || !ctype->passes().isFinished(CompositeType::BaseTypesPass)) {
+          return false;
+        }
+
+        return kind != Convert || ctype->passes().isFinished(CompositeType::CoercerPass);
+      }
+
+      default:
+        return false;
+    }
+  }
+}
+
+bool isCacheable(QueryKind kind, const QualifiedType & src, const QualifiedType & dst) {
+  return isClosedType(kind, src.type()) && isClosedType(kind, dst.type());
+}
+
+bool lookup(QueryKind kind, const QualifiedType & src, const QualifiedType & dst,
+    int options, int & result) {
+  QueryMap::const_iterator it = results.find(
+      QueryKey(src.type(), dst.type(), src.qualifiers(), dst.qualifiers(), kind, options));
+  if (it != results.end()) {
+    ++numHits;
+    result = it->second;
+    return true;
+  }
+
+  ++numMisses;
+  return false;
+}
+
+void insert(QueryKind kind, const QualifiedType & src, const QualifiedType & dst,
+    int options, int result) {
+  if (!hookRegistered) {
+    hookRegistered = true;
+    GC::registerSweepCallback(&hook);
+  }
+
+  results[QueryKey(src.type(), dst.type(), src.qualifiers(), dst.qualifiers(), kind, options)] =
+      result;
+}
+
+void clear() {
+  if (!results.empty()) {
+    ++numClears;
+    results.clear();
+  }
+}
+
+unsigned size() {
+  return results.size();
+}
+
+} // namespace TypeQueryCache
+} // namespace tart
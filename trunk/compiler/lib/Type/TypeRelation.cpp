@@ -17,6 +17,7 @@
 #include "tart/Type/TypeAlias.h"
 #include "tart/Type/TypeFunction.h"
 #include "tart/Type/TypeLiteral.h"
+#include "tart/Type/TypeQueryCache.h"
 #include "tart/Type/TypeRelation.h"
 #include "tart/Type/UnionType.h"
 #include "tart/Type/UnitType.h"
@@ -147,7 +148,7 @@ static bool isEqualUnion(Qualified<UnionType> lut, Qualified<UnionType> rut) {
   return false;
 }
 
-bool TypeRelation::isEqual(const QualifiedType & lt, const QualifiedType & rt) {
+static bool isEqualImpl(const QualifiedType & lt, const QualifiedType & rt) {
   // Early out
   if (lt.unqualified() == rt.unqualified() && lt.qualifiers() == rt.qualifiers()) {
     return true;
@@ -155,7 +156,7 @@ bool TypeRelation::isEqual(const QualifiedType & lt, const QualifiedType & rt) {
 
   switch (rt->typeClass()) {
     case Type::Alias:
-      return isEqual(lt, rt.as<TypeAlias>()->value());
+      return TypeRelation::isEqual(lt, rt.as<TypeAlias>()->value());
 
     case Type::AmbiguousParameter:
     case Type::AmbiguousPhi:
@@ -167,7 +168,7 @@ bool TypeRelation::isEqual(const QualifiedType & lt, const QualifiedType & rt) {
         return false;
       }
       for (QualifiedTypeSet::iterator it = expansion.begin(); it != expansion.end(); ++it) {
-        if (!isEqual(lt, *it)) {
+        if (!TypeRelation::isEqual(lt, *it)) {
           return false;
         }
       }
@@ -177,7 +178,7 @@ bool TypeRelation::isEqual(const QualifiedType & lt, const QualifiedType & rt) {
     case Type::Assignment: {
       Qualified<TypeAssignment> ta = rt.as<TypeAssignment>();
       if (ta->value()) {
-        return isEqual(lt, ta->value());
+        return TypeRelation::isEqual(lt, ta->value());
       }
       return false;
     }
@@ -185,10 +186,11 @@ bool TypeRelation::isEqual(const QualifiedType & lt, const QualifiedType & rt) {
     case Type::TypeFnCall: {
       Qualified<TypeFunctionCall> rcall = rt.as<TypeFunctionCall>();
       if (const TypeFunction * tfn = dyn_cast<TypeFunction>(dealias(rcall->fnVal()))) {
-        return isEqual(lt, tfn->apply(rcall->args()) | rt.qualifiers());
+        return TypeRelation::isEqual(lt, tfn->apply(rcall->args()) | rt.qualifiers());
       }
       if (Qualified<TypeFunctionCall> tfcall = lt.dyn_cast<TypeFunctionCall>()) {
-        return isEqual(tfcall->fnVal(), rcall->fnVal()) && isEqual(tfcall->args(), rcall->args());
+        return TypeRelation::isEqual(tfcall->fnVal(), rcall->fnVal())
+            && TypeRelation::isEqual(tfcall->args(), rcall->args());
       }
       // Left side might be an alias to a TypeFunction, so keep going.
       break;
@@ -200,7 +202,7 @@ bool TypeRelation::isEqual(const QualifiedType & lt, const QualifiedType & rt) {
 
   switch (lt->typeClass()) {
     case Type::Alias:
-      return isEqual(lt.as<TypeAlias>()->value() | lt.qualifiers(), rt);
+      return TypeRelation::isEqual(lt.as<TypeAlias>()->value() | lt.qualifiers(), rt);
 
     case Type::Primitive:
       if (lt->isUnsizedIntType() && rt->isUnsizedIntType()) {
@@ -231,7 +233,8 @@ bool TypeRelation::isEqual(const QualifiedType & lt, const QualifiedType & rt) {
 
     case Type::NAddress: {
       if (rt.isa<AddressType>()) {
-        return isEqual(lt->typeParam(0), rt->typeParam(0)) && lt.qualifiers() == rt.qualifiers();
+        return TypeRelation::isEqual(lt->typeParam(0), rt->typeParam(0))
+            && lt.qualifiers() == rt.qualifiers();
       }
       return false;
     }
@@ -240,7 +243,7 @@ bool TypeRelation::isEqual(const QualifiedType & lt, const QualifiedType & rt) {
       if (rt.isa<NativeArrayType>()) {
         Qualified<NativeArrayType> lnat = lt.as<NativeArrayType>();
         Qualified<NativeArrayType> rnat = rt.as<NativeArrayType>();
-        return isEqual(lnat->typeParam(0), rnat->typeParam(0))
+        return TypeRelation::isEqual(lnat->typeParam(0), rnat->typeParam(0))
             && lt.qualifiers() == rt.qualifiers()
             && lnat->size() == rnat->size();
       }
@@ -249,7 +252,8 @@ bool TypeRelation::isEqual(const QualifiedType & lt, const QualifiedType & rt) {
 
     case Type::FlexibleArray: {
       if (rt.isa<FlexibleArrayType>()) {
-        return isEqual(lt->typeParam(0), rt->typeParam(0)) && lt.qualifiers() == rt.qualifiers();
+        return TypeRelation::isEqual(lt->typeParam(0), rt->typeParam(0))
+            && lt.qualifiers() == rt.qualifiers();
       }
       return false;
     }
@@ -284,7 +288,7 @@ bool TypeRelation::isEqual(const QualifiedType & lt, const QualifiedType & rt) {
 
     case Type::TypeLiteral: {
       if (rt.isa<TypeLiteralType>()) {
-        return isEqual(
+        return TypeRelation::isEqual(
             lt.as<TypeLiteralType>()->literalType(), rt.as<TypeLiteralType>()->literalType());
       }
       return false;
@@ -300,7 +304,7 @@ bool TypeRelation::isEqual(const QualifiedType & lt, const QualifiedType & rt) {
         return false;
       }
       for (QualifiedTypeSet::iterator it = expansion.begin(); it != expansion.end(); ++it) {
-        if (!isEqual(*it, rt)) {
+        if (!TypeRelation::isEqual(*it, rt)) {
           return false;
         }
       }
@@ -310,7 +314,7 @@ bool TypeRelation::isEqual(const QualifiedType & lt, const QualifiedType & rt) {
     case Type::Assignment: {
       Qualified<TypeAssignment> ta = lt.as<TypeAssignment>();
       if (ta->value()) {
-        return isEqual(ta->value(), rt);
+        return TypeRelation::isEqual(ta->value(), rt);
       }
       return false;
     }
@@ -318,7 +322,7 @@ bool TypeRelation::isEqual(const QualifiedType & lt, const QualifiedType & rt) {
     case Type::TypeFnCall: {
       Qualified<TypeFunctionCall> tfcall = lt.as<TypeFunctionCall>();
       if (const TypeFunction * tfn = dyn_cast<TypeFunction>(dealias(tfcall->fnVal()))) {
-        return isEqual(tfn->apply(tfcall->args()) | lt.qualifiers(), rt);
+        return TypeRelation::isEqual(tfn->apply(tfcall->args()) | lt.qualifiers(), rt);
       }
       return false;
     }
@@ -338,7 +342,21 @@ bool TypeRelation::isEqual(const QualifiedType & lt, const QualifiedType & rt) {
   return false;
 }
 
-bool TypeRelation::isSubtype(const QualifiedType & ty, const QualifiedType & base) {
+bool TypeRelation::isEqual(const QualifiedType & lt, const QualifiedType & rt) {
+  if (TypeQueryCache::isCacheable(TypeQueryCache::IsEqual, lt, rt)) {
+    int result;
+    if (!TypeQueryCache::lookup(TypeQueryCache::IsEqual, lt, rt, 0, result)) {
+      result = isEqualImpl(lt, rt);
+      TypeQueryCache::insert(TypeQueryCache::IsEqual, lt, rt, 0, result);
+    }
+
+    return result != 0;
+  }
+
+  return isEqualImpl(lt, rt);
+}
+
+static bool isSubtypeImpl(const QualifiedType & ty, const QualifiedType & base) {
   if (!canAssignQualifiers(ty.qualifiers(), base.qualifiers())) {
     return false;
   } else if (ty.unqualified() == base.unqualified()) {
@@ -348,7 +366,7 @@ bool TypeRelation::isSubtype(const QualifiedType & ty, const QualifiedType & bas
   // Special cases for ambiguous base types.
   switch (base->typeClass()) {
     case Type::Alias:
-      return isSubtype(ty, base.as<TypeAlias>()->value() | base.qualifiers());
+      return TypeRelation::isSubtype(ty, base.as<TypeAlias>()->value() | base.qualifiers());
 
     case Type::Protocol:
       // Special case for protocols - implicit inheritance
@@ -368,7 +386,7 @@ bool TypeRelation::isSubtype(const QualifiedType & ty, const QualifiedType & bas
         return false;
       }
       for (QualifiedTypeSet::iterator it = expansion.begin(); it != expansion.end(); ++it) {
-        if (!isSubtype(ty, *it)) {
+        if (!TypeRelation::isSubtype(ty, *it)) {
           return false;
         }
       }
@@ -378,7 +396,7 @@ bool TypeRelation::isSubtype(const QualifiedType & ty, const QualifiedType & bas
     case Type::Assignment: {
       Qualified<TypeAssignment> ta = base.as<TypeAssignment>();
       if (ta->value()) {
-        return isSubtype(ty, ta->value());
+        return TypeRelation::isSubtype(ty, ta->value());
       } else {
         bool any = false;
         for (ConstraintSet::const_iterator si = ta->begin(), sEnd = ta->end(); si != sEnd; ++si) {
@@ -392,7 +410,7 @@ bool TypeRelation::isSubtype(const QualifiedType & ty, const QualifiedType & bas
             }
 
             cst->setVisited(true);
-            if (!isSubtype(ty, cst->value())) {
+            if (!TypeRelation::isSubtype(ty, cst->value())) {
               cst->setVisited(false);
               return false;
             }
@@ -407,7 +425,7 @@ bool TypeRelation::isSubtype(const QualifiedType & ty, const QualifiedType & bas
     case Type::TypeFnCall: {
       Qualified<TypeFunctionCall> tfcall = base.as<TypeFunctionCall>();
       if (const TypeFunction * tfn = dyn_cast<TypeFunction>(dealias(tfcall->fnVal()))) {
-        return isSubtype(ty, tfn->apply(tfcall->args()) | ty.qualifiers());
+        return TypeRelation::isSubtype(ty, tfn->apply(tfcall->args()) | ty.qualifiers());
       }
       return false;
     }
@@ -418,7 +436,7 @@ bool TypeRelation::isSubtype(const QualifiedType & ty, const QualifiedType & bas
 
   switch (ty->typeClass()) {
     case Type::Alias:
-      return isSubtype(ty.as<TypeAlias>()->value() | ty.qualifiers(), base);
+      return TypeRelation::isSubtype(ty.as<TypeAlias>()->value() | ty.qualifiers(), base);
 
     case Type::Primitive: {
       // TODO: Factor in qualifiers
@@ -448,7 +466,7 @@ bool TypeRelation::isSubtype(const QualifiedType & ty, const QualifiedType & bas
         // They aren't the same, check all base classes
         const ClassList & bases = ctType->bases();
         for (ClassList::const_iterator it = bases.begin(); it != bases.end(); ++it) {
-          if (isSubtype(*it, base)) {
+          if (TypeRelation::isSubtype(*it, base)) {
             return true;
           }
         }
@@ -461,7 +479,7 @@ bool TypeRelation::isSubtype(const QualifiedType & ty, const QualifiedType & bas
       // TODO: Factor in qualifiers
       Qualified<EnumType> eTy = ty.as<EnumType>();
       if (base.isa<PrimitiveType>()) {
-        return isSubtype(eTy->baseType(), base);
+        return TypeRelation::isSubtype(eTy->baseType(), base);
       }
       return false;
     }
@@ -476,7 +494,7 @@ bool TypeRelation::isSubtype(const QualifiedType & ty, const QualifiedType & bas
     case Type::TypeLiteral:
     case Type::TypeVar:
       // None of these types support a subclass relationship, so equality is the only option.
-      return isEqual(ty, base);
+      return TypeRelation::isEqual(ty, base);
 
     case Type::AmbiguousParameter:
     case Type::AmbiguousPhi:
@@ -488,7 +506,7 @@ bool TypeRelation::isSubtype(const QualifiedType & ty, const QualifiedType & bas
         return false;
       }
       for (QualifiedTypeSet::iterator it = expansion.begin(); it != expansion.end(); ++it) {
-        if (!isSubtype(*it, base)) {
+        if (!TypeRelation::isSubtype(*it, base)) {
           return false;
         }
       }
@@ -498,7 +516,7 @@ bool TypeRelation::isSubtype(const QualifiedType & ty, const QualifiedType & bas
     case Type::Assignment: {
       Qualified<TypeAssignment> ta = ty.as<TypeAssignment>();
       if (ta->value()) {
-        return isSubtype(ta->value(), base);
+        return TypeRelation::isSubtype(ta->value(), base);
       } else {
         bool any = false;
         for (ConstraintSet::const_iterator si = ta->begin(), sEnd = ta->end(); si != sEnd; ++si) {
@@ -512,7 +530,7 @@ bool TypeRelation::isSubtype(const QualifiedType & ty, const QualifiedType & bas
             }
 
             cst->setVisited(true);
-            if (!isSubtype(cst->value(), base)) {
+            if (!TypeRelation::isSubtype(cst->value(), base)) {
               cst->setVisited(false);
               return false;
             }
@@ -536,7 +554,7 @@ bool TypeRelation::isSubtype(const QualifiedType & ty, const QualifiedType & bas
     case Type::TypeFnCall: {
       Qualified<TypeFunctionCall> tfcall = ty.as<TypeFunctionCall>();
       if (const TypeFunction * tfn = dyn_cast<TypeFunction>(dealias(tfcall->fnVal()))) {
-        return isSubtype(tfn->apply(tfcall->args()) | ty.qualifiers(), base);
+        return TypeRelation::isSubtype(tfn->apply(tfcall->args()) | ty.qualifiers(), base);
       }
       return false;
     }
@@ -549,7 +567,21 @@ bool TypeRelation::isSubtype(const QualifiedType & ty, const QualifiedType & bas
   return false;
 }
 
-bool TypeRelation::isSubclass(const QualifiedType & ty, const QualifiedType & base) {
+bool TypeRelation::isSubtype(const QualifiedType & ty, const QualifiedType & base) {
+  if (TypeQueryCache::isCacheable(TypeQueryCache::IsSubtype, ty, base)) {
+    int result;
+    if (!TypeQueryCache::lookup(TypeQueryCache::IsSubtype, ty, base, 0, result)) {
+      result = isSubtypeImpl(ty, base);
+      TypeQueryCache::insert(TypeQueryCache::IsSubtype, ty, base, 0, result);
+    }
+
+    return result != 0;
+  }
+
+  return isSubtypeImpl(ty, base);
+}
+
+static bool isSubclassImpl(const QualifiedType & ty, const QualifiedType & base) {
   if (!canAssignQualifiers(ty.qualifiers(), base.qualifiers())) {
     return false;
   } else if (ty.unqualified() == base.unqualified()) {
@@ -559,7 +591,7 @@ bool TypeRelation::isSubclass(const QualifiedType & ty, const QualifiedType & ba
   // Special cases for ambiguous base types.
   switch (base->typeClass()) {
     case Type::Alias:
-      return isSubclass(ty, base.as<TypeAlias>()->value() | base.qualifiers());
+      return TypeRelation::isSubclass(ty, base.as<TypeAlias>()->value() | base.qualifiers());
 
     case Type::AmbiguousParameter:
     case Type::AmbiguousPhi:
@@ -571,7 +603,7 @@ bool TypeRelation::isSubclass(const QualifiedType & ty, const QualifiedType & ba
         return false;
       }
       for (QualifiedTypeSet::iterator it = expansion.begin(); it != expansion.end(); ++it) {
-        if (!isSubclass(ty, *it)) {
+        if (!TypeRelation::isSubclass(ty, *it)) {
           return false;
         }
       }
@@ -581,7 +613,7 @@ bool TypeRelation::isSubclass(const QualifiedType & ty, const QualifiedType & ba
     case Type::Assignment: {
       Qualified<TypeAssignment> ta = base.as<TypeAssignment>();
       if (ta->value()) {
-        return isSubclass(ty, ta->value());
+        return TypeRelation::isSubclass(ty, ta->value());
       } else {
         bool any = false;
         for (ConstraintSet::const_iterator si = ta->begin(), sEnd = ta->end(); si != sEnd; ++si) {
@@ -595,7 +627,7 @@ bool TypeRelation::isSubclass(const QualifiedType & ty, const QualifiedType & ba
             }
 
             cst->setVisited(true);
-            if (!isSubclass(ty, cst->value())) {
+            if (!TypeRelation::isSubclass(ty, cst->value())) {
               cst->setVisited(false);
               return false;
             }
@@ -610,7 +642,7 @@ bool TypeRelation::isSubclass(const QualifiedType & ty, const QualifiedType & ba
     case Type::TypeFnCall: {
       Qualified<TypeFunctionCall> tfcall = base.as<TypeFunctionCall>();
       if (const TypeFunction * tfn = dyn_cast<TypeFunction>(dealias(tfcall->fnVal()))) {
-        return isSubclass(ty, tfn->apply(tfcall->args()) | ty.qualifiers());
+        return TypeRelation::isSubclass(ty, tfn->apply(tfcall->args()) | ty.qualifiers());
       }
       return false;
     }
@@ -621,7 +653,7 @@ bool TypeRelation::isSubclass(const QualifiedType & ty, const QualifiedType & ba
 
   switch (ty->typeClass()) {
     case Type::Alias:
-      return isSubclass(ty.as<TypeAlias>()->value() | ty.qualifiers(), base);
+      return TypeRelation::isSubclass(ty.as<TypeAlias>()->value() | ty.qualifiers(), base);
 
     case Type::Primitive: {
       return false;
@@ -645,7 +677,7 @@ bool TypeRelation::isSubclass(const QualifiedType & ty, const QualifiedType & ba
         // They aren't the same, check all base classes
         const ClassList & bases = ctType->bases();
         for (ClassList::const_iterator it = bases.begin(); it != bases.end(); ++it) {
-          if (isSubclass(*it, base)) {
+          if (TypeRelation::isSubclass(*it, base)) {
             return true;
           }
         }
@@ -664,7 +696,7 @@ bool TypeRelation::isSubclass(const QualifiedType & ty, const QualifiedType & ba
         return false;
       }
       for (QualifiedTypeSet::iterator it = expansion.begin(); it != expansion.end(); ++it) {
-        if (!isSubclass(*it, base)) {
+        if (!TypeRelation::isSubclass(*it, base)) {
           return false;
         }
       }
@@ -674,7 +706,7 @@ bool TypeRelation::isSubclass(const QualifiedType & ty, const QualifiedType & ba
     case Type::Assignment: {
       Qualified<TypeAssignment> ta = ty.as<TypeAssignment>();
       if (ta->value()) {
-        return isSubclass(ta->value(), base);
+        return TypeRelation::isSubclass(ta->value(), base);
       } else {
         bool any = false;
         for (ConstraintSet::const_iterator si = ta->begin(), sEnd = ta->end(); si != sEnd; ++si) {
@@ -688,7 +720,7 @@ bool TypeRelation::isSubclass(const QualifiedType & ty, const QualifiedType & ba
             }
 
             cst->setVisited(true);
-            if (!isSubclass(cst->value(), base)) {
+            if (!TypeRelation::isSubclass(cst->value(), base)) {
               cst->setVisited(false);
               return false;
             }
@@ -704,7 +736,7 @@ bool TypeRelation::isSubclass(const QualifiedType & ty, const QualifiedType & ba
     case Type::TypeFnCall: {
       Qualified<TypeFunctionCall> tfcall = ty.as<TypeFunctionCall>();
       if (const TypeFunction * tfn = dyn_cast<TypeFunction>(dealias(tfcall->fnVal()))) {
-        return isSubclass(tfn->apply(tfcall->args()) | ty.qualifiers(), base);
+        return TypeRelation::isSubclass(tfn->apply(tfcall->args()) | ty.qualifiers(), base);
       }
       return false;
     }
@@ -716,6 +748,20 @@ bool TypeRelation::isSubclass(const QualifiedType & ty, const QualifiedType & ba
   return false;
 }
 
+bool TypeRelation::isSubclass(const QualifiedType & ty, const QualifiedType & base) {
+  if (TypeQueryCache::isCacheable(TypeQueryCache::IsSubclass, ty, base)) {
+    int result;
+    if (!TypeQueryCache::lookup(TypeQueryCache::IsSubclass, ty, base, 0, result)) {
+      result = isSubclassImpl(ty, base);
+      TypeQueryCache::insert(TypeQueryCache::IsSubclass, ty, base, 0, result);
+    }
+
+    return result != 0;
+  }
+
+  return isSubclassImpl(ty, base);
+}
+
 TypeRelation::RelativeSpecificity TypeRelation::isMoreSpecific(
     const QualifiedType & lhs, const QualifiedType & rhs) {
   if (lhs.isa<TypeAlias>()) {
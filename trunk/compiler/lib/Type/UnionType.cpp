@@ -125,6 +125,10 @@ bool UnionType::hasRefTypesOnly() const {
   return numValueTypes_ == 0 && !hasVoidType_;
 }
 
+bool UnionType::isRefOrVoidType() const {
+  return numValueTypes_ == 0 && numReferenceTypes_ > 0 && hasVoidType_;
+}
+
 bool UnionType::isSingleOptionalType() const {
   if (numValueTypes_ == 0) {
     return (hasNullType_ && !hasVoidType_ && numReferenceTypes_ == 1);
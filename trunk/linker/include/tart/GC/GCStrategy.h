@@ -112,6 +112,9 @@ public:
   void finishAssembly(AsmPrinter &AP);
 
 private:
+  /** Return true if a sorted list of field offsets can be encoded as 16-bit deltas. */
+  static bool canDeltaEncode(const StackTraceTable::FieldOffsetList & offsets);
+
   /** Convert a complex constant to a plain integer. */
   int64_t toInt(llvm::Constant * c, TargetMachine & tm);
 
@@ -0,0 +1,110 @@
+/* ================================================================ *
+    TART - A Sweet Programming Language.
+ * ================================================================ */
+
+/** LLVM pass to remove array bounds checks which are implied by the loop
+    that contains them. */
+
+#ifndef TART_OPT_BOUNDSCHECKELIM_H
+#define TART_OPT_BOUNDSCHECKELIM_H
+
+#include "llvm/Pass.h"
+#include "llvm/Function.h"
+#include "llvm/Instructions.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/raw_ostream.h"
+
+namespace llvm {
+class DominatorTree;
+class Loop;
+class LoopInfo;
+class ScalarEvolution;
+class SCEVAddRecExpr;
+}
+
+namespace tart {
+using namespace llvm;
+
+/** Bounds check elimination pass.
+
+    The length of an Array, StaticList or BitArray (the integer field which
+    immediately precedes its flexible array) is fixed when the object is
+    allocated. Within a loop which doesn't assign a new object to the variable
+    holding the array, every load of the length therefore yields the same
+    value, and the loads can be replaced by a single load in the loop
+    preheader. Once that is done, scalar evolution can see that the
+    'index < length' test in an inlined index operator is the same as the
+    loop condition, and both halves of the check can be folded away.
+
+    This should run after inlining and loop rotation; the CFG cleanups that
+    follow it remove the branches to the failure path. */
+class BoundsCheckElim : public FunctionPass {
+public:
+  static char ID;
+
+  BoundsCheckElim()
+    : FunctionPass(ID)
+    , loopInfo_(NULL)
+    , domTree_(NULL)
+    , scev_(NULL)
+    , numLengthLoadsHoisted_(0)
+    , numChecks_(0)
+    , numChecksRemoved_(0)
+  {}
+
+  bool runOnFunction(Function & fn);
+  void getAnalysisUsage(AnalysisUsage & AU) const;
+
+  /** Print the number of checks that were removed. */
+  void printStats(raw_ostream & out) const;
+
+private:
+  typedef SmallVector<LoadInst *, 4> LoadList;
+
+  /** Loads of the same length field of the same object. */
+  struct LengthLoads {
+    Value * object;
+    LoadList loads;
+  };
+
+  typedef DenseMap<std::pair<Value *, unsigned>, LengthLoads> LengthLoadMap;
+
+  LoopInfo * loopInfo_;
+  DominatorTree * domTree_;
+  ScalarEvolution * scev_;
+
+  unsigned numLengthLoadsHoisted_;
+  unsigned numChecks_;
+  unsigned numChecksRemoved_;
+
+  bool processLoop(Loop * loop);
+  bool hoistLengthLoads(Loop * loop);
+  bool removeChecks(Loop * loop);
+
+  /** If 'load' reads the length of a variable-sized object, and the object is
+      the same in every iteration of 'loop', return a key identifying the object,
+      and set 'field' to the index of the length field. */
+  Value * lengthLoadKey(Loop * loop, LoadInst * load, unsigned & field);
+
+  /** Return true if 'inst' is executed every time the loop is entered. */
+  bool isGuaranteedToExecute(Loop * loop, Instruction * inst);
+
+  /** Return true if 'inst' is a call which may throw an exception. */
+  static bool mayThrow(Instruction * inst);
+
+  /** Return true if the value of 'ar' can't go below zero in any iteration. */
+  bool isNonNegative(const SCEVAddRecExpr * ar);
+
+  /** Return true if 'slot' is a local variable which is only ever loaded from,
+      stored to, or registered as a garbage collection root, and which is not
+      stored to within 'loop'. */
+  static bool isUnmodifiedSlot(Loop * loop, AllocaInst * slot);
+
+  /** Return true if field 'index' of 'type' is the length of a flexible array. */
+  static bool isLengthField(Type * type, unsigned index);
+};
+
+}
+
+#endif // TART_OPT_BOUNDSCHECKELIM_H
@@ -0,0 +1,92 @@
+/* ================================================================ *
+    TART - A Sweet Programming Language.
+ * ================================================================ */
+
+/** LLVM pass to resolve virtual and interface calls using whole-program
+    class hierarchy analysis. */
+
+#ifndef TART_OPT_DEVIRTUALIZER_H
+#define TART_OPT_DEVIRTUALIZER_H
+
+#include "llvm/Pass.h"
+#include "llvm/Function.h"
+#include "llvm/Instructions.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/raw_ostream.h"
+
+namespace tart {
+using namespace llvm;
+
+/** Devirtualization pass. This must only be run on a complete program, since it
+    assumes that every class which can be instantiated is visible in the module. */
+class Devirtualizer : public ModulePass {
+public:
+  static char ID;
+
+  Devirtualizer()
+    : ModulePass(ID)
+    , numVirtualCalls_(0)
+    , numVirtualCallsResolved_(0)
+    , numInterfaceCalls_(0)
+    , numInterfaceCallsResolved_(0)
+    , numDispatchCasesPruned_(0)
+  {}
+
+  ~Devirtualizer();
+
+  bool runOnModule(Module & module);
+
+  /** Print the number of call sites that were devirtualized. */
+  void printStats(raw_ostream & out) const;
+
+private:
+  typedef SmallPtrSet<GlobalVariable *, 16> TIBSet;
+  typedef SmallPtrSet<Function *, 64> FunctionSet;
+
+  /** Hierarchy information for a class or interface, read from its TIB. */
+  struct ClassInfo {
+    GlobalVariable * tib;
+    TIBSet bases;
+    Constant * methods;
+    Function * idispatch;
+  };
+
+  /** One branch of an interface dispatch function. */
+  struct DispatchCase {
+    GlobalVariable * iname;
+    GlobalVariable * itable;
+    ICmpInst * test;
+  };
+
+  typedef SmallVector<ClassInfo *, 64> ClassList;
+  typedef DenseMap<StructType *, GlobalVariable *> TypeMap;
+  typedef SmallVector<DispatchCase, 64> DispatchCaseList;
+
+  ClassList classes_;
+  TypeMap tibForType_;
+  DispatchCaseList dispatchCases_;
+  FunctionSet dispatchFunctions_;
+
+  unsigned numVirtualCalls_;
+  unsigned numVirtualCallsResolved_;
+  unsigned numInterfaceCalls_;
+  unsigned numInterfaceCallsResolved_;
+  unsigned numDispatchCasesPruned_;
+
+  bool readClassHierarchy(Module & module);
+  bool readDispatchCases(Function * idispatch);
+  bool resolveVirtualCall(LoadInst * methodLoad);
+  bool resolveInterfaceCall(Instruction * call);
+  void pruneDispatchCases(Module & module);
+
+  /** Look up the function at 'index' in a method table. 'method' is set to NULL if the
+      entry is null, meaning an abstract method. Returns false if the entry is neither
+      null nor a function, in which case the call can't be resolved. */
+  static bool methodAt(Constant * methodTable, unsigned index, Function *& method);
+};
+
+}
+
+#endif // TART_OPT_DEVIRTUALIZER_H
@@ -0,0 +1,87 @@
+/* ================================================================ *
+    TART - A Sweet Programming Language.
+ * ================================================================ */
+
+/** Splits a linked program into partitions which can be optimized and
+    compiled to machine code independently of each other. */
+
+#ifndef TART_OPT_MODULEPARTITIONER_H
+#define TART_OPT_MODULEPARTITIONER_H
+
+#include "llvm/Module.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <vector>
+
+namespace tart {
+using namespace llvm;
+
+/** Assigns each function in a module to one of several partitions. Functions which
+    call each other are kept together where possible, and the partitions are balanced
+    by instruction count. The assignment depends only on the contents of the module
+    and the number of partitions, so the same input always gives the same result.
+
+    Each partition is produced from its own copy of the module (normally in a separate
+    LLVMContext), so the partitioner refers to definitions by their position in the
+    module rather than by pointer. */
+class ModulePartitioner {
+public:
+  /** Value used for globals which are copied into every partition. */
+  static const unsigned Everywhere = ~0u;
+
+  /** Name of the module-level metadata which tells the GC strategy what to call the
+      safepoint map of a partition, and which map follows it. */
+  static const char SafepointMapMetadata[];
+
+  ModulePartitioner(Module * module, unsigned numPartitions)
+    : module_(module)
+    , numPartitions_(numPartitions)
+    , numPromoted_(0)
+  {}
+
+  /** Assign every definition in the module to a partition. Internal symbols which are
+      referred to from another partition are given external linkage with hidden
+      visibility, so this must be done before the module is copied. */
+  void run();
+
+  /** The number of partitions. This may be fewer than were asked for, if the module
+      has only a few functions. */
+  unsigned numPartitions() const { return numPartitions_; }
+
+  /** Reduce 'copy', which must be a copy of the partitioned module, to the definitions
+      in partition 'part'. Everything else becomes an external declaration. */
+  void extract(Module * copy, unsigned part) const;
+
+  /** Print the size of each partition. */
+  void printStats(raw_ostream & out) const;
+
+private:
+  typedef DenseMap<const GlobalValue *, unsigned> PartitionMap;
+
+  Module * module_;
+  unsigned numPartitions_;
+  PartitionMap partitionOf_;
+  std::vector<unsigned> functionParts_;
+  std::vector<unsigned> globalParts_;
+  std::vector<unsigned> partWeights_;
+  std::vector<bool> partHasGC_;
+  unsigned numPromoted_;
+
+  void assignFunctions();
+  void assignGlobals();
+  void promoteSharedSymbols();
+
+  /** Return the partition which defines 'gv', or Everywhere. */
+  unsigned partitionOf(const GlobalValue * gv) const;
+
+  /** Return true if 'val' is referred to by code or data outside of partition 'part'. */
+  bool isUsedOutside(const Value * val, unsigned part) const;
+
+  /** Return the name of the GC safepoint map for partition 'part'. */
+  std::string safepointMapName(unsigned part) const;
+};
+
+}
+
+#endif // TART_OPT_MODULEPARTITIONER_H
@@ -0,0 +1,95 @@
+/* ================================================================ *
+    TART - A Sweet Programming Language.
+ * ================================================================ */
+
+/** LLVM passes for profile-guided optimization. */
+
+#ifndef TART_OPT_PROFILE_H
+#define TART_OPT_PROFILE_H
+
+#include "llvm/Pass.h"
+#include "llvm/Function.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <string>
+#include <vector>
+
+namespace tart {
+using namespace llvm;
+
+/** Instruments a program to count how often each function is called, and which way
+    each conditional branch goes. The counts are written to a profile file by the
+    runtime when the program exits.
+
+    Counters are numbered in module order, so the profile can only be applied to the
+    same program, linked in the same way. Both this pass and ProfileAnnotator must be
+    run before any other pass changes the code. */
+class ProfileInstrumenter : public ModulePass {
+public:
+  static char ID;
+
+  ProfileInstrumenter() : ModulePass(ID), numCounters_(0) {}
+
+  bool runOnModule(Module & module);
+
+  /** Print the number of counters that were inserted. */
+  void printStats(raw_ostream & out) const;
+
+private:
+  unsigned numCounters_;
+};
+
+/** Reads a profile written by an instrumented build of the same program, and uses it
+    to guide the optimizers and the code generator:
+
+    - Conditional branches are given branch weights.
+    - Frequently called functions get an inline hint.
+    - Functions which were never called are optimized for size, and on ELF targets are
+      moved to the .text.unlikely section.
+    - Functions are reordered so that the most frequently called come first. */
+class ProfileAnnotator : public ModulePass {
+public:
+  static char ID;
+
+  ProfileAnnotator(const std::string & profilePath = "")
+    : ModulePass(ID)
+    , profilePath_(profilePath)
+    , numBranches_(0)
+    , numHot_(0)
+    , numCold_(0)
+  {}
+
+  bool runOnModule(Module & module);
+
+  /** If the profile could not be used, the reason why, otherwise empty. */
+  const std::string & errorMessage() const { return errMsg_; }
+
+  /** Print the number of branches and functions that were annotated. */
+  void printStats(raw_ostream & out) const;
+
+private:
+  typedef std::vector<uint64_t> CountList;
+  typedef std::pair<uint64_t, Function *> EntryCount;
+  typedef std::vector<EntryCount> EntryCountList;
+
+  /** Orders functions by decreasing call count. */
+  struct CompareEntryCounts {
+    bool operator()(const EntryCount & a, const EntryCount & b) const {
+      return a.first > b.first;
+    }
+  };
+
+  std::string profilePath_;
+  std::string errMsg_;
+  unsigned numBranches_;
+  unsigned numHot_;
+  unsigned numCold_;
+
+  bool readProfile(CountList & counts, uint64_t & checksum);
+  void annotateBranches(Function * fn, CountList::const_iterator & count);
+  void markHotAndCold(Module & module, const EntryCountList & entryCounts);
+};
+
+}
+
+#endif // TART_OPT_PROFILE_H
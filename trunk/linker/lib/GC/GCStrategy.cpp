@@ -5,6 +5,8 @@
 #include "tart/GC/GCStrategy.h"
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/Function.h"
+#include "llvm/Metadata.h"
+#include "llvm/Module.h"
 #include "llvm/Target/Mangler.h"
 #include "llvm/Target/TargetMachine.h"
 #include "llvm/Target/TargetData.h"
@@ -24,6 +26,13 @@ using namespace llvm;
 
 typedef llvm::SmallVector<std::pair<MCSymbol *, MCSymbol *>, 64> SafePointList;
 
+// Flag bits for the first field of a trace descriptor. Must agree with the
+// TraceDescriptorFlags enum in the runtime.
+enum TraceDescFlags {
+  TRACE_DESC_LAST = (1<<0),
+  TRACE_DESC_DELTA_OFFSETS = (1<<1),
+};
+
 GCRegistry::Add<TartGCStrategy>
 AddTartGC("tart-gc", "Tart garbage collector.");
 
@@ -169,8 +178,10 @@ void TartGCPrinter::finishAssembly(AsmPrinter &AP) {
 
   MCStreamer & outStream = AP.OutStreamer;
 
-  // Put this in the data section.
-  outStream.SwitchSection(AP.getObjFileLowering().getDataSection());
+  // The trace tables and the safepoint map are never modified at runtime, so put them
+  // in read-only data. They contain addresses, so use the relocatable variant.
+  outStream.SwitchSection(
+      AP.getObjFileLowering().getSectionForConstant(SectionKind::getReadOnlyWithRel()));
 
   // For each function...
   for (iterator FI = begin(), FE = end(); FI != FE; ++FI) {
@@ -267,11 +278,17 @@ void TartGCPrinter::finishAssembly(AsmPrinter &AP) {
         outStream.AddBlankLine();
         AP.EmitAlignment(addressAlignLog);
 
+        // Stack field offsets are small, so if possible encode them as 16-bit deltas
+        // from the previous offset rather than as full pointer-sized values.
+        bool useDeltas = canDeltaEncode(sTable->fieldOffsets);
+
         // First the field offset descriptor
         outStream.EmitLabel(sTable->traceTableLabel);
         size_t traceMethodCount = sTable->traceMethods.size();
         if (!sTable->fieldOffsets.empty()) {
-          outStream.EmitIntValue(traceMethodCount == 0 ? 1 : 0, 2, 0);
+          unsigned flags = (traceMethodCount == 0 ? TRACE_DESC_LAST : 0) |
+              (useDeltas ? TRACE_DESC_DELTA_OFFSETS : 0);
+          outStream.EmitIntValue(flags, 2, 0);
           outStream.EmitIntValue(sTable->fieldOffsets.size(), 2, 0);
           outStream.EmitIntValue(0, 4, 0);
           outStream.EmitSymbolValue(sTable->fieldOffsetsLabel, pointerSize, 0);
@@ -285,7 +302,7 @@ void TartGCPrinter::finishAssembly(AsmPrinter &AP) {
             method = cast<Function>(tm->method()->getOperand(0));
           }
 
-          outStream.EmitIntValue((i + 1 == traceMethodCount ? 1 : 0), 2, 0);
+          outStream.EmitIntValue((i + 1 == traceMethodCount ? TRACE_DESC_LAST : 0), 2, 0);
           outStream.EmitIntValue(0, 2, 0);
           outStream.EmitIntValue(tm->offset(), 4, 0);
           MCSymbol * methodSym = AP.Mang->getSymbol(method);
@@ -298,9 +315,15 @@ void TartGCPrinter::finishAssembly(AsmPrinter &AP) {
         AP.EmitAlignment(addressAlignLog);
 
         outStream.EmitLabel(sTable->fieldOffsetsLabel);
+        int64_t prevOffset = 0;
         for (StackTraceTable::FieldOffsetList::const_iterator it = fieldOffsets.begin();
             it != fieldOffsets.end(); ++it) {
-          outStream.EmitIntValue(*it, pointerSize, 0);
+          if (useDeltas) {
+            outStream.EmitIntValue(*it - prevOffset, 2, 0);
+            prevOffset = *it;
+          } else {
+            outStream.EmitIntValue(*it, pointerSize, 0);
+          }
         }
       }
 
@@ -321,16 +344,57 @@ void TartGCPrinter::finishAssembly(AsmPrinter &AP) {
     }
   }
 
-  // Finally, generate the safe point map.
+  // Finally, generate the safe point map. Safe points are listed in the order in which
+  // the code was emitted, which means that the runtime can binary search the map directly
+  // rather than having to build a hash table at startup.
+  //
+  // The map ends with a pointer to the next map. This is null unless the program was
+  // split into partitions for code generation, in which case the linker tells us the
+  // name of this partition's map and of the one after it.
+  StringRef mapName = "GC_safepoint_map";
+  StringRef nextMapName;
+  if (begin() != end()) {
+    const Module * module = (*begin())->getFunction().getParent();
+    if (const NamedMDNode * md = module->getNamedMetadata("tart.gc.safepoint_map")) {
+      const MDNode * names = md->getOperand(0);
+      mapName = cast<MDString>(names->getOperand(0))->getString();
+      nextMapName = cast<MDString>(names->getOperand(1))->getString();
+    }
+  }
+
   outStream.AddBlankLine();
-  MCSymbol * gcSafepointSymbol = AP.GetExternalSymbolSymbol("GC_safepoint_map");
+  AP.EmitAlignment(addressAlignLog);
+  MCSymbol * gcSafepointSymbol = AP.GetExternalSymbolSymbol(mapName);
   outStream.EmitSymbolAttribute(gcSafepointSymbol, MCSA_Global);
+  if (mapName != "GC_safepoint_map") {
+    outStream.EmitSymbolAttribute(gcSafepointSymbol, MCSA_Hidden);
+  }
+
   outStream.EmitLabel(gcSafepointSymbol);
   outStream.EmitIntValue(safePoints.size(), pointerSize, 0);
   for (SafePointList::const_iterator it = safePoints.begin(); it != safePoints.end(); ++it) {
     outStream.EmitSymbolValue(it->first, pointerSize, 0);
     outStream.EmitSymbolValue(it->second, pointerSize, 0);
   }
+
+  if (nextMapName.empty()) {
+    outStream.EmitIntValue(0, pointerSize, 0);
+  } else {
+    outStream.EmitSymbolValue(AP.GetExternalSymbolSymbol(nextMapName), pointerSize, 0);
+  }
+}
+
+bool TartGCPrinter::canDeltaEncode(const StackTraceTable::FieldOffsetList & offsets) {
+  int64_t prevOffset = 0;
+  for (StackTraceTable::FieldOffsetList::const_iterator it = offsets.begin();
+      it != offsets.end(); ++it) {
+    int64_t delta = *it - prevOffset;
+    if (int64_t(int16_t(delta)) != delta) {
+      return false;
+    }
+    prevOffset = *it;
+  }
+  return true;
 }
 
 int64_t TartGCPrinter::toInt(llvm::Constant * c, TargetMachine & tm) {
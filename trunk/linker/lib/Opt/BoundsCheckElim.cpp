@@ -0,0 +1,391 @@
+/* ================================================================ *
+    TART - A Sweet Programming Language.
+ * ================================================================ */
+
+#include "llvm/Constants.h"
+#include "llvm/DerivedTypes.h"
+#include "llvm/Instructions.h"
+#include "llvm/IntrinsicInst.h"
+#include "llvm/Analysis/Dominators.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/ScalarEvolution.h"
+#include "llvm/Analysis/ScalarEvolutionExpressions.h"
+#include "llvm/Support/CallSite.h"
+#include "llvm/Support/CFG.h"
+#include "llvm/Support/IRBuilder.h"
+#include "llvm/Transforms/Utils/Local.h"
+
+#include "tart/Opt/BoundsCheckElim.h"
+
+namespace tart {
+
+char BoundsCheckElim::ID = 0;
+
+static RegisterPass<BoundsCheckElim> X(
+    "bounds-check-elim", "Remove array bounds checks implied by loop conditions",
+    false /* Only looks at CFG */,
+    false /* Analysis Pass */);
+
+/** Return true if 'val' is a constant integer equal to 'n'. */
+static bool isConstantInt(Value * val, uint64_t n) {
+  ConstantInt * ci = dyn_cast<ConstantInt>(val);
+  return ci != NULL && ci->getZExtValue() == n;
+}
+
+void BoundsCheckElim::getAnalysisUsage(AnalysisUsage & AU) const {
+  AU.addRequired<DominatorTree>();
+  AU.addRequired<LoopInfo>();
+  AU.addRequired<ScalarEvolution>();
+  AU.setPreservesCFG();
+}
+
+bool BoundsCheckElim::runOnFunction(Function & fn) {
+  loopInfo_ = &getAnalysis<LoopInfo>();
+  domTree_ = &getAnalysis<DominatorTree>();
+  scev_ = &getAnalysis<ScalarEvolution>();
+
+  bool changed = false;
+  for (LoopInfo::iterator it = loopInfo_->begin(); it != loopInfo_->end(); ++it) {
+    changed |= processLoop(*it);
+  }
+
+  return changed;
+}
+
+bool BoundsCheckElim::processLoop(Loop * loop) {
+  // Do inner loops first, so that a length hoisted out of an inner loop can
+  // then be hoisted out of the loop that contains it.
+  bool changed = false;
+  for (Loop::iterator it = loop->begin(); it != loop->end(); ++it) {
+    changed |= processLoop(*it);
+  }
+
+  if (loop->getLoopPreheader() == NULL) {
+    return changed;
+  }
+
+  if (hoistLengthLoads(loop)) {
+    scev_->forgetLoop(loop);
+    changed = true;
+  }
+
+  changed |= removeChecks(loop);
+  return changed;
+}
+
+bool BoundsCheckElim::hoistLengthLoads(Loop * loop) {
+  LengthLoadMap lengthLoads;
+  for (Loop::block_iterator bi = loop->block_begin(); bi != loop->block_end(); ++bi) {
+    for (BasicBlock::iterator it = (*bi)->begin(); it != (*bi)->end(); ++it) {
+      if (LoadInst * load = dyn_cast<LoadInst>(it)) {
+        unsigned field;
+        if (Value * key = lengthLoadKey(loop, load, field)) {
+          LengthLoads & group = lengthLoads[std::make_pair(key, field)];
+          group.object = key;
+          group.loads.push_back(load);
+        }
+      }
+    }
+  }
+
+  bool changed = false;
+  BasicBlock * preheader = loop->getLoopPreheader();
+  for (LengthLoadMap::iterator it = lengthLoads.begin(); it != lengthLoads.end(); ++it) {
+    LoadList & loads = it->second.loads;
+
+    // The object might be null if the loop never needs it, so only hoist the
+    // length if it is certain to be loaded anyway.
+    LoadInst * first = NULL;
+    for (LoadList::iterator li = loads.begin(); li != loads.end(); ++li) {
+      if (isGuaranteedToExecute(loop, *li)) {
+        first = *li;
+        break;
+      }
+    }
+
+    if (first == NULL) {
+      continue;
+    }
+
+    IRBuilder<> builder(preheader->getTerminator());
+    GetElementPtrInst * addr = cast<GetElementPtrInst>(first->getPointerOperand());
+    Value * object = it->second.object;
+    if (AllocaInst * slot = dyn_cast<AllocaInst>(object)) {
+      // Reload the variable; since nothing in the loop stores to it, it
+      // holds the same object as in the loop.
+      object = builder.CreateLoad(slot, slot->getName());
+    }
+
+    object = builder.CreatePointerCast(object, addr->getPointerOperand()->getType());
+    Value * fieldAddr = builder.CreateConstInBoundsGEP2_32(object, 0, it->first.second);
+    LoadInst * length = builder.CreateLoad(fieldAddr, first->getName());
+    for (LoadList::iterator li = loads.begin(); li != loads.end(); ++li) {
+      LoadInst * load = *li;
+      load->replaceAllUsesWith(length);
+      Value * loadAddr = load->getPointerOperand();
+      load->eraseFromParent();
+      RecursivelyDeleteTriviallyDeadInstructions(loadAddr);
+      ++numLengthLoadsHoisted_;
+    }
+
+    changed = true;
+  }
+
+  return changed;
+}
+
+bool BoundsCheckElim::removeChecks(Loop * loop) {
+  LLVMContext & context = loop->getHeader()->getContext();
+  SmallVector<ICmpInst *, 16> checks;
+  for (Loop::block_iterator bi = loop->block_begin(); bi != loop->block_end(); ++bi) {
+    for (BasicBlock::iterator it = (*bi)->begin(); it != (*bi)->end(); ++it) {
+      if (ICmpInst * cmp = dyn_cast<ICmpInst>(it)) {
+        if (cmp->getOperand(0)->getType()->isIntegerTy()) {
+          checks.push_back(cmp);
+        }
+      }
+    }
+  }
+
+  bool changed = false;
+  for (SmallVector<ICmpInst *, 16>::iterator it = checks.begin(); it != checks.end(); ++it) {
+    ICmpInst * cmp = *it;
+    ICmpInst::Predicate pred = cmp->getPredicate();
+    const SCEV * lhs = scev_->getSCEV(cmp->getOperand(0));
+    const SCEV * rhs = scev_->getSCEV(cmp->getOperand(1));
+
+    // Put the induction variable on the left.
+    if (!isa<SCEVAddRecExpr>(lhs)) {
+      std::swap(lhs, rhs);
+      pred = ICmpInst::getSwappedPredicate(pred);
+    }
+
+    // Only look at comparisons between an induction variable of this loop
+    // and a value which doesn't change within it.
+    const SCEVAddRecExpr * index = dyn_cast<SCEVAddRecExpr>(lhs);
+    if (index == NULL || index->getLoop() != loop || !index->isAffine() ||
+        !scev_->isLoopInvariant(rhs, loop)) {
+      continue;
+    }
+
+    ++numChecks_;
+    Constant * result = NULL;
+    if (scev_->isKnownPredicate(pred, lhs, rhs)) {
+      result = ConstantInt::getTrue(context);
+    } else if (scev_->isKnownPredicate(ICmpInst::getInversePredicate(pred), lhs, rhs)) {
+      result = ConstantInt::getFalse(context);
+    } else if (rhs->isZero() && isNonNegative(index)) {
+      // Scalar evolution may not know that the index can't wrap around.
+      if (pred == ICmpInst::ICMP_SGE) {
+        result = ConstantInt::getTrue(context);
+      } else if (pred == ICmpInst::ICMP_SLT) {
+        result = ConstantInt::getFalse(context);
+      }
+    } else if (rhs->isAllOnesValue() && isNonNegative(index)) {
+      if (pred == ICmpInst::ICMP_SGT) {
+        result = ConstantInt::getTrue(context);
+      } else if (pred == ICmpInst::ICMP_SLE) {
+        result = ConstantInt::getFalse(context);
+      }
+    }
+
+    if (result != NULL) {
+      // Leave the branch in place; the CFG simplification that follows this
+      // pass will remove the failure path.
+      cmp->replaceAllUsesWith(result);
+      cmp->eraseFromParent();
+      ++numChecksRemoved_;
+      changed = true;
+    }
+  }
+
+  return changed;
+}
+
+Value * BoundsCheckElim::lengthLoadKey(Loop * loop, LoadInst * load, unsigned & field) {
+  if (load->isVolatile()) {
+    return NULL;
+  }
+
+  GetElementPtrInst * addr = dyn_cast<GetElementPtrInst>(load->getPointerOperand());
+  if (addr == NULL || addr->getNumIndices() != 2 || !isConstantInt(addr->getOperand(1), 0) ||
+      !isa<ConstantInt>(addr->getOperand(2))) {
+    return NULL;
+  }
+
+  field = cast<ConstantInt>(addr->getOperand(2))->getZExtValue();
+  PointerType * objectType = cast<PointerType>(addr->getPointerOperand()->getType());
+  if (!isLengthField(objectType->getElementType(), field)) {
+    return NULL;
+  }
+
+  Value * object = addr->getPointerOperand()->stripPointerCasts();
+  if (loop->isLoopInvariant(object)) {
+    return object;
+  }
+
+  // Object references are usually held in garbage collection roots and
+  // reloaded before each use. The collector may move the object, but it
+  // can't change its length.
+  if (LoadInst * objectLoad = dyn_cast<LoadInst>(object)) {
+    AllocaInst * slot = dyn_cast<AllocaInst>(objectLoad->getPointerOperand());
+    if (slot != NULL && !objectLoad->isVolatile() && isUnmodifiedSlot(loop, slot)) {
+      return slot;
+    }
+  }
+
+  return NULL;
+}
+
+bool BoundsCheckElim::isGuaranteedToExecute(Loop * loop, Instruction * inst) {
+  BasicBlock * block = inst->getParent();
+  if (block != loop->getHeader()) {
+    SmallVector<BasicBlock *, 8> exitBlocks;
+    loop->getExitBlocks(exitBlocks);
+    for (SmallVector<BasicBlock *, 8>::iterator it = exitBlocks.begin();
+        it != exitBlocks.end(); ++it) {
+      if (!domTree_->dominates(block, *it)) {
+        return false;
+      }
+    }
+  }
+
+  // A call that throws leaves the function without going through a loop exit,
+  // so it mustn't be possible to reach one before 'inst' in the first iteration.
+  for (BasicBlock::iterator it = block->begin(); &*it != inst; ++it) {
+    if (mayThrow(it)) {
+      return false;
+    }
+  }
+
+  if (block == loop->getHeader()) {
+    return true;
+  }
+
+  // Look at every block on a path from the loop header to 'block'.
+  SmallPtrSet<BasicBlock *, 16> visited;
+  SmallVector<BasicBlock *, 16> worklist;
+  visited.insert(block);
+  worklist.push_back(block);
+  while (!worklist.empty()) {
+    BasicBlock * bb = worklist.pop_back_val();
+    if (bb == loop->getHeader()) {
+      continue;
+    }
+
+    for (pred_iterator pi = pred_begin(bb); pi != pred_end(bb); ++pi) {
+      BasicBlock * pred = *pi;
+      if (!loop->contains(pred) || !visited.insert(pred)) {
+        continue;
+      }
+
+      for (BasicBlock::iterator it = pred->begin(); it != pred->end(); ++it) {
+        if (mayThrow(it)) {
+          return false;
+        }
+      }
+
+      worklist.push_back(pred);
+    }
+  }
+
+  return true;
+}
+
+bool BoundsCheckElim::mayThrow(Instruction * inst) {
+  CallSite cs(inst);
+  return cs.getInstruction() != NULL && !cs.doesNotThrow();
+}
+
+bool BoundsCheckElim::isNonNegative(const SCEVAddRecExpr * ar) {
+  const SCEVConstant * start = dyn_cast<SCEVConstant>(ar->getStart());
+  const SCEVConstant * step = dyn_cast<SCEVConstant>(ar->getStepRecurrence(*scev_));
+  if (start == NULL || step == NULL || start->getValue()->isNegative() ||
+      step->getValue()->isNegative()) {
+    return false;
+  }
+
+  if (ar->getNoWrapFlags(SCEV::FlagNSW)) {
+    return true;
+  }
+
+  // Otherwise the index can't wrap if the loop exits before it gets the chance.
+  const SCEVConstant * maxCount =
+      dyn_cast<SCEVConstant>(scev_->getMaxBackedgeTakenCount(ar->getLoop()));
+  if (maxCount == NULL) {
+    return false;
+  }
+
+  const APInt & count = maxCount->getValue()->getValue();
+  if (count.isNegative() || count.getBitWidth() != step->getValue()->getBitWidth()) {
+    return false;
+  }
+
+  bool overflow = false;
+  APInt last = count.smul_ov(step->getValue()->getValue(), overflow);
+  if (!overflow) {
+    last = last.sadd_ov(start->getValue()->getValue(), overflow);
+  }
+
+  return !overflow;
+}
+
+bool BoundsCheckElim::isUnmodifiedSlot(Loop * loop, AllocaInst * slot) {
+  for (Value::use_iterator it = slot->use_begin(); it != slot->use_end(); ++it) {
+    User * user = *it;
+    if (isa<LoadInst>(user)) {
+      continue;
+    } else if (StoreInst * store = dyn_cast<StoreInst>(user)) {
+      if (store->getValueOperand() == slot || loop->contains(store->getParent())) {
+        return false;
+      }
+    } else if (BitCastInst * cast = dyn_cast<BitCastInst>(user)) {
+      // The only other use allowed is the llvm.gcroot declaration.
+      for (Value::use_iterator ui = cast->use_begin(); ui != cast->use_end(); ++ui) {
+        IntrinsicInst * intrinsic = dyn_cast<IntrinsicInst>(*ui);
+        if (intrinsic == NULL || intrinsic->getIntrinsicID() != Intrinsic::gcroot) {
+          return false;
+        }
+      }
+    } else {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool BoundsCheckElim::isLengthField(Type * type, unsigned index) {
+  StructType * stype = dyn_cast<StructType>(type);
+  if (stype == NULL || !stype->hasName() || stype->getNumElements() < 2 ||
+      index + 2 != stype->getNumElements()) {
+    return false;
+  }
+
+  ArrayType * flexArray = dyn_cast<ArrayType>(stype->getElementType(index + 1));
+  Type * lengthType = stype->getElementType(index);
+  if (flexArray == NULL || flexArray->getNumElements() != 0 ||
+      !(lengthType->isIntegerTy(32) || lengthType->isIntegerTy(64))) {
+    return false;
+  }
+
+  // Other classes with a flexible array may change the field before it, but
+  // Array, StaticList and BitArray only set their length in 'alloc'. Linking
+  // can add a numeric suffix to the type name.
+  StringRef name = stype->getName();
+  size_t suffix = name.rfind('.');
+  if (suffix != StringRef::npos && suffix + 1 < name.size() &&
+      name.substr(suffix + 1).find_first_not_of("0123456789") == StringRef::npos) {
+    name = name.substr(0, suffix);
+  }
+
+  return name.endswith("[]") || name.startswith("tart.reflect.StaticList[") ||
+      name == "tart.collections.BitArray";
+}
+
+void BoundsCheckElim::printStats(raw_ostream & out) const {
+  out << "Removed " << numChecksRemoved_ << " of " << numChecks_ <<
+      " loop index comparisons; hoisted " << numLengthLoadsHoisted_ << " array length loads.\n";
+}
+
+}
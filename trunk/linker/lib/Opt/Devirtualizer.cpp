@@ -0,0 +1,403 @@
+/* ================================================================ *
+    TART - A Sweet Programming Language.
+ * ================================================================ */
+
+#include "llvm/Module.h"
+#include "llvm/Constants.h"
+#include "llvm/DerivedTypes.h"
+#include "llvm/Instructions.h"
+#include "llvm/Support/CallSite.h"
+#include "llvm/Transforms/Utils/Local.h"
+
+#include "tart/Opt/Devirtualizer.h"
+
+namespace tart {
+
+char Devirtualizer::ID = 0;
+
+static RegisterPass<Devirtualizer> X(
+    "devirtualize", "Resolve virtual calls using class hierarchy analysis",
+    false /* Only looks at CFG */,
+    false /* Analysis Pass */);
+
+// Field indices for TypeInfoBlock. These must match CodeGenerator::TIBFields.
+enum TIBFields {
+  TIB_META = 0,
+  TIB_TRACE_TABLE,
+  TIB_BASES,
+  TIB_IDISPATCH,
+  TIB_METHOD_TABLE,
+  TIB_FIELD_COUNT
+};
+
+/** Return true if 'val' is a constant integer equal to 'n'. */
+static bool isConstantInt(Value * val, uint64_t n) {
+  ConstantInt * ci = dyn_cast<ConstantInt>(val);
+  return ci != NULL && ci->getZExtValue() == n;
+}
+
+/** Return true if 'load' reads an entry from a TIB method table. */
+static bool isMethodTableLoad(LoadInst * load) {
+  GetElementPtrInst * addr = dyn_cast<GetElementPtrInst>(load->getPointerOperand());
+  return addr != NULL && addr->getNumIndices() == 3 &&
+      isConstantInt(addr->getOperand(1), 0) &&
+      isConstantInt(addr->getOperand(2), TIB_METHOD_TABLE) &&
+      isa<ConstantInt>(addr->getOperand(3));
+}
+
+Devirtualizer::~Devirtualizer() {
+  for (ClassList::iterator it = classes_.begin(); it != classes_.end(); ++it) {
+    delete *it;
+  }
+}
+
+bool Devirtualizer::runOnModule(Module & module) {
+  if (!readClassHierarchy(module)) {
+    return false;
+  }
+
+  // Find the call sites first, since resolving them deletes instructions.
+  SmallVector<LoadInst *, 256> methodLoads;
+  SmallVector<Instruction *, 256> dispatchCalls;
+  for (Module::iterator fn = module.begin(); fn != module.end(); ++fn) {
+    for (Function::iterator bb = fn->begin(); bb != fn->end(); ++bb) {
+      for (BasicBlock::iterator inst = bb->begin(); inst != bb->end(); ++inst) {
+        if (LoadInst * load = dyn_cast<LoadInst>(inst)) {
+          if (isMethodTableLoad(load)) {
+            methodLoads.push_back(load);
+          }
+        } else if (isa<CallInst>(inst) || isa<InvokeInst>(inst)) {
+          if (CallSite(inst).getCalledFunction() == NULL) {
+            dispatchCalls.push_back(inst);
+          }
+        }
+      }
+    }
+  }
+
+  bool changed = false;
+  for (SmallVectorImpl<LoadInst *>::iterator it = methodLoads.begin();
+      it != methodLoads.end(); ++it) {
+    changed |= resolveVirtualCall(*it);
+  }
+
+  for (SmallVectorImpl<Instruction *>::iterator it = dispatchCalls.begin();
+      it != dispatchCalls.end(); ++it) {
+    changed |= resolveInterfaceCall(*it);
+  }
+
+  unsigned numPruned = numDispatchCasesPruned_;
+  pruneDispatchCases(module);
+  return changed || numDispatchCasesPruned_ != numPruned;
+}
+
+bool Devirtualizer::readClassHierarchy(Module & module) {
+  for (Module::global_iterator gv = module.global_begin(); gv != module.global_end(); ++gv) {
+    if (!gv->getName().endswith(".TIB")) {
+      continue;
+    }
+
+    // If any type info block is missing, then we can't see the whole hierarchy.
+    if (!gv->hasDefinitiveInitializer()) {
+      return false;
+    }
+
+    ConstantStruct * tibInit = dyn_cast<ConstantStruct>(gv->getInitializer());
+    if (tibInit == NULL || tibInit->getNumOperands() != TIB_FIELD_COUNT) {
+      return false;
+    }
+
+    ClassInfo * cls = new ClassInfo();
+    cls->tib = gv;
+    cls->methods = tibInit->getOperand(TIB_METHOD_TABLE);
+    Constant * dispatcher = tibInit->getOperand(TIB_IDISPATCH)->stripPointerCasts();
+    cls->idispatch = dyn_cast<Function>(dispatcher);
+    classes_.push_back(cls);
+    if (cls->idispatch == NULL && !dispatcher->isNullValue()) {
+      return false;
+    }
+
+    // Likewise if the list of base classes might be replaced at link time, since then we
+    // can't tell which classes are subclasses of which.
+    Constant * basesPtr = tibInit->getOperand(TIB_BASES)->stripPointerCasts();
+    GlobalVariable * basesVar = dyn_cast<GlobalVariable>(basesPtr);
+    if (basesVar == NULL) {
+      if (!basesPtr->isNullValue()) {
+        return false;
+      }
+    } else if (!basesVar->hasDefinitiveInitializer()) {
+      return false;
+    } else if (ConstantArray * bases = dyn_cast<ConstantArray>(basesVar->getInitializer())) {
+      for (unsigned i = 0; i < bases->getNumOperands(); ++i) {
+        if (GlobalVariable * base =
+            dyn_cast<GlobalVariable>(bases->getOperand(i)->stripPointerCasts())) {
+          cls->bases.insert(base);
+        }
+      }
+    }
+
+    StringRef typeName = gv->getName().substr(0, gv->getName().size() - 4);
+    if (StructType * type = module.getTypeByName(typeName)) {
+      tibForType_[type] = gv;
+    }
+
+    // If a dispatch function is only declared, or has a case we can't read, then the
+    // set of interfaces that the class implements is unknown.
+    if (cls->idispatch != NULL) {
+      if (cls->idispatch->isDeclaration() || !readDispatchCases(cls->idispatch)) {
+        return false;
+      }
+
+      dispatchFunctions_.insert(cls->idispatch);
+    }
+  }
+
+  return !classes_.empty();
+}
+
+bool Devirtualizer::readDispatchCases(Function * idispatch) {
+  // Each case of the dispatch function compares the interface id against a constant
+  // and branches to a block that loads the method from the interface method table.
+  Argument * iid = idispatch->arg_begin();
+  for (Function::iterator bb = idispatch->begin(); bb != idispatch->end(); ++bb) {
+    BranchInst * br = dyn_cast<BranchInst>(bb->getTerminator());
+    if (br == NULL || !br->isConditional()) {
+      continue;
+    }
+
+    ICmpInst * test = dyn_cast<ICmpInst>(br->getCondition());
+    if (test == NULL || test->getPredicate() != ICmpInst::ICMP_EQ ||
+        test->getOperand(0) != iid) {
+      continue;
+    }
+
+    GlobalVariable * iname = dyn_cast<GlobalVariable>(test->getOperand(1)->stripPointerCasts());
+    if (iname == NULL) {
+      return false;
+    }
+
+    GlobalVariable * itable = NULL;
+    BasicBlock * target = br->getSuccessor(0);
+    for (BasicBlock::iterator inst = target->begin(); inst != target->end(); ++inst) {
+      if (LoadInst * load = dyn_cast<LoadInst>(inst)) {
+        if (GetElementPtrInst * gep = dyn_cast<GetElementPtrInst>(load->getPointerOperand())) {
+          itable = dyn_cast<GlobalVariable>(gep->getPointerOperand());
+          break;
+        }
+      }
+    }
+
+    if (itable == NULL || !itable->hasDefinitiveInitializer()) {
+      return false;
+    }
+
+    DispatchCase dc;
+    dc.iname = iname;
+    dc.itable = itable;
+    dc.test = test;
+    dispatchCases_.push_back(dc);
+  }
+
+  return true;
+}
+
+bool Devirtualizer::resolveVirtualCall(LoadInst * methodLoad) {
+  // Match the sequence produced by CodeGenerator::genVTableLookup:
+  //   %tib = load (gep %self, 0, 0, ..., 0)
+  //   %method = load (gep %tib, 0, TIB_METHOD_TABLE, index)
+  GetElementPtrInst * methodAddr = cast<GetElementPtrInst>(methodLoad->getPointerOperand());
+  LoadInst * tibLoad = dyn_cast<LoadInst>(methodAddr->getPointerOperand());
+  if (tibLoad == NULL) {
+    return false;
+  }
+
+  GetElementPtrInst * tibAddr = dyn_cast<GetElementPtrInst>(tibLoad->getPointerOperand());
+  if (tibAddr == NULL || !tibAddr->hasAllZeroIndices()) {
+    return false;
+  }
+
+  // The static type of 'self' bounds the set of classes that the object may belong to.
+  PointerType * selfType = cast<PointerType>(tibAddr->getPointerOperand()->getType());
+  StructType * classType = dyn_cast<StructType>(selfType->getElementType());
+  GlobalVariable * classTib = classType != NULL ? tibForType_.lookup(classType) : NULL;
+  if (classTib == NULL) {
+    return false;
+  }
+
+  ++numVirtualCalls_;
+  unsigned methodIndex = cast<ConstantInt>(methodAddr->getOperand(3))->getZExtValue();
+  Function * method = NULL;
+  for (ClassList::iterator it = classes_.begin(); it != classes_.end(); ++it) {
+    ClassInfo * cls = *it;
+    if (cls->tib == classTib || cls->bases.count(classTib)) {
+      // A null entry is an abstract method; such a class is never instantiated.
+      Function * fn;
+      if (!methodAt(cls->methods, methodIndex, fn)) {
+        return false;
+      } else if (fn == NULL) {
+        continue;
+      } else if (method == NULL) {
+        method = fn;
+      } else if (method != fn) {
+        return false;
+      }
+    }
+  }
+
+  if (method == NULL) {
+    return false;
+  }
+
+  // Replace the method pointer with the function. Fold the cast to the method type
+  // as well, so that the call becomes a direct call wherever the types agree.
+  while (!methodLoad->use_empty()) {
+    Instruction * user = cast<Instruction>(methodLoad->use_back());
+    if (BitCastInst * castInst = dyn_cast<BitCastInst>(user)) {
+      castInst->replaceAllUsesWith(ConstantExpr::getBitCast(method, castInst->getType()));
+      castInst->eraseFromParent();
+    } else {
+      user->replaceUsesOfWith(methodLoad, ConstantExpr::getBitCast(method, methodLoad->getType()));
+    }
+  }
+
+  RecursivelyDeleteTriviallyDeadInstructions(methodLoad);
+  ++numVirtualCallsResolved_;
+  return true;
+}
+
+bool Devirtualizer::resolveInterfaceCall(Instruction * call) {
+  // Match the sequence produced by CodeGenerator::genITableLookup:
+  //   %idispatch = load (gep %tib, 0, TIB_IDISPATCH)
+  //   %method = call %idispatch(iname, index)
+  CallSite cs(call);
+  LoadInst * dispatcher = dyn_cast<LoadInst>(cs.getCalledValue());
+  if (dispatcher == NULL || cs.arg_size() != 2) {
+    return false;
+  }
+
+  GetElementPtrInst * dispatcherAddr = dyn_cast<GetElementPtrInst>(
+      dispatcher->getPointerOperand());
+  if (dispatcherAddr == NULL || dispatcherAddr->getNumIndices() != 2 ||
+      !isConstantInt(dispatcherAddr->getOperand(1), 0) ||
+      !isConstantInt(dispatcherAddr->getOperand(2), TIB_IDISPATCH)) {
+    return false;
+  }
+
+  GlobalVariable * iname = dyn_cast<GlobalVariable>(cs.getArgument(0)->stripPointerCasts());
+  ConstantInt * methodIndex = dyn_cast<ConstantInt>(cs.getArgument(1));
+  if (iname == NULL || methodIndex == NULL) {
+    return false;
+  }
+
+  // Look at every class that implements the interface.
+  ++numInterfaceCalls_;
+  Function * method = NULL;
+  for (DispatchCaseList::iterator it = dispatchCases_.begin(); it != dispatchCases_.end(); ++it) {
+    if (it->iname == iname) {
+      Function * fn;
+      if (!methodAt(it->itable->getInitializer(), methodIndex->getZExtValue(), fn)) {
+        return false;
+      } else if (fn == NULL) {
+        continue;
+      } else if (method == NULL) {
+        method = fn;
+      } else if (method != fn) {
+        return false;
+      }
+    }
+  }
+
+  if (method == NULL) {
+    return false;
+  }
+
+  call->replaceAllUsesWith(ConstantExpr::getBitCast(method, call->getType()));
+  if (InvokeInst * invoke = dyn_cast<InvokeInst>(call)) {
+    BranchInst::Create(invoke->getNormalDest(), invoke);
+    invoke->getUnwindDest()->removePredecessor(invoke->getParent());
+  }
+
+  call->eraseFromParent();
+  RecursivelyDeleteTriviallyDeadInstructions(dispatcher);
+  ++numInterfaceCallsResolved_;
+  return true;
+}
+
+void Devirtualizer::pruneDispatchCases(Module & module) {
+  if (dispatchCases_.empty()) {
+    return;
+  }
+
+  // Collect the interface ids that are still passed to a dispatch function, either
+  // through a TIB or - once the TIB load has been folded - directly. If any call
+  // passes an id that isn't a constant, then leave all of the cases alone.
+  Type * iidType = dispatchCases_.front().test->getOperand(0)->getType();
+  SmallPtrSet<GlobalVariable *, 64> calledInterfaces;
+  for (Module::iterator fn = module.begin(); fn != module.end(); ++fn) {
+    for (Function::iterator bb = fn->begin(); bb != fn->end(); ++bb) {
+      for (BasicBlock::iterator inst = bb->begin(); inst != bb->end(); ++inst) {
+        if (!isa<CallInst>(inst) && !isa<InvokeInst>(inst)) {
+          continue;
+        }
+
+        CallSite cs(inst);
+        if (Function * callee = cs.getCalledFunction()) {
+          if (!dispatchFunctions_.count(callee)) {
+            continue;
+          }
+        } else if (cs.arg_size() != 2 || cs.getArgument(0)->getType() != iidType) {
+          continue;
+        }
+
+        if (GlobalVariable * iname =
+            dyn_cast<GlobalVariable>(cs.getArgument(0)->stripPointerCasts())) {
+          calledInterfaces.insert(iname);
+        } else {
+          return;
+        }
+      }
+    }
+  }
+
+  // Replace the test for each unused case with 'false'. SimplifyCFG removes the
+  // dead blocks, after which GlobalDCE can remove the interface method table.
+  LLVMContext & context = module.getContext();
+  for (DispatchCaseList::iterator it = dispatchCases_.begin(); it != dispatchCases_.end(); ++it) {
+    if (!calledInterfaces.count(it->iname)) {
+      it->test->replaceAllUsesWith(ConstantInt::getFalse(context));
+      it->test->eraseFromParent();
+      ++numDispatchCasesPruned_;
+    }
+  }
+
+  dispatchCases_.clear();
+  dispatchFunctions_.clear();
+}
+
+bool Devirtualizer::methodAt(Constant * methodTable, unsigned index, Function *& method) {
+  method = NULL;
+  if (ConstantArray * methods = dyn_cast<ConstantArray>(methodTable)) {
+    if (index < methods->getNumOperands()) {
+      Constant * entry = cast<Constant>(methods->getOperand(index)->stripPointerCasts());
+      if (entry->isNullValue()) {
+        return true;
+      }
+
+      // Anything else, such as an alias which may be overridden, is unknown.
+      method = dyn_cast<Function>(entry);
+      return method != NULL;
+    }
+  } else if (isa<ConstantAggregateZero>(methodTable)) {
+    return index < cast<ArrayType>(methodTable->getType())->getNumElements();
+  }
+
+  return false;
+}
+
+void Devirtualizer::printStats(raw_ostream & out) const {
+  out << "Devirtualized " << numVirtualCallsResolved_ << " of " << numVirtualCalls_ <<
+      " virtual calls and " << numInterfaceCallsResolved_ << " of " << numInterfaceCalls_ <<
+      " interface calls; pruned " << numDispatchCasesPruned_ << " interface dispatch cases.\n";
+}
+
+}
@@ -0,0 +1,348 @@
+/* ================================================================ *
+    TART - A Sweet Programming Language.
+ * ================================================================ */
+
+#include "llvm/Module.h"
+#include "llvm/Constants.h"
+#include "llvm/Instructions.h"
+#include "llvm/Metadata.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/CallSite.h"
+
+#include "tart/Opt/ModulePartitioner.h"
+
+#include <algorithm>
+
+namespace tart {
+
+const char ModulePartitioner::SafepointMapMetadata[] = "tart.gc.safepoint_map";
+
+namespace {
+
+/** A group of functions which are always placed in the same partition. */
+struct Cluster {
+  unsigned first;
+  unsigned weight;
+
+  Cluster(unsigned f, unsigned w) : first(f), weight(w) {}
+
+  /** Heaviest first; ties are broken by position so that the order is stable. */
+  bool operator<(const Cluster & other) const {
+    if (weight != other.weight) {
+      return weight > other.weight;
+    }
+    return first < other.first;
+  }
+};
+
+/** Union-find over function indices, with the total weight of each set. */
+class ClusterSet {
+public:
+  ClusterSet(const std::vector<unsigned> & weights)
+    : parent_(weights.size())
+    , weight_(weights)
+  {
+    for (unsigned i = 0; i < parent_.size(); ++i) {
+      parent_[i] = i;
+    }
+  }
+
+  unsigned find(unsigned i) {
+    while (parent_[i] != i) {
+      parent_[i] = parent_[parent_[i]];
+      i = parent_[i];
+    }
+    return i;
+  }
+
+  /** Merge the sets containing 'a' and 'b', unless the result would weigh more
+      than 'limit'. The set with the lower index becomes the root. */
+  void merge(unsigned a, unsigned b, unsigned limit) {
+    a = find(a);
+    b = find(b);
+    if (a == b || weight_[a] + weight_[b] > limit) {
+      return;
+    }
+
+    if (b < a) {
+      std::swap(a, b);
+    }
+
+    parent_[b] = a;
+    weight_[a] += weight_[b];
+  }
+
+  unsigned weight(unsigned i) const { return weight_[i]; }
+
+private:
+  std::vector<unsigned> parent_;
+  std::vector<unsigned> weight_;
+};
+
+/** Return the number of instructions in 'fn'. */
+unsigned instructionCount(const Function * fn) {
+  unsigned count = 0;
+  for (Function::const_iterator bb = fn->begin(); bb != fn->end(); ++bb) {
+    count += bb->size();
+  }
+  return count;
+}
+
+/** Return true if 'gv' can be copied into every partition that uses it. */
+bool canDuplicate(const GlobalVariable * gv) {
+  return gv->hasLocalLinkage() && gv->isConstant() && gv->hasUnnamedAddr();
+}
+
+/** Return true if 'gv' is one of LLVM's special globals, such as llvm.used. */
+bool isIntrinsicGlobal(const GlobalValue * gv) {
+  return gv->getName().startswith("llvm.");
+}
+
+}
+
+void ModulePartitioner::run() {
+  assignFunctions();
+  assignGlobals();
+  promoteSharedSymbols();
+}
+
+void ModulePartitioner::assignFunctions() {
+  // Number the defined functions in module order.
+  SmallVector<Function *, 256> functions;
+  DenseMap<const Function *, unsigned> indexOf;
+  std::vector<unsigned> weights;
+  unsigned totalWeight = 0;
+  for (Module::iterator it = module_->begin(); it != module_->end(); ++it) {
+    if (!it->isDeclaration()) {
+      indexOf[it] = functions.size();
+      functions.push_back(it);
+      weights.push_back(std::max(instructionCount(it), 1u));
+      totalWeight += weights.back();
+    }
+  }
+
+  if (numPartitions_ > functions.size()) {
+    numPartitions_ = std::max(unsigned(functions.size()), 1u);
+  }
+
+  // Join each function with its direct callees, as long as no cluster becomes larger
+  // than a partition should be. Callees which are private to the caller's module are
+  // done first, since splitting those from their callers costs the most.
+  ClusterSet clusters(weights);
+  unsigned limit = std::max(totalWeight / numPartitions_, 1u);
+  for (int pass = 0; pass < 2; ++pass) {
+    for (unsigned i = 0; i < functions.size(); ++i) {
+      Function * fn = functions[i];
+      for (Function::iterator bb = fn->begin(); bb != fn->end(); ++bb) {
+        for (BasicBlock::iterator inst = bb->begin(); inst != bb->end(); ++inst) {
+          CallSite call(&*inst);
+          if (!call) {
+            continue;
+          }
+
+          Function * callee = call.getCalledFunction();
+          if (callee == NULL || callee->isDeclaration() ||
+              callee->hasLocalLinkage() != (pass == 0)) {
+            continue;
+          }
+
+          clusters.merge(i, indexOf[callee], limit);
+        }
+      }
+    }
+  }
+
+  std::vector<Cluster> roots;
+  for (unsigned i = 0; i < functions.size(); ++i) {
+    if (clusters.find(i) == i) {
+      roots.push_back(Cluster(i, clusters.weight(i)));
+    }
+  }
+
+  // Place the largest clusters first, each in the least loaded partition.
+  std::sort(roots.begin(), roots.end());
+  partWeights_.assign(numPartitions_, 0);
+  partHasGC_.assign(numPartitions_, false);
+  DenseMap<unsigned, unsigned> partOfRoot;
+  for (std::vector<Cluster>::const_iterator it = roots.begin(); it != roots.end(); ++it) {
+    unsigned part = 0;
+    for (unsigned p = 1; p < numPartitions_; ++p) {
+      if (partWeights_[p] < partWeights_[part]) {
+        part = p;
+      }
+    }
+
+    partOfRoot[it->first] = part;
+    partWeights_[part] += it->weight;
+  }
+
+  functionParts_.resize(functions.size());
+  for (unsigned i = 0; i < functions.size(); ++i) {
+    unsigned part = partOfRoot[clusters.find(i)];
+    functionParts_[i] = part;
+    partitionOf_[functions[i]] = part;
+    if (functions[i]->hasGC()) {
+      partHasGC_[part] = true;
+    }
+  }
+}
+
+void ModulePartitioner::assignGlobals() {
+  // Constants which nobody can take the address of are copied to each partition.
+  // Everything else is defined in the first partition.
+  for (Module::global_iterator it = module_->global_begin(); it != module_->global_end(); ++it) {
+    if (!it->isDeclaration()) {
+      unsigned part = canDuplicate(it) ? Everywhere : 0;
+      globalParts_.push_back(part);
+      partitionOf_[it] = part;
+    }
+  }
+}
+
+void ModulePartitioner::promoteSharedSymbols() {
+  SmallVector<GlobalValue *, 256> symbols;
+  for (Module::iterator it = module_->begin(); it != module_->end(); ++it) {
+    symbols.push_back(it);
+  }
+
+  for (Module::global_iterator it = module_->global_begin(); it != module_->global_end(); ++it) {
+    symbols.push_back(it);
+  }
+
+  for (SmallVector<GlobalValue *, 256>::iterator it = symbols.begin(); it != symbols.end(); ++it) {
+    GlobalValue * gv = *it;
+    if (gv->isDeclaration() || isIntrinsicGlobal(gv)) {
+      continue;
+    }
+
+    // Symbols which can't be seen from another object file, or which the partition
+    // that defines them is free to discard, have to be exported to the partitions
+    // that use them.
+    bool isLocal = gv->hasLocalLinkage();
+    if (!isLocal && !gv->hasLinkOnceLinkage()) {
+      continue;
+    }
+
+    unsigned part = partitionOf(gv);
+    if (part == Everywhere || !isUsedOutside(gv, part)) {
+      continue;
+    }
+
+    if (isLocal) {
+      if (!gv->hasName()) {
+        gv->setName("tartln.anon");
+      }
+
+      gv->setVisibility(GlobalValue::HiddenVisibility);
+    }
+
+    gv->setLinkage(GlobalValue::ExternalLinkage);
+    ++numPromoted_;
+  }
+}
+
+unsigned ModulePartitioner::partitionOf(const GlobalValue * gv) const {
+  PartitionMap::const_iterator it = partitionOf_.find(gv);
+  return it != partitionOf_.end() ? it->second : Everywhere;
+}
+
+bool ModulePartitioner::isUsedOutside(const Value * val, unsigned part) const {
+  for (Value::const_use_iterator it = val->use_begin(); it != val->use_end(); ++it) {
+    const User * user = *it;
+    if (const Instruction * inst = dyn_cast<Instruction>(user)) {
+      if (partitionOf(inst->getParent()->getParent()) != part) {
+        return true;
+      }
+    } else if (const GlobalValue * gv = dyn_cast<GlobalValue>(user)) {
+      if (partitionOf(gv) != part) {
+        return true;
+      }
+    } else if (isa<Constant>(user)) {
+      if (isUsedOutside(user, part)) {
+        return true;
+      }
+    }
+  }
+
+  return false;
+}
+
+void ModulePartitioner::extract(Module * copy, unsigned part) const {
+  unsigned index = 0;
+  for (Module::iterator it = copy->begin(); it != copy->end(); ++it) {
+    if (!it->isDeclaration() && functionParts_[index++] != part) {
+      it->deleteBody();
+    }
+  }
+
+  index = 0;
+  SmallVector<GlobalVariable *, 8> intrinsics;
+  for (Module::global_iterator it = copy->global_begin(); it != copy->global_end(); ++it) {
+    if (it->isDeclaration()) {
+      continue;
+    }
+
+    unsigned owner = globalParts_[index++];
+    if (owner == part || owner == Everywhere) {
+      continue;
+    }
+
+    if (isIntrinsicGlobal(it)) {
+      intrinsics.push_back(it);
+    } else {
+      it->setInitializer(NULL);
+      it->setLinkage(GlobalValue::ExternalLinkage);
+    }
+  }
+
+  for (SmallVector<GlobalVariable *, 8>::iterator it = intrinsics.begin();
+      it != intrinsics.end(); ++it) {
+    (*it)->eraseFromParent();
+  }
+
+  // Each partition that contains collected functions gets its own safepoint map. The
+  // maps are chained together, and the first one has the name that the runtime expects.
+  if (partHasGC_[part]) {
+    std::string nextName;
+    for (unsigned p = part + 1; p < numPartitions_; ++p) {
+      if (partHasGC_[p]) {
+        nextName = safepointMapName(p);
+        break;
+      }
+    }
+
+    LLVMContext & context = copy->getContext();
+    Value * names[] = {
+      MDString::get(context, safepointMapName(part)),
+      MDString::get(context, nextName),
+    };
+
+    copy->getOrInsertNamedMetadata(SafepointMapMetadata)->addOperand(
+        MDNode::get(context, names));
+  }
+}
+
+std::string ModulePartitioner::safepointMapName(unsigned part) const {
+  for (unsigned p = 0; p < part; ++p) {
+    if (partHasGC_[p]) {
+      std::string name;
+      raw_string_ostream strm(name);
+      strm << "GC_safepoint_map." << part;
+      return strm.str();
+    }
+  }
+
+  return "GC_safepoint_map";
+}
+
+void ModulePartitioner::printStats(raw_ostream & out) const {
+  out << "Split " << functionParts_.size() << " functions into " << numPartitions_ <<
+      " partitions of";
+  for (unsigned p = 0; p < numPartitions_; ++p) {
+    out << (p == 0 ? " " : ", ") << partWeights_[p];
+  }
+
+  out << " instructions; exported " << numPromoted_ << " internal symbols.\n";
+}
+
+}
@@ -0,0 +1,327 @@
+/* ================================================================ *
+    TART - A Sweet Programming Language.
+ * ================================================================ */
+
+#include "llvm/Module.h"
+#include "llvm/Constants.h"
+#include "llvm/DerivedTypes.h"
+#include "llvm/Instructions.h"
+#include "llvm/LLVMContext.h"
+#include "llvm/Metadata.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Triple.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/system_error.h"
+
+#include "tart/Opt/Profile.h"
+
+#include <algorithm>
+
+namespace tart {
+
+char ProfileInstrumenter::ID = 0;
+char ProfileAnnotator::ID = 0;
+
+static RegisterPass<ProfileInstrumenter> X(
+    "profile-instrument", "Insert execution counters for profile-guided optimization",
+    false /* Only looks at CFG */,
+    false /* Analysis Pass */);
+
+static RegisterPass<ProfileAnnotator> Y(
+    "profile-annotate", "Apply an execution profile",
+    false /* Only looks at CFG */,
+    false /* Analysis Pass */);
+
+// The runtime function which registers the counters, and writes them out at exit.
+// Must agree with runtime/lib/Profile.c.
+static const char PROFILE_INIT[] = "Profile_init";
+static const char PROFILE_HEADER[] = "tart-profile";
+
+// Functions which account for this percentage of all calls are considered hot.
+static const uint64_t HOT_PERCENT = 90;
+
+// Hot functions larger than this don't get an inline hint.
+static const unsigned HOT_INLINE_SIZE = 100;
+
+// -------------------------------------------------------------------
+// Counter layout, shared by the instrumenter and the annotator.
+
+/** Return the number of instructions in 'fn'. */
+static unsigned instructionCount(Function * fn) {
+  unsigned count = 0;
+  for (Function::iterator bb = fn->begin(); bb != fn->end(); ++bb) {
+    count += bb->size();
+  }
+  return count;
+}
+
+/** Return the conditional branch which ends 'bb', or NULL. */
+static BranchInst * conditionalBranch(BasicBlock * bb) {
+  BranchInst * br = dyn_cast<BranchInst>(bb->getTerminator());
+  return br != NULL && br->isConditional() ? br : NULL;
+}
+
+/** Return the number of counters for 'fn': one for the entry, and two for each
+    conditional branch. */
+static unsigned counterCount(Function * fn) {
+  unsigned count = 1;
+  for (Function::iterator bb = fn->begin(); bb != fn->end(); ++bb) {
+    if (conditionalBranch(bb)) {
+      count += 2;
+    }
+  }
+  return count;
+}
+
+/** Compute a checksum of the program's shape, so that a profile from a different
+    program can be detected. */
+static uint64_t checksum(Module & module) {
+  // FNV-1a over the names of the functions and the number of counters in each.
+  uint64_t hash = 14695981039346656037ULL;
+  for (Module::iterator it = module.begin(); it != module.end(); ++it) {
+    if (it->isDeclaration()) {
+      continue;
+    }
+
+    StringRef name = it->getName();
+    for (StringRef::iterator ch = name.begin(); ch != name.end(); ++ch) {
+      hash = (hash ^ uint8_t(*ch)) * 1099511628211ULL;
+    }
+
+    hash = (hash ^ counterCount(it)) * 1099511628211ULL;
+  }
+
+  return hash;
+}
+
+// -------------------------------------------------------------------
+// ProfileInstrumenter
+
+/** Insert code before 'pos' which adds 'amount' to counter 'index'. */
+static void incrementCounter(GlobalVariable * counters, unsigned index, Value * amount,
+    Instruction * pos) {
+  LLVMContext & context = counters->getContext();
+  Constant * indices[] = {
+    ConstantInt::get(Type::getInt32Ty(context), 0),
+    ConstantInt::get(Type::getInt32Ty(context), index),
+  };
+
+  Constant * counter = ConstantExpr::getInBoundsGetElementPtr(counters, indices);
+  Value * value = new LoadInst(counter, "prof", pos);
+  value = BinaryOperator::CreateAdd(value, amount, "prof", pos);
+  new StoreInst(value, counter, pos);
+}
+
+bool ProfileInstrumenter::runOnModule(Module & module) {
+  Function * mainFn = module.getFunction("main");
+  if (mainFn == NULL || mainFn->isDeclaration()) {
+    return false;
+  }
+
+  for (Module::iterator it = module.begin(); it != module.end(); ++it) {
+    if (!it->isDeclaration()) {
+      numCounters_ += counterCount(it);
+    }
+  }
+
+  LLVMContext & context = module.getContext();
+  IntegerType * counterType = Type::getInt64Ty(context);
+  ArrayType * arrayType = ArrayType::get(counterType, numCounters_);
+  GlobalVariable * counters = new GlobalVariable(module, arrayType, false,
+      GlobalValue::InternalLinkage, ConstantAggregateZero::get(arrayType),
+      "tart.profile.counters");
+
+  Constant * one = ConstantInt::get(counterType, 1);
+  unsigned index = 0;
+  for (Module::iterator it = module.begin(); it != module.end(); ++it) {
+    if (it->isDeclaration()) {
+      continue;
+    }
+
+    incrementCounter(counters, index++, one, it->getEntryBlock().getFirstNonPHI());
+    for (Function::iterator bb = it->begin(); bb != it->end(); ++bb) {
+      if (BranchInst * br = conditionalBranch(bb)) {
+        // Count both ways at once, rather than splitting the edges.
+        Value * taken = new ZExtInst(br->getCondition(), counterType, "prof", br);
+        incrementCounter(counters, index++, taken, br);
+        incrementCounter(counters, index++,
+            BinaryOperator::CreateSub(one, taken, "prof", br), br);
+      }
+    }
+  }
+
+  // Register the counters at the start of main().
+  Type * argTypes[] = {
+    counterType->getPointerTo(),
+    Type::getInt32Ty(context),
+    counterType,
+  };
+
+  Constant * profileInit = module.getOrInsertFunction(PROFILE_INIT,
+      FunctionType::get(Type::getVoidTy(context), argTypes, false));
+  Value * args[] = {
+    ConstantExpr::getPointerCast(counters, counterType->getPointerTo()),
+    ConstantInt::get(Type::getInt32Ty(context), numCounters_),
+    ConstantInt::get(counterType, checksum(module)),
+  };
+
+  CallInst::Create(profileInit, args, "", mainFn->getEntryBlock().getFirstNonPHI());
+  return true;
+}
+
+void ProfileInstrumenter::printStats(raw_ostream & out) const {
+  out << "Inserted " << numCounters_ << " profile counters.\n";
+}
+
+// -------------------------------------------------------------------
+// ProfileAnnotator
+
+bool ProfileAnnotator::runOnModule(Module & module) {
+  CountList counts;
+  uint64_t profileChecksum;
+  if (!readProfile(counts, profileChecksum)) {
+    return false;
+  }
+
+  unsigned numCounters = 0;
+  for (Module::iterator it = module.begin(); it != module.end(); ++it) {
+    if (!it->isDeclaration()) {
+      numCounters += counterCount(it);
+    }
+  }
+
+  if (counts.size() != numCounters || profileChecksum != checksum(module)) {
+    errMsg_ = "profile does not match this program";
+    return false;
+  }
+
+  EntryCountList entryCounts;
+  CountList::const_iterator count = counts.begin();
+  for (Module::iterator it = module.begin(); it != module.end(); ++it) {
+    if (!it->isDeclaration()) {
+      entryCounts.push_back(EntryCount(*count++, it));
+      annotateBranches(it, count);
+    }
+  }
+
+  markHotAndCold(module, entryCounts);
+
+  // Put the functions in order of decreasing call count, so that the code which
+  // runs most often is packed together. The sort is stable, so the rest of the
+  // order is the same as before.
+  std::stable_sort(entryCounts.begin(), entryCounts.end(), CompareEntryCounts());
+  Module::FunctionListType & functions = module.getFunctionList();
+  for (EntryCountList::iterator it = entryCounts.begin(); it != entryCounts.end(); ++it) {
+    functions.splice(functions.end(), functions, it->second);
+  }
+
+  return true;
+}
+
+bool ProfileAnnotator::readProfile(CountList & counts, uint64_t & profileChecksum) {
+  OwningPtr<MemoryBuffer> buffer;
+  if (error_code ec = MemoryBuffer::getFile(profilePath_, buffer)) {
+    errMsg_ = "can't read " + profilePath_ + ": " + ec.message();
+    return false;
+  }
+
+  // The header line is 'tart-profile <checksum> <number of counters>', followed
+  // by one count per line.
+  SmallVector<StringRef, 1024> lines;
+  buffer->getBuffer().split(lines, "\n", -1, false);
+  SmallVector<StringRef, 3> header;
+  unsigned long long value = 0;
+  unsigned numCounters = 0;
+  if (!lines.empty()) {
+    lines[0].split(header, " ", -1, false);
+  }
+
+  if (header.size() != 3 || header[0] != PROFILE_HEADER ||
+      header[1].getAsInteger(10, value) ||
+      header[2].getAsInteger(10, numCounters) || lines.size() != numCounters + 1) {
+    errMsg_ = profilePath_ + " is not a valid profile";
+    return false;
+  }
+
+  profileChecksum = value;
+  counts.resize(numCounters);
+  for (unsigned i = 0; i < numCounters; ++i) {
+    if (lines[i + 1].trim().getAsInteger(10, value)) {
+      errMsg_ = profilePath_ + " is not a valid profile";
+      return false;
+    }
+    counts[i] = value;
+  }
+
+  return true;
+}
+
+void ProfileAnnotator::annotateBranches(Function * fn, CountList::const_iterator & count) {
+  LLVMContext & context = fn->getContext();
+  for (Function::iterator bb = fn->begin(); bb != fn->end(); ++bb) {
+    if (BranchInst * br = conditionalBranch(bb)) {
+      uint64_t taken = *count++;
+      uint64_t notTaken = *count++;
+      if (taken + notTaken == 0) {
+        continue;
+      }
+
+      // Branch weights are 32 bits. Scale both counts down together to fit, and
+      // add one so that neither weight is zero.
+      while (taken > 0xfffffffeULL || notTaken > 0xfffffffeULL) {
+        taken >>= 1;
+        notTaken >>= 1;
+      }
+
+      Value * weights[] = {
+        MDString::get(context, "branch_weights"),
+        ConstantInt::get(Type::getInt32Ty(context), taken + 1),
+        ConstantInt::get(Type::getInt32Ty(context), notTaken + 1),
+      };
+
+      br->setMetadata(LLVMContext::MD_prof, MDNode::get(context, weights));
+      ++numBranches_;
+    }
+  }
+}
+
+void ProfileAnnotator::markHotAndCold(Module & module, const EntryCountList & entryCounts) {
+  EntryCountList sorted(entryCounts);
+  std::stable_sort(sorted.begin(), sorted.end(), CompareEntryCounts());
+
+  uint64_t totalCalls = 0;
+  for (EntryCountList::const_iterator it = sorted.begin(); it != sorted.end(); ++it) {
+    totalCalls += it->first;
+  }
+
+  // Functions are hot until the ones seen so far account for most of the calls.
+  Triple triple(module.getTargetTriple());
+  bool isELF = !triple.isOSDarwin() && triple.getOS() != Triple::Win32 &&
+      triple.getOS() != Triple::MinGW32 && triple.getOS() != Triple::Cygwin;
+  uint64_t callsSoFar = 0;
+  for (EntryCountList::const_iterator it = sorted.begin(); it != sorted.end(); ++it) {
+    Function * fn = it->second;
+    if (it->first == 0) {
+      fn->addFnAttr(Attribute::OptimizeForSize);
+      if (isELF && !fn->hasSection()) {
+        fn->setSection(".text.unlikely");
+      }
+      ++numCold_;
+    } else if (callsSoFar * 100 < totalCalls * HOT_PERCENT) {
+      if (!fn->hasFnAttr(Attribute::NoInline) && instructionCount(fn) < HOT_INLINE_SIZE) {
+        fn->addFnAttr(Attribute::InlineHint);
+      }
+      ++numHot_;
+    }
+
+    callsSoFar += it->first;
+  }
+}
+
+void ProfileAnnotator::printStats(raw_ostream & out) const {
+  out << "Profile: annotated " << numBranches_ << " branches; " << numHot_ <<
+      " hot and " << numCold_ << " cold functions.\n";
+}
+
+}
@@ -27,8 +27,16 @@ enum GCInfoBits {
 
 #endif
 
+/** Bits in the 'flags' field of a trace descriptor. */
+enum TraceDescriptorFlags {
+  TraceDescriptor_Last = (1<<0),          // Last descriptor in the list
+  TraceDescriptor_DeltaOffsets = (1<<1),  // Field offsets are int16 deltas
+  TraceDescriptor_Array = (1<<2),         // Variable-length array, see ArrayTraceInfo
+  TraceDescriptor_VoidOrRef = (1<<3),     // Union of references and void
+};
+
 struct TraceDescriptor {
-  uint16_t last;
+  uint16_t flags;
   uint16_t fieldCount;
   int32_t offset;
   union {
@@ -37,6 +45,15 @@ struct TraceDescriptor {
   };
 };
 
+/** Describes the elements of a variable-length array; pointed to by a trace
+    descriptor that has the TraceDescriptor_Array flag set. */
+struct ArrayTraceInfo {
+  uint32_t countOffset;
+  uint32_t countSize;
+  uint32_t stride;
+  TraceDescriptor * elementTrace;
+};
+
 struct StackFrameDescMapEntry {
   // The address of the instruction
   void * instructionAddr;
@@ -0,0 +1,46 @@
+/** High-resolution monotonic clock. */
+
+#include "config.h"
+
+#if HAVE_STDINT_H
+#include <stdint.h>
+#endif
+
+#if _WIN32
+  #include <windows.h>
+#elif __APPLE__
+  #include <mach/mach_time.h>
+#elif HAVE_CLOCK_GETTIME
+  #include <time.h>
+#elif HAVE_SYS_TIME_H
+  #include <sys/time.h>
+#endif
+
+/** Return the current value of the clock in nanoseconds. The starting point is
+    arbitrary, so only the difference between two readings is meaningful. */
+int64_t MonotonicClock_nanos() {
+#if _WIN32
+  static LARGE_INTEGER frequency;
+  LARGE_INTEGER count;
+  if (frequency.QuadPart == 0) {
+    QueryPerformanceFrequency(&frequency);
+  }
+  QueryPerformanceCounter(&count);
+  return (int64_t)((double) count.QuadPart * 1.0e9 / (double) frequency.QuadPart);
+#elif __APPLE__
+  static mach_timebase_info_data_t timebase;
+  if (timebase.denom == 0) {
+    mach_timebase_info(&timebase);
+  }
+  return (int64_t)(mach_absolute_time() * timebase.numer / timebase.denom);
+#elif HAVE_CLOCK_GETTIME
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+#else
+  // Not monotonic, but the best that's available.
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return (int64_t) tv.tv_sec * 1000000000 + (int64_t) tv.tv_usec * 1000;
+#endif
+}
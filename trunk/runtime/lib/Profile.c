@@ -0,0 +1,48 @@
+/** Execution profile support for programs linked with 'tartln -profile-generate'. */
+
+#include "config.h"
+
+#if HAVE_STDINT_H
+#include <stdint.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static const uint64_t * profileCounters;
+static uint32_t profileCounterCount;
+static uint64_t profileChecksum;
+
+/** Write the counters to the profile file. The file is named by the TART_PROFILE_FILE
+    environment variable, and defaults to 'tart.profdata' in the current directory. The
+    format must agree with ProfileAnnotator in the linker. */
+static void Profile_write() {
+  const char * fileName = getenv("TART_PROFILE_FILE");
+  if (fileName == NULL || fileName[0] == '\0') {
+    fileName = "tart.profdata";
+  }
+
+  FILE * out = fopen(fileName, "w");
+  if (out == NULL) {
+    fprintf(stderr, "Can't write profile to %s\n", fileName);
+    return;
+  }
+
+  fprintf(out, "tart-profile %llu %u\n", (unsigned long long) profileChecksum,
+      profileCounterCount);
+  for (uint32_t i = 0; i < profileCounterCount; ++i) {
+    fprintf(out, "%llu\n", (unsigned long long) profileCounters[i]);
+  }
+
+  fclose(out);
+}
+
+/** Called at the start of main() by an instrumented program. */
+void Profile_init(const uint64_t * counters, uint32_t count, uint64_t checksum) {
+  if (profileCounters == NULL) {
+    profileCounters = counters;
+    profileCounterCount = count;
+    profileChecksum = checksum;
+    atexit(Profile_write);
+  }
+}
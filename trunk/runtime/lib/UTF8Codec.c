@@ -0,0 +1,199 @@
+/** Bulk encoding and decoding functions for the UTF-8 codec. These handle long runs
+    of input many bytes at a time, and leave anything unusual to the codec itself. */
+
+#include "config.h"
+
+#if HAVE_STDINT_H
+#include <stdint.h>
+#endif
+
+#if HAVE_STRING_H
+#include <string.h>
+#endif
+
+#if __SSE2__
+#include <emmintrin.h>
+#endif
+
+/** A Tart 'char'. */
+typedef uint32_t tart_char;
+
+#if !__SSE2__
+/** Mask for the high bit of each byte in a word. */
+static const uint64_t HIGH_BITS = 0x8080808080808080ULL;
+#endif
+
+/** Return the number of bytes at the start of 'src' which are ASCII. */
+intptr_t UTF8_asciiLength(const uint8_t * src, intptr_t length) {
+  intptr_t index = 0;
+#if __SSE2__
+  while (index + 16 <= length) {
+    __m128i block = _mm_loadu_si128((const __m128i *) (src + index));
+    if (_mm_movemask_epi8(block) != 0) {
+      break;
+    }
+    index += 16;
+  }
+#else
+  while (index + 8 <= length) {
+    uint64_t word;
+    memcpy(&word, src + index, sizeof(word));
+    if ((word & HIGH_BITS) != 0) {
+      break;
+    }
+    index += 8;
+  }
+#endif
+
+  while (index < length && src[index] < 0x80) {
+    ++index;
+  }
+
+  return index;
+}
+
+/** Copy the ASCII bytes at the start of 'src' to 'dst', widening each one to a char.
+    Returns the number of characters copied. */
+static intptr_t widenAscii(tart_char * dst, const uint8_t * src, intptr_t length) {
+  intptr_t index = 0;
+#if __SSE2__
+  __m128i zero = _mm_setzero_si128();
+  while (index + 16 <= length) {
+    __m128i block = _mm_loadu_si128((const __m128i *) (src + index));
+    if (_mm_movemask_epi8(block) != 0) {
+      break;
+    }
+
+    __m128i lo = _mm_unpacklo_epi8(block, zero);
+    __m128i hi = _mm_unpackhi_epi8(block, zero);
+    _mm_storeu_si128((__m128i *) (dst + index), _mm_unpacklo_epi16(lo, zero));
+    _mm_storeu_si128((__m128i *) (dst + index + 4), _mm_unpackhi_epi16(lo, zero));
+    _mm_storeu_si128((__m128i *) (dst + index + 8), _mm_unpacklo_epi16(hi, zero));
+    _mm_storeu_si128((__m128i *) (dst + index + 12), _mm_unpackhi_epi16(hi, zero));
+    index += 16;
+  }
+#else
+  while (index + 8 <= length) {
+    uint64_t word;
+    memcpy(&word, src + index, sizeof(word));
+    if ((word & HIGH_BITS) != 0) {
+      break;
+    }
+
+    // A fixed-length loop, which the compiler is free to unroll or vectorize.
+    for (int i = 0; i < 8; ++i) {
+      dst[index + i] = src[index + i];
+    }
+    index += 8;
+  }
+#endif
+
+  while (index < length && src[index] < 0x80) {
+    dst[index] = src[index];
+    ++index;
+  }
+
+  return index;
+}
+
+/** Copy the characters at the start of 'src' which are ASCII to 'dst', as bytes.
+    Returns the number of characters copied. */
+intptr_t UTF8_encodeAscii(uint8_t * dst, const tart_char * src, intptr_t length) {
+  intptr_t index = 0;
+#if __SSE2__
+  __m128i zero = _mm_setzero_si128();
+  __m128i nonAscii = _mm_set1_epi32(~0x7f);
+  while (index + 16 <= length) {
+    __m128i a = _mm_loadu_si128((const __m128i *) (src + index));
+    __m128i b = _mm_loadu_si128((const __m128i *) (src + index + 4));
+    __m128i c = _mm_loadu_si128((const __m128i *) (src + index + 8));
+    __m128i d = _mm_loadu_si128((const __m128i *) (src + index + 12));
+    __m128i high = _mm_and_si128(
+        _mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d)), nonAscii);
+    if (_mm_movemask_epi8(_mm_cmpeq_epi32(high, zero)) != 0xffff) {
+      break;
+    }
+
+    // All of the values are below 0x80, so the saturating packs don't change them.
+    __m128i bytes = _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d));
+    _mm_storeu_si128((__m128i *) (dst + index), bytes);
+    index += 16;
+  }
+#endif
+
+  while (index < length && src[index] < 0x80) {
+    dst[index] = (uint8_t) src[index];
+    ++index;
+  }
+
+  return index;
+}
+
+/** Decode as much of 'src' as possible into 'dst'. Decoding stops when 'dst' is full,
+    or before the first byte sequence which is not well-formed UTF-8 - including
+    overlong encodings, surrogates, values above 0x10ffff, and sequences which are cut
+    off by the end of 'src'. The number of bytes consumed is stored in 'srcCount', and
+    the number of characters written is returned. */
+intptr_t UTF8_decode(tart_char * dst, intptr_t dstLength,
+    const uint8_t * src, intptr_t srcLength, intptr_t * srcCount) {
+  intptr_t srcIndex = 0;
+  intptr_t dstIndex = 0;
+  while (srcIndex < srcLength && dstIndex < dstLength) {
+    uint8_t b = src[srcIndex];
+    if (b < 0x80) {
+      intptr_t srcAvail = srcLength - srcIndex;
+      intptr_t dstAvail = dstLength - dstIndex;
+      intptr_t count = widenAscii(dst + dstIndex, src + srcIndex,
+          srcAvail < dstAvail ? srcAvail : dstAvail);
+      srcIndex += count;
+      dstIndex += count;
+      continue;
+    }
+
+    intptr_t length;
+    tart_char charVal;
+    tart_char minVal;
+    if (b < 0xc2) {
+      // A continuation byte, or the start of an overlong 2-byte sequence.
+      break;
+    } else if (b < 0xe0) {
+      length = 2;
+      charVal = b & 0x1f;
+      minVal = 0x80;
+    } else if (b < 0xf0) {
+      length = 3;
+      charVal = b & 0x0f;
+      minVal = 0x800;
+    } else if (b < 0xf5) {
+      length = 4;
+      charVal = b & 0x07;
+      minVal = 0x10000;
+    } else {
+      break;
+    }
+
+    if (srcIndex + length > srcLength) {
+      break;
+    }
+
+    intptr_t i;
+    for (i = 1; i < length; ++i) {
+      uint8_t next = src[srcIndex + i];
+      if ((next & 0xc0) != 0x80) {
+        break;
+      }
+      charVal = (charVal << 6) | (next & 0x3f);
+    }
+
+    if (i < length || charVal < minVal || charVal > 0x10ffff ||
+        (charVal >= 0xd800 && charVal <= 0xdfff)) {
+      break;
+    }
+
+    dst[dstIndex++] = charVal;
+    srcIndex += length;
+  }
+
+  *srcCount = srcIndex;
+  return dstIndex;
+}
@@ -49,6 +49,8 @@ namespace {
   size_t stackFrameDescMapSize;
   size_t stackFrameDescMapMask;
   StackFrameDescMapEntry * stackFrameDescMap;
+  const StackFrameDescMapEntry * sortedFrameDescMap;
+  size_t sortedFrameDescMapSize;
   StaticRootsTableEntry * staticRootsTable;
 
   #if HAVE_GCC_THREAD_LOCAL
@@ -102,46 +104,89 @@ void * GC_allocAligned(size_t size) {
   #endif
 }
 
+/** Return the map segment which follows 'segment', or NULL. Each segment is a count,
+    followed by that many entries, followed by a pointer to the next segment. */
+static size_t * GC_nextStackFrameDescSegment(size_t * segment) {
+  StackFrameDescMapEntry * entries = (StackFrameDescMapEntry *)(segment + 1);
+  return *(size_t **)(entries + *segment);
+}
+
 void GC_initStackFrameDescMap(size_t * initData) {
   // get list of stack frame descriptors
   size_t numEntries = *initData;
   StackFrameDescMapEntry * entries = (StackFrameDescMapEntry *)(initData + 1);
 
+  // The linker emits the safepoint map in code order, so normally the entries are
+  // already sorted by address. In that case the map is searched in place - it lives
+  // in read-only data and needs no further setup.
+  bool sorted = GC_nextStackFrameDescSegment(initData) == NULL;
+  for (size_t i = 1; sorted && i < numEntries; ++i) {
+    if (entries[i - 1].instructionAddr >= entries[i].instructionAddr) {
+      sorted = false;
+    }
+  }
+
+  if (sorted) {
+    sortedFrameDescMap = entries;
+    sortedFrameDescMapSize = numEntries;
+    return;
+  }
+
+  // Otherwise (functions were placed in separate sections, or the map was generated
+  // in several pieces), fall back to a hash table.
+  for (size_t * segment = GC_nextStackFrameDescSegment(initData); segment != NULL;
+      segment = GC_nextStackFrameDescSegment(segment)) {
+    numEntries += *segment;
+  }
+
   // Find the nearest power of two larger than numEntries.
   size_t tableSize = 64;
   while (tableSize < numEntries) {
     tableSize <<= 1;
   }
 
-  // Multiply by two to give room for collisions.
+  // Multiply by two to give room for collisions. Since the table is never more than
+  // half full, probing always finds an empty slot.
   stackFrameDescMapSize = tableSize * 2;
   stackFrameDescMapMask = stackFrameDescMapSize - 1;
   stackFrameDescMap = new StackFrameDescMapEntry[stackFrameDescMapSize];
   memset(stackFrameDescMap, 0, sizeof(StackFrameDescMapEntry) * stackFrameDescMapSize);
 
-  for (size_t i = 0; i < numEntries; ++i, ++entries) {
-    size_t index = GC_hashAddress(entries->instructionAddr) & stackFrameDescMapMask;
-    size_t probeCount = 0;
-    while (stackFrameDescMap[index].instructionAddr != NULL) {
-      index = (index + 1) & stackFrameDescMapMask;
+  for (size_t * segment = initData; segment != NULL;
+      segment = GC_nextStackFrameDescSegment(segment)) {
+    entries = (StackFrameDescMapEntry *)(segment + 1);
+    for (size_t i = 0; i < *segment; ++i, ++entries) {
+      size_t index = GC_hashAddress(entries->instructionAddr) & stackFrameDescMapMask;
+      while (stackFrameDescMap[index].instructionAddr != NULL) {
+        index = (index + 1) & stackFrameDescMapMask;
+      }
       #if HAVE_ASSERT_H
-        if (probeCount >= 10) {
-          fprintf(stderr, "Collision for table size %lu, index %lu, entry %lu\n",
-              stackFrameDescMapSize, index, i);
-          abort();
-        }
-        assert(probeCount < 5);
+        assert(index < stackFrameDescMapSize);
       #endif
+      stackFrameDescMap[index].instructionAddr = entries->instructionAddr;
+      stackFrameDescMap[index].traceTable = entries->traceTable;
     }
-    #if HAVE_ASSERT_H
-      assert(index < stackFrameDescMapSize);
-    #endif
-    stackFrameDescMap[index].instructionAddr = entries->instructionAddr;
-    stackFrameDescMap[index].traceTable = entries->traceTable;
   }
 }
 
 static TraceDescriptor * GC_lookupStackFrameDesc(void * addr) {
+  if (sortedFrameDescMap != NULL) {
+    size_t lo = 0;
+    size_t hi = sortedFrameDescMapSize;
+    while (lo < hi) {
+      size_t mid = lo + (hi - lo) / 2;
+      void * midAddr = sortedFrameDescMap[mid].instructionAddr;
+      if (midAddr == addr) {
+        return sortedFrameDescMap[mid].traceTable;
+      } else if (midAddr < addr) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+    return NULL;
+  }
+
   size_t index = GC_hashAddress(addr) & stackFrameDescMapMask;
   while (stackFrameDescMap[index].instructionAddr != NULL) {
     if (stackFrameDescMap[index].instructionAddr == addr) {
@@ -102,6 +102,46 @@ struct BacktraceContext {
   void * dlHandle;
 };
 
+// A decoded entry in the call-site table.
+struct CallSiteEntry {
+  _Unwind_Ptr start;
+  _Unwind_Ptr end;
+  _Unwind_Ptr landingPad;
+  const unsigned char * actionRecord;
+};
+
+// A fully decoded LSDA, so that the call-site table only needs to be parsed once
+// per function. Once published in the cache, instances are never modified or freed.
+struct DecodedLSDA {
+  const unsigned char * langSpecData;
+  struct LSDAHeaderInfo header;
+  size_t callSiteCount;
+  struct CallSiteEntry callSites[1];
+};
+
+// A memoized result of a type match.
+struct TypeMatchEntry {
+  const struct TypeInfoBlock * tib;
+  const struct TypeInfoBlock * type;
+  bool result;
+};
+
+// Both caches are fixed-size open-addressed tables, filled in using compare-and-swap
+// and never evicted. If a probe sequence is full, we simply don't cache.
+#define LSDA_CACHE_SIZE 1024
+#define TYPE_MATCH_CACHE_SIZE 1024
+#define CACHE_MAX_PROBES 8
+
+#if HAVE_GCC_ATOMICS
+static struct DecodedLSDA * lsdaCache[LSDA_CACHE_SIZE];
+static struct TypeMatchEntry * typeMatchCache[TYPE_MATCH_CACHE_SIZE];
+#endif
+
+// Hash function for addresses.
+static size_t hashAddress(const void * addr) {
+  return ((uintptr_t) addr ^ ((uintptr_t) addr >> 9)) * 2654435769u;
+}
+
 // isSubclass() test for Tart objects.
 static bool hasBase(const struct TypeInfoBlock * tib, const struct TypeInfoBlock * type) {
   if (tib == type) {
@@ -119,6 +159,40 @@ static bool hasBase(const struct TypeInfoBlock * tib, const struct TypeInfoBlock
   return false;
 }
 
+// Memoized version of hasBase().
+static bool hasBaseCached(const struct TypeInfoBlock * tib, const struct TypeInfoBlock * type) {
+  if (tib == type) {
+    return true;
+  }
+
+#if HAVE_GCC_ATOMICS
+  size_t index = hashAddress(tib) ^ hashAddress(type);
+  for (int probe = 0; probe < CACHE_MAX_PROBES; ++probe, ++index) {
+    struct TypeMatchEntry ** slot = &typeMatchCache[index & (TYPE_MATCH_CACHE_SIZE - 1)];
+    struct TypeMatchEntry * entry = *slot;
+    if (entry == NULL) {
+      bool result = hasBase(tib, type);
+      entry = (struct TypeMatchEntry *) malloc(sizeof(struct TypeMatchEntry));
+      if (entry != NULL) {
+        entry->tib = tib;
+        entry->type = type;
+        entry->result = result;
+        __sync_synchronize();
+        if (!__sync_bool_compare_and_swap(slot, NULL, entry)) {
+          // Someone else got there first.
+          free(entry);
+        }
+      }
+      return result;
+    } else if (entry->tib == tib && entry->type == type) {
+      return entry->result;
+    }
+  }
+#endif
+
+  return hasBase(tib, type);
+}
+
 // Read an unsigned word in LBE128 (Little-Endian Base 128)
 static const unsigned char * readEncodedUWord(const unsigned char * pos, _Unwind_Word * out) {
   unsigned int shift = 0;
@@ -314,6 +388,117 @@ const unsigned char * findCallSite(
   return pos;
 }
 
+// Decode the entire call-site table of an LSDA.
+static struct DecodedLSDA * decodeLSDA(
+    const unsigned char * langSpecData, _Unwind_Ptr regionStart) {
+  struct LSDAHeaderInfo header;
+  const unsigned char * pos;
+  const unsigned char * callSiteTable;
+  size_t count = 0;
+
+  header.regionStart = regionStart;
+  callSiteTable = parseLDSAHeader(langSpecData, &header);
+
+  // Count the entries first, so that the table can be allocated in one piece.
+  for (pos = callSiteTable; pos < header.actionTable; ++count) {
+    _Unwind_Ptr value;
+    _Unwind_Word action;
+    pos = readEncodedValue(0, header.callSiteEncoding, pos, &value);
+    pos = readEncodedValue(0, header.callSiteEncoding, pos, &value);
+    pos = readEncodedValue(0, header.callSiteEncoding, pos, &value);
+    pos = readEncodedUWord(pos, &action);
+  }
+
+  struct DecodedLSDA * result = (struct DecodedLSDA *) malloc(
+      sizeof(struct DecodedLSDA) + (count > 0 ? count - 1 : 0) * sizeof(struct CallSiteEntry));
+  if (result == NULL) {
+    return NULL;
+  }
+
+  result->langSpecData = langSpecData;
+  result->header = header;
+  result->callSiteCount = count;
+
+  struct CallSiteEntry * entry = result->callSites;
+  for (pos = callSiteTable; pos < header.actionTable; ++entry) {
+    _Unwind_Ptr callSiteStart;
+    _Unwind_Ptr callSiteLength;
+    _Unwind_Ptr callSiteLandingPad;
+    _Unwind_Word callSiteAction;
+
+    pos = readEncodedValue(0, header.callSiteEncoding, pos, &callSiteStart);
+    pos = readEncodedValue(0, header.callSiteEncoding, pos, &callSiteLength);
+    pos = readEncodedValue(0, header.callSiteEncoding, pos, &callSiteLandingPad);
+    pos = readEncodedUWord(pos, &callSiteAction);
+
+    entry->start = regionStart + callSiteStart;
+    entry->end = entry->start + callSiteLength;
+    entry->landingPad = callSiteLandingPad ? header.landingPadStart + callSiteLandingPad : 0;
+    entry->actionRecord = callSiteAction ? header.actionTable + callSiteAction - 1 : NULL;
+  }
+
+  return result;
+}
+
+// Return the decoded form of an LSDA from the cache, decoding it if needed. Returns NULL
+// if the LSDA could not be cached.
+static struct DecodedLSDA * lookupLSDA(
+    const unsigned char * langSpecData, _Unwind_Ptr regionStart) {
+#if HAVE_GCC_ATOMICS
+  size_t index = hashAddress(langSpecData);
+  for (int probe = 0; probe < CACHE_MAX_PROBES; ++probe, ++index) {
+    struct DecodedLSDA ** slot = &lsdaCache[index & (LSDA_CACHE_SIZE - 1)];
+    struct DecodedLSDA * entry = *slot;
+    if (entry == NULL) {
+      entry = decodeLSDA(langSpecData, regionStart);
+      if (entry == NULL) {
+        return NULL;
+      }
+
+      __sync_synchronize();
+      if (__sync_bool_compare_and_swap(slot, NULL, entry)) {
+        return entry;
+      }
+
+      // Another thread filled this slot first - see if it was for the same LSDA.
+      free(entry);
+      entry = *slot;
+    }
+
+    if (entry->langSpecData == langSpecData && entry->header.regionStart == regionStart) {
+      return entry;
+    }
+  }
+#endif
+
+  return NULL;
+}
+
+// Binary search the decoded call-site table for the given IP.
+static void findCallSiteDecoded(
+    const struct DecodedLSDA * lsda,
+    _Unwind_Ptr ip,
+    struct CallSiteInfo * csInfo) {
+  size_t lo = 0;
+  size_t hi = lsda->callSiteCount;
+
+  csInfo->landingPad = 0;
+  csInfo->actionRecord = NULL;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    const struct CallSiteEntry * entry = &lsda->callSites[mid];
+    if (ip < entry->start) {
+      hi = mid;
+    } else if (ip >= entry->end) {
+      lo = mid + 1;
+    } else {
+      csInfo->landingPad = entry->landingPad;
+      csInfo->actionRecord = entry->actionRecord;
+      return;
+    }
+  }
+}
+
 // Find the action record for the given exception and call site.
 bool findAction(
     struct LSDAHeaderInfo * lpInfo,
@@ -341,7 +526,7 @@ bool findAction(
           lpInfo->typeTable - actionFilter, // position
           (_Unwind_Ptr *) &type);
 
-      if (type == NULL || hasBase(tib, type)) {
+      if (type == NULL || hasBaseCached(tib, type)) {
         *actionResult = actionResultIndex;
         return true;
       }
@@ -422,10 +607,18 @@ _Unwind_Reason_Code __tart_eh_personality_impl(
   lpInfo.regionStart = _Unwind_GetRegionStart(context);
   ip = _Unwind_GetIP(context) - 1;
 
-  // Find the call site that threw the exception.
-  pos = parseLDSAHeader(langSpecData, &lpInfo);
-  lpInfo.typeTableBase = encodedValueBase(lpInfo.typeTableEncoding, context);
-  pos = findCallSite(pos, &lpInfo, ip, &csInfo);
+  // Find the call site that threw the exception. Use the cached, decoded form of the
+  // call-site table if we can, otherwise parse it.
+  const struct DecodedLSDA * decoded = lookupLSDA(langSpecData, lpInfo.regionStart);
+  if (decoded != NULL) {
+    lpInfo = decoded->header;
+    lpInfo.typeTableBase = encodedValueBase(lpInfo.typeTableEncoding, context);
+    findCallSiteDecoded(decoded, ip, &csInfo);
+  } else {
+    pos = parseLDSAHeader(langSpecData, &lpInfo);
+    lpInfo.typeTableBase = encodedValueBase(lpInfo.typeTableEncoding, context);
+    pos = findCallSite(pos, &lpInfo, ip, &csInfo);
+  }
   if (csInfo.landingPad == 0) {
     return _URC_CONTINUE_UNWIND;
   } else if (csInfo.actionRecord == NULL) {
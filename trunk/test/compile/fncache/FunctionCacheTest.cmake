@@ -0,0 +1,44 @@
+# Compiles a module twice against the same function cache. The second compile
+# should load functions from the cache, and write the same bitcode as the first.
+#
+# Run with cmake -P, defining TARTC, MODPATH, SRCDIR, SRC_FILE and WORKDIR.
+
+file(REMOVE_RECURSE ${WORKDIR})
+
+foreach(RUN first second)
+  execute_process(
+      COMMAND ${TARTC} -debug-errors -nostdlib -i${MODPATH}
+          -fn-cache=${WORKDIR}/cache
+          -d ${WORKDIR}/${RUN}
+          -stats-json=${WORKDIR}/${RUN}.json
+          -sourcepath ${SRCDIR} ${SRC_FILE}
+      RESULT_VARIABLE RESULT)
+  if (NOT RESULT EQUAL 0)
+    message(FATAL_ERROR "Compiling ${SRC_FILE} failed on the ${RUN} run")
+  endif ()
+
+  file(READ ${WORKDIR}/${RUN}.json STATS)
+  if (NOT STATS MATCHES "\"fncache-hits\": ([0-9]+)")
+    message(FATAL_ERROR "No fncache-hits counter in ${WORKDIR}/${RUN}.json")
+  endif ()
+  set(${RUN}_HITS ${CMAKE_MATCH_1})
+endforeach ()
+
+if (NOT first_HITS EQUAL 0)
+  message(FATAL_ERROR "The first compile found ${first_HITS} functions in an empty cache")
+endif ()
+
+if (NOT second_HITS GREATER 0)
+  message(FATAL_ERROR "The second compile found no functions in the cache")
+endif ()
+
+string(REGEX REPLACE ".tart$" ".bc" BC_FILE "${SRC_FILE}")
+execute_process(
+    COMMAND ${CMAKE_COMMAND} -E compare_files
+        ${WORKDIR}/first/${BC_FILE} ${WORKDIR}/second/${BC_FILE}
+    RESULT_VARIABLE RESULT)
+if (NOT RESULT EQUAL 0)
+  message(FATAL_ERROR "Bitcode built from the cache differs from the original")
+endif ()
+
+message(STATUS "Function cache: ${second_HITS} functions reused, output unchanged")
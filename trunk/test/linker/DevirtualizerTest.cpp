@@ -0,0 +1,181 @@
+/* ================================================================ *
+    TART - A Sweet Programming Language.
+ * ================================================================ */
+
+#include <gtest/gtest.h>
+
+#include "tart/Opt/Devirtualizer.h"
+
+#include "llvm/PassManager.h"
+#include "llvm/ADT/OwningPtr.h"
+
+#include <cstring>
+#include <string>
+
+#include "TestHelpers.h"
+
+namespace {
+
+using namespace llvm;
+
+/** A class hierarchy laid out the way the compiler lays out type info blocks:
+    Shape has two methods, 'area' and 'name'. Square overrides 'area', and the final
+    class Rect overrides 'area' as well. Nothing overrides 'name'. The lists of base
+    classes are added by hierarchy(). */
+const char * types =
+    "%TIB = type { i8*, i8*, i8*, i8*, [2 x i8*] }\n"
+    "%Object = type { %TIB* }\n"
+    "%Shape = type { %Object }\n"
+    "%Square = type { %Shape }\n"
+    "%Rect = type { %Shape, i32 }\n"
+    "\n";
+
+const char * tibsAndCalls =
+    "@Shape.TIB = constant %TIB { i8* null, i8* null,\n"
+    "    i8* bitcast ([0 x i8*]* @Shape.bases to i8*), i8* null, [2 x i8*] [\n"
+    "    i8* bitcast (i32 (%Shape*)* @Shape.area to i8*),\n"
+    "    i8* bitcast (i8* (%Shape*)* @Shape.name to i8*)] }\n"
+    "@Square.TIB = constant %TIB { i8* null, i8* null,\n"
+    "    i8* bitcast ([1 x i8*]* @Square.bases to i8*), i8* null, [2 x i8*] [\n"
+    "    i8* bitcast (i32 (%Square*)* @Square.area to i8*),\n"
+    "    i8* bitcast (i8* (%Shape*)* SQUARE_NAME to i8*)] }\n"
+    "@Rect.TIB = constant %TIB { i8* null, i8* null,\n"
+    "    i8* bitcast ([1 x i8*]* @Rect.bases to i8*), i8* null, [2 x i8*] [\n"
+    "    i8* bitcast (i32 (%Rect*)* @Rect.area to i8*),\n"
+    "    i8* bitcast (i8* (%Shape*)* @Shape.name to i8*)] }\n"
+    "\n"
+    "define i32 @Shape.area(%Shape* %self) {\n"
+    "  ret i32 0\n"
+    "}\n"
+    "define i8* @Shape.name(%Shape* %self) {\n"
+    "  ret i8* null\n"
+    "}\n"
+    "define i32 @Square.area(%Square* %self) {\n"
+    "  ret i32 1\n"
+    "}\n"
+    "define i32 @Rect.area(%Rect* %self) {\n"
+    "  ret i32 2\n"
+    "}\n"
+    "@Square.name = weak alias i8* (%Shape*)* @Shape.name\n"
+    "\n"
+    // A call to 'area' on a Rect. Rect is final, so there's only one choice.
+    "define i32 @callRectArea(%Rect* %self) {\n"
+    "  %tibAddr = getelementptr %Rect* %self, i32 0, i32 0, i32 0, i32 0\n"
+    "  %tib = load %TIB** %tibAddr\n"
+    "  %methodAddr = getelementptr %TIB* %tib, i32 0, i32 4, i32 0\n"
+    "  %method = load i8** %methodAddr\n"
+    "  %fn = bitcast i8* %method to i32 (%Rect*)*\n"
+    "  %result = call i32 %fn(%Rect* %self)\n"
+    "  ret i32 %result\n"
+    "}\n"
+    // A call to 'name' on any Shape. Every class has the same implementation.
+    "define i8* @callShapeName(%Shape* %self) {\n"
+    "  %tibAddr = getelementptr %Shape* %self, i32 0, i32 0, i32 0\n"
+    "  %tib = load %TIB** %tibAddr\n"
+    "  %methodAddr = getelementptr %TIB* %tib, i32 0, i32 4, i32 1\n"
+    "  %method = load i8** %methodAddr\n"
+    "  %fn = bitcast i8* %method to i8* (%Shape*)*\n"
+    "  %result = call i8* %fn(%Shape* %self)\n"
+    "  ret i8* %result\n"
+    "}\n"
+    // A call to 'area' on any Shape, which has three implementations.
+    "define i32 @callShapeArea(%Shape* %self) {\n"
+    "  %tibAddr = getelementptr %Shape* %self, i32 0, i32 0, i32 0\n"
+    "  %tib = load %TIB** %tibAddr\n"
+    "  %methodAddr = getelementptr %TIB* %tib, i32 0, i32 4, i32 0\n"
+    "  %method = load i8** %methodAddr\n"
+    "  %fn = bitcast i8* %method to i32 (%Shape*)*\n"
+    "  %result = call i32 %fn(%Shape* %self)\n"
+    "  ret i32 %result\n"
+    "}\n";
+
+/** The class hierarchy, with the lists of base classes given 'basesLinkage'. The
+    entry for 'name' in Square's method table is 'squareName'. */
+std::string hierarchy(const char * basesLinkage, const char * squareName) {
+  std::string ir(types);
+  ir += std::string("@Shape.bases = ") + basesLinkage +
+      " constant [0 x i8*] zeroinitializer\n";
+  ir += std::string("@Square.bases = ") + basesLinkage +
+      " constant [1 x i8*] [i8* bitcast (%TIB* @Shape.TIB to i8*)]\n";
+  ir += std::string("@Rect.bases = ") + basesLinkage +
+      " constant [1 x i8*] [i8* bitcast (%TIB* @Shape.TIB to i8*)]\n";
+  ir += "\n";
+  ir += tibsAndCalls;
+  ir.replace(ir.find("SQUARE_NAME"), strlen("SQUARE_NAME"), squareName);
+  return ir;
+}
+
+class DevirtualizerTest : public testing::Test {
+protected:
+  LLVMContext context;
+  OwningPtr<Module> module;
+
+  virtual void SetUp() {
+    runDevirtualizer("", "@Shape.name");
+  }
+
+  void runDevirtualizer(const char * basesLinkage, const char * squareName) {
+    module.reset(parseIR(context, hierarchy(basesLinkage, squareName).c_str()));
+    ASSERT_TRUE(module != NULL);
+    ASSERT_EQ(NULL, directCallee(module->getFunction("callRectArea")));
+    ASSERT_EQ(NULL, directCallee(module->getFunction("callShapeName")));
+    ASSERT_EQ(NULL, directCallee(module->getFunction("callShapeArea")));
+
+    PassManager passes;
+    passes.add(new tart::Devirtualizer());
+    passes.run(*module);
+  }
+};
+
+TEST_F(DevirtualizerTest, FinalClass) {
+  EXPECT_EQ(module->getFunction("Rect.area"), directCallee(module->getFunction("callRectArea")));
+}
+
+TEST_F(DevirtualizerTest, SingleImplementation) {
+  EXPECT_EQ(module->getFunction("Shape.name"),
+      directCallee(module->getFunction("callShapeName")));
+}
+
+TEST_F(DevirtualizerTest, StaysVirtual) {
+  Function * caller = module->getFunction("callShapeArea");
+  EXPECT_EQ(NULL, directCallee(caller));
+  ASSERT_TRUE(findCall(caller) != NULL);
+
+  // The method is still loaded from the method table.
+  Value * callee = CallSite(findCall(caller)).getCalledValue()->stripPointerCasts();
+  EXPECT_TRUE(isa<LoadInst>(callee));
+}
+
+/** The same hierarchy, but with linkonce lists of base classes. */
+class DevirtualizerLinkOnceTest : public DevirtualizerTest {
+protected:
+  virtual void SetUp() {
+    runDevirtualizer("linkonce", "@Shape.name");
+  }
+};
+
+// Another module could replace a linkonce list of bases with one that names other
+// subclasses of Shape. The hierarchy is unknown, so no call is devirtualized.
+TEST_F(DevirtualizerLinkOnceTest, UnknownHierarchy) {
+  EXPECT_EQ(NULL, directCallee(module->getFunction("callRectArea")));
+  EXPECT_EQ(NULL, directCallee(module->getFunction("callShapeName")));
+  EXPECT_EQ(NULL, directCallee(module->getFunction("callShapeArea")));
+}
+
+/** The same hierarchy, but Square's entry for 'name' is an alias of Shape.name which
+    another module may override. */
+class DevirtualizerWeakAliasTest : public DevirtualizerTest {
+protected:
+  virtual void SetUp() {
+    runDevirtualizer("", "@Square.name");
+  }
+};
+
+// The alias can't be resolved, so it isn't known whether Square shares Shape's 'name'.
+// It mustn't be mistaken for an abstract method and skipped.
+TEST_F(DevirtualizerWeakAliasTest, UnresolvedEntry) {
+  EXPECT_EQ(NULL, directCallee(module->getFunction("callShapeName")));
+  EXPECT_EQ(module->getFunction("Rect.area"), directCallee(module->getFunction("callRectArea")));
+}
+
+}
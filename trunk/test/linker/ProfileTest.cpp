@@ -0,0 +1,185 @@
+/* ================================================================ *
+    TART - A Sweet Programming Language.
+ * ================================================================ */
+
+#include <gtest/gtest.h>
+
+#include "tart/Opt/Profile.h"
+
+#include "llvm/Constants.h"
+#include "llvm/Metadata.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/Support/FileSystem.h"
+
+#include "TestHelpers.h"
+
+namespace {
+
+using namespace llvm;
+
+/** A program with one conditional branch, in 'pick', and a function which is
+    never called. The counters are, in order: pick's entry, the two ways of
+    pick's branch, unused's entry, and main's entry. */
+const char * program =
+    "define i32 @pick(i1 %c) {\n"
+    "entry:\n"
+    "  br i1 %c, label %yes, label %no\n"
+    "yes:\n"
+    "  ret i32 1\n"
+    "no:\n"
+    "  ret i32 2\n"
+    "}\n"
+    "define void @unused() {\n"
+    "  ret void\n"
+    "}\n"
+    "define i32 @main() {\n"
+    "  %r = call i32 @pick(i1 true)\n"
+    "  ret i32 %r\n"
+    "}\n";
+
+const char * profilePath = "ProfileTest.profile";
+
+class ProfileTest : public testing::Test {
+protected:
+  LLVMContext context;
+  OwningPtr<Module> module;
+  uint64_t checksum;
+
+  virtual void SetUp() {
+    removeProfile();
+    checksum = programChecksum();
+    module.reset(parseIR(context, program));
+    ASSERT_TRUE(module != NULL);
+  }
+
+  virtual void TearDown() {
+    removeProfile();
+  }
+
+  static void removeProfile() {
+    bool existed;
+    sys::fs::remove(profilePath, existed);
+  }
+
+  /** Return the checksum that an instrumented build of the program passes to
+      the runtime, and which the runtime writes to the profile. */
+  uint64_t programChecksum() {
+    OwningPtr<Module> instrumented(parseIR(context, program));
+    if (instrumented == NULL) {
+      return 0;
+    }
+
+    tart::ProfileInstrumenter instrumenter;
+    instrumenter.runOnModule(*instrumented);
+    Function * profileInit = instrumented->getFunction("Profile_init");
+    if (profileInit == NULL || profileInit->use_empty()) {
+      ADD_FAILURE() << "program was not instrumented";
+      return 0;
+    }
+
+    CallInst * call = cast<CallInst>(*profileInit->use_begin());
+    return cast<ConstantInt>(call->getArgOperand(2))->getZExtValue();
+  }
+
+  /** Write 'contents' to the profile file. */
+  static void writeProfile(const std::string & contents) {
+    std::string errorInfo;
+    raw_fd_ostream out(profilePath, errorInfo);
+    ASSERT_EQ("", errorInfo);
+    out << contents;
+  }
+
+  /** Write a profile for the program with the given checksum, in which pick is
+      called 10 times and its branch is taken 7 times. */
+  static void writeProfile(uint64_t checksum) {
+    std::string contents;
+    raw_string_ostream out(contents);
+    out << "tart-profile " << checksum << " 5\n10\n7\n3\n0\n1\n";
+    writeProfile(out.str());
+  }
+
+  /** Apply the profile file to the module. Returns the error message, or an empty
+      string if the profile was applied. */
+  std::string annotate() {
+    tart::ProfileAnnotator annotator(profilePath);
+    bool changed = annotator.runOnModule(*module);
+    EXPECT_EQ(changed, annotator.errorMessage().empty());
+    return annotator.errorMessage();
+  }
+
+  BranchInst * pickBranch() {
+    return cast<BranchInst>(module->getFunction("pick")->getEntryBlock().getTerminator());
+  }
+};
+
+TEST_F(ProfileTest, BranchWeights) {
+  writeProfile(checksum);
+  ASSERT_EQ("", annotate());
+
+  // One is added to each count, so that neither weight is zero.
+  MDNode * weights = pickBranch()->getMetadata(LLVMContext::MD_prof);
+  ASSERT_TRUE(weights != NULL);
+  ASSERT_EQ(3u, weights->getNumOperands());
+  EXPECT_EQ("branch_weights", cast<MDString>(weights->getOperand(0))->getString());
+  EXPECT_EQ(8u, cast<ConstantInt>(weights->getOperand(1))->getZExtValue());
+  EXPECT_EQ(4u, cast<ConstantInt>(weights->getOperand(2))->getZExtValue());
+}
+
+TEST_F(ProfileTest, HotAndColdFunctions) {
+  writeProfile(checksum);
+  ASSERT_EQ("", annotate());
+
+  Function * unused = module->getFunction("unused");
+  EXPECT_TRUE(unused->hasFnAttr(Attribute::OptimizeForSize));
+  EXPECT_EQ(".text.unlikely", unused->getSection());
+  EXPECT_TRUE(module->getFunction("pick")->hasFnAttr(Attribute::InlineHint));
+
+  // Functions are ordered by decreasing call count.
+  Module::iterator it = module->begin();
+  EXPECT_EQ("pick", it->getName());
+  EXPECT_EQ("main", (++it)->getName());
+  EXPECT_EQ("unused", (++it)->getName());
+}
+
+TEST_F(ProfileTest, ChecksumMismatch) {
+  writeProfile(checksum + 1);
+  EXPECT_EQ("profile does not match this program", annotate());
+  EXPECT_EQ(NULL, pickBranch()->getMetadata(LLVMContext::MD_prof));
+  EXPECT_FALSE(module->getFunction("unused")->hasFnAttr(Attribute::OptimizeForSize));
+}
+
+TEST_F(ProfileTest, CounterCountMismatch) {
+  std::string contents;
+  raw_string_ostream out(contents);
+  out << "tart-profile " << checksum << " 4\n10\n7\n3\n0\n";
+  writeProfile(out.str());
+  EXPECT_EQ("profile does not match this program", annotate());
+  EXPECT_EQ(NULL, pickBranch()->getMetadata(LLVMContext::MD_prof));
+}
+
+TEST_F(ProfileTest, MissingFile) {
+  EXPECT_EQ(0u, annotate().find("can't read ProfileTest.profile"));
+}
+
+TEST_F(ProfileTest, InvalidProfile) {
+  const std::string invalid = std::string(profilePath) + " is not a valid profile";
+
+  writeProfile("");
+  EXPECT_EQ(invalid, annotate());
+
+  // Wrong header.
+  writeProfile("profile 1 1\n0\n");
+  EXPECT_EQ(invalid, annotate());
+
+  // Fewer counts than the header says.
+  writeProfile("tart-profile 1 2\n0\n");
+  EXPECT_EQ(invalid, annotate());
+
+  // A count which isn't a number.
+  writeProfile("tart-profile 1 1\nmany\n");
+  EXPECT_EQ(invalid, annotate());
+
+  EXPECT_EQ(NULL, pickBranch()->getMetadata(LLVMContext::MD_prof));
+}
+
+}
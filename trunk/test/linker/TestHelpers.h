@@ -0,0 +1,53 @@
+/* ================================================================ *
+    TART - A Sweet Programming Language.
+ * ================================================================ */
+
+#ifndef TART_TEST_LINKER_TESTHELPERS_H
+#define TART_TEST_LINKER_TESTHELPERS_H
+
+#include <gtest/gtest.h>
+
+#include "llvm/LLVMContext.h"
+#include "llvm/Module.h"
+#include "llvm/Instructions.h"
+#include "llvm/Assembly/Parser.h"
+#include "llvm/Support/CallSite.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/raw_ostream.h"
+
+/** Parse a module from LLVM assembly. Reports a test failure and returns NULL if
+    the source doesn't parse. */
+inline llvm::Module * parseIR(llvm::LLVMContext & context, const char * source) {
+  llvm::SMDiagnostic err;
+  llvm::Module * module = llvm::ParseAssemblyString(source, NULL, err, context);
+  if (module == NULL) {
+    std::string msg;
+    llvm::raw_string_ostream os(msg);
+    err.Print("linkertest", os);
+    ADD_FAILURE() << os.str();
+  }
+
+  return module;
+}
+
+/** Return the first call or invoke instruction in 'fn', or NULL if there isn't one. */
+inline llvm::Instruction * findCall(llvm::Function * fn) {
+  for (llvm::Function::iterator bb = fn->begin(); bb != fn->end(); ++bb) {
+    for (llvm::BasicBlock::iterator inst = bb->begin(); inst != bb->end(); ++inst) {
+      if (llvm::isa<llvm::CallInst>(inst) || llvm::isa<llvm::InvokeInst>(inst)) {
+        return inst;
+      }
+    }
+  }
+
+  return NULL;
+}
+
+/** Return the function called directly by the first call in 'fn', or NULL if that
+    call is indirect. */
+inline llvm::Function * directCallee(llvm::Function * fn) {
+  llvm::Instruction * call = findCall(fn);
+  return call != NULL ? llvm::CallSite(call).getCalledFunction() : NULL;
+}
+
+#endif // TART_TEST_LINKER_TESTHELPERS_H
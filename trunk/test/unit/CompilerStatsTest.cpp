@@ -0,0 +1,219 @@
+/* ================================================================ *
+    TART - A Sweet Programming Language.
+ * ================================================================ */
+
+#include <gtest/gtest.h>
+
+#include "tart/Common/CompilerStats.h"
+
+#include "llvm/Support/TimeValue.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <ctype.h>
+
+namespace {
+
+using namespace tart;
+
+// Timers are registered for the life of the program, so these are static.
+PhaseTimer outerPhase("test-outer", "Test outer phase");
+PhaseTimer innerPhase("test-inner", "Test inner phase", &outerPhase);
+PhaseTimer recursivePhase("test-recursive", "Test recursive phase");
+PhaseTimer disabledPhase("test-disabled", "Test disabled phase");
+StatCounter testCounter("test-counter", "Test counter");
+
+/** Return the current wall clock time in microseconds, as the timers measure it. */
+uint64_t now() {
+  llvm::sys::TimeValue time = llvm::sys::TimeValue::now();
+  return uint64_t(time.seconds()) * 1000000 + time.microseconds();
+}
+
+/** Wait until at least 'micros' microseconds have passed. */
+void spin(uint64_t micros) {
+  uint64_t end = now() + micros;
+  while (now() < end) {}
+}
+
+/** A minimal JSON syntax checker. */
+class JsonChecker {
+public:
+  JsonChecker(const std::string & text) : pos_(text.c_str()) {}
+
+  /** True if the text is a single well-formed JSON value. */
+  bool check() {
+    if (!value()) {
+      return false;
+    }
+
+    skipSpace();
+    return *pos_ == '\0';
+  }
+
+private:
+  const char * pos_;
+
+  void skipSpace() {
+    while (isspace(*pos_)) {
+      ++pos_;
+    }
+  }
+
+  bool accept(char ch) {
+    skipSpace();
+    if (*pos_ == ch) {
+      ++pos_;
+      return true;
+    }
+    return false;
+  }
+
+  bool value() {
+    skipSpace();
+    switch (*pos_) {
+      case '{': return sequence('{', '}', true);
+      case '[': return sequence('[', ']', false);
+      case '"': return string();
+      default: return number();
+    }
+  }
+
+  /** An object or an array. Object members are 'string: value' pairs. */
+  bool sequence(char open, char close, bool isObject) {
+    accept(open);
+    if (accept(close)) {
+      return true;
+    }
+
+    do {
+      if (isObject) {
+        skipSpace();
+        if (!string() || !accept(':')) {
+          return false;
+        }
+      }
+
+      if (!value()) {
+        return false;
+      }
+    } while (accept(','));
+
+    return accept(close);
+  }
+
+  bool string() {
+    if (*pos_ != '"') {
+      return false;
+    }
+
+    for (++pos_; *pos_ != '"'; ++pos_) {
+      if (*pos_ == '\0' || *pos_ == '\n') {
+        return false;
+      } else if (*pos_ == '\\' && *++pos_ == '\0') {
+        return false;
+      }
+    }
+
+    ++pos_;
+    return true;
+  }
+
+  bool number() {
+    const char * start = pos_;
+    while (isdigit(*pos_)) {
+      ++pos_;
+    }
+    return pos_ != start;
+  }
+};
+
+class CompilerStatsTest : public testing::Test {
+protected:
+  virtual void SetUp() {
+    PhaseTimer::setEnabled(true);
+  }
+
+  virtual void TearDown() {
+    PhaseTimer::setEnabled(false);
+  }
+
+  static std::string statsJson() {
+    std::string result;
+    llvm::raw_string_ostream out(result);
+    printStatsJson(out);
+    return out.str();
+  }
+};
+
+TEST_F(CompilerStatsTest, NestedPhases) {
+  {
+    PhaseScope outer(outerPhase);
+    spin(2000);
+    {
+      PhaseScope inner(innerPhase);
+      spin(5000);
+    }
+    spin(2000);
+  }
+
+  EXPECT_EQ(1u, outerPhase.count());
+  EXPECT_EQ(1u, innerPhase.count());
+  EXPECT_LE(5000u, innerPhase.totalTime());
+  EXPECT_EQ(innerPhase.totalTime(), innerPhase.selfTime());
+
+  // The outer phase's self time excludes exactly the time spent in the inner one.
+  EXPECT_LE(9000u, outerPhase.totalTime());
+  EXPECT_LE(4000u, outerPhase.selfTime());
+  EXPECT_EQ(outerPhase.totalTime(), outerPhase.selfTime() + innerPhase.totalTime());
+}
+
+TEST_F(CompilerStatsTest, RecursivePhaseCountedOnce) {
+  {
+    PhaseScope outer(recursivePhase);
+    spin(1000);
+    {
+      PhaseScope inner(recursivePhase);
+      spin(1000);
+    }
+  }
+
+  EXPECT_EQ(1u, recursivePhase.count());
+  EXPECT_LE(2000u, recursivePhase.totalTime());
+  EXPECT_EQ(recursivePhase.totalTime(), recursivePhase.selfTime());
+}
+
+TEST_F(CompilerStatsTest, Disabled) {
+  PhaseTimer::setEnabled(false);
+  {
+    PhaseScope scope(disabledPhase);
+    spin(1000);
+  }
+
+  EXPECT_EQ(0u, disabledPhase.count());
+  EXPECT_EQ(0u, disabledPhase.totalTime());
+}
+
+TEST_F(CompilerStatsTest, JsonWellFormed) {
+  {
+    PhaseScope outer(outerPhase);
+    PhaseScope inner(innerPhase);
+  }
+  ++testCounter;
+
+  std::string json = statsJson();
+  EXPECT_TRUE(JsonChecker(json).check()) << json;
+  EXPECT_NE(std::string::npos, json.find("\"phases\": ["));
+  EXPECT_NE(std::string::npos, json.find("\"counters\": {"));
+  EXPECT_NE(std::string::npos,
+      json.find("{\"name\": \"test-inner\", \"parent\": \"test-outer\", "));
+  EXPECT_NE(std::string::npos, json.find("\"test-counter\": 1"));
+}
+
+TEST(JsonCheckerTest, RejectsMalformed) {
+  EXPECT_TRUE(JsonChecker("{\"a\": [1, 2], \"b\": {}}").check());
+  EXPECT_FALSE(JsonChecker("{\"a\": [1, 2,]}").check());
+  EXPECT_FALSE(JsonChecker("{\"a\": 1,}").check());
+  EXPECT_FALSE(JsonChecker("{\"a\" 1}").check());
+  EXPECT_FALSE(JsonChecker("[1] [2]").check());
+}
+
+}
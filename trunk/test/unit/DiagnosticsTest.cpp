@@ -0,0 +1,52 @@
+/* ================================================================ *
+    TART - A Sweet Programming Language.
+ * ================================================================ */
+
+#include <gtest/gtest.h>
+#include "tart/Common/Diagnostics.h"
+#include "llvm/Support/CommandLine.h"
+
+using namespace tart;
+
+namespace {
+  /** A formattable object which counts the number of times it has been formatted. */
+  class CountedFormattable : public Formattable {
+  public:
+    CountedFormattable(const char * text) : text_(text), count_(0) {}
+
+    void format(FormatStream & out) const {
+      ++count_;
+      out << text_;
+      if (out.isVerbose()) {
+        out << " (verbose)";
+      }
+    }
+
+    int count() const { return count_; }
+
+  private:
+    const char * text_;
+    mutable int count_;
+  };
+
+  llvm::cl::opt<bool> TestTrace("test-trace", llvm::cl::Hidden);
+  Diagnostics::DebugOption TestTraceDebug(TestTrace);
+}
+
+TEST(DiagnosticsTest, IsEnabled) {
+  ASSERT_TRUE(diag.isEnabled(Diagnostics::Debug));
+  diag.setMinSeverity(Diagnostics::Warning);
+  ASSERT_FALSE(diag.isEnabled(Diagnostics::Info));
+  ASSERT_TRUE(diag.isEnabled(Diagnostics::Error));
+
+  CountedFormattable obj("obj");
+  DDEBUG() << "Debug " << obj;
+  ASSERT_EQ(0, obj.count());
+  diag.setMinSeverity(Diagnostics::Debug);
+}
+
+TEST(DiagnosticsTest, DebugOption) {
+  ASSERT_FALSE(Diagnostics::DebugOption::anyGiven());
+  TestTrace.addOccurrence(0, "test-trace", "");
+  ASSERT_TRUE(Diagnostics::DebugOption::anyGiven());
+}
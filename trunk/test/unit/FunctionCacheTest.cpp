@@ -0,0 +1,132 @@
+/* ================================================================ *
+    TART - A Sweet Programming Language.
+ * ================================================================ */
+
+#include <gtest/gtest.h>
+
+#include "tart/Gen/FunctionCache.h"
+
+#include "tart/Defn/FunctionDefn.h"
+#include "tart/Defn/Module.h"
+#include "tart/Defn/TypeDefn.h"
+
+#include "tart/Expr/Constant.h"
+#include "tart/Expr/Exprs.h"
+#include "tart/Type/CompositeType.h"
+#include "tart/Type/PrimitiveType.h"
+#include "tart/Type/StaticType.h"
+
+#include "llvm/DerivedTypes.h"
+#include "llvm/Function.h"
+#include "llvm/LLVMContext.h"
+#include "llvm/Module.h"
+
+#include "FakeSourceFile.h"
+#include "TestHelpers.h"
+
+namespace {
+
+using namespace tart;
+
+class FunctionCacheTest : public testing::Test {
+protected:
+  SourceFile testSource;
+  Module testModule;
+  llvm::Module irModule;
+  llvm::Function * irFunction;
+  CompositeType * pointClass;
+  CompositeType * baseClass;
+
+  FunctionCacheTest()
+    : testSource("")
+    , testModule(&testSource, "test")
+    , irModule("test", llvm::getGlobalContext())
+  {
+    irFunction = llvm::Function::Create(
+        llvm::FunctionType::get(llvm::Type::getVoidTy(irModule.getContext()), false),
+        llvm::GlobalValue::ExternalLinkage, "test.f", &irModule);
+    pointClass = createClass("Point");
+    baseClass = createClass("Base");
+  }
+
+  CompositeType * createClass(StringRef name) {
+    TypeDefn * de = new TypeDefn(&testModule, name);
+    de->createQualifiedName(NULL);
+    de->addTrait(Defn::Singular);
+    CompositeType * type = new CompositeType(Type::Class, de, &testModule);
+    de->setValue(type);
+    return type;
+  }
+
+  FunctionDefn * createFunction(StringRef name, FunctionType * ftype) {
+    FunctionDefn * fn = new FunctionDefn(&testModule, name, ftype);
+    fn->createQualifiedName(NULL);
+    return fn;
+  }
+
+  /** Create a function 'f' whose body is 'body'. */
+  FunctionDefn * createFunction(Expr * body) {
+    FunctionDefn * fn = createFunction("f", &StaticFnType0<VoidType>::value);
+    fn->setBody(body);
+    return fn;
+  }
+
+  /** Create a function 'f' whose body calls 'callee'. */
+  FunctionDefn * createCaller(FunctionDefn * callee) {
+    FnCallExpr * call = new FnCallExpr(Expr::FnCall, SourceLocation(), callee, NULL);
+    call->appendArg(ConstantInteger::getSInt32(1));
+    return createFunction(call);
+  }
+
+  /** Create a function 'f' whose body allocates a 'type'. */
+  FunctionDefn * createAllocator(CompositeType * type, bool stackAlloc) {
+    NewExpr * alloc = new NewExpr(SourceLocation(), type);
+    alloc->setStackAlloc(stackAlloc);
+    return createFunction(alloc);
+  }
+
+  /** Return the key of 'fn', as computed by a new run of the compiler. */
+  uint64_t key(const FunctionDefn * fn) {
+    FunctionCache cache("fncache", "", &irModule);
+    return cache.key(fn, irFunction);
+  }
+};
+
+TEST_F(FunctionCacheTest, SameBodySameKey) {
+  uint64_t first = key(createAllocator(pointClass, false));
+  EXPECT_NE(0u, first);
+  EXPECT_EQ(first, key(createAllocator(pointClass, false)));
+}
+
+TEST_F(FunctionCacheTest, OptionsChangeKey) {
+  FunctionDefn * fn = createAllocator(pointClass, false);
+  FunctionCache inlineAlloc("fncache", "disable-inline-alloc=0", &irModule);
+  FunctionCache callAlloc("fncache", "disable-inline-alloc=1", &irModule);
+  EXPECT_NE(inlineAlloc.key(fn, irFunction), callAlloc.key(fn, irFunction));
+}
+
+TEST_F(FunctionCacheTest, TypeLayoutChangesKey) {
+  FunctionDefn * fn = createAllocator(pointClass, false);
+  uint64_t before = key(fn);
+
+  // Giving the class a superclass changes its layout, but not its name.
+  pointClass->bases().push_back(baseClass);
+  pointClass->setSuper(baseClass);
+  EXPECT_NE(before, key(fn));
+}
+
+TEST_F(FunctionCacheTest, CalleeSignatureChangesKey) {
+  // Both callees have the linkage name 'g(int32)->int32'; only the kind of the
+  // parameter differs.
+  FunctionDefn * positional = createFunction("g", &StaticFnType1<Int32Type, Int32Type>::value);
+  FunctionDefn * keywordOnly = createFunction("g",
+      &StaticFnType1<Int32Type, Int32Type, ParameterDefn::KeywordOnly>::value);
+  ASSERT_EQ(positional->linkageName(), keywordOnly->linkageName());
+  EXPECT_NE(key(createCaller(positional)), key(createCaller(keywordOnly)));
+}
+
+TEST_F(FunctionCacheTest, StackAllocChangesKey) {
+  EXPECT_NE(key(createAllocator(pointClass, false)), key(createAllocator(pointClass, true)));
+}
+
+}
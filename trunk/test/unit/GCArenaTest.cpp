@@ -0,0 +1,182 @@
+/* ================================================================ *
+    TART - A Sweet Programming Language.
+ * ================================================================ */
+
+#include <gtest/gtest.h>
+
+#include "tart/Common/GC.h"
+#include "tart/Common/CompilerStats.h"
+
+namespace {
+
+using namespace tart;
+
+/** A collectable object which counts how many of its kind have been destroyed. */
+class Node : public GC {
+public:
+  Node(Node * ref = NULL) : ref_(ref) {}
+  ~Node() { ++destroyed; }
+
+  void trace() const { safeMark(ref_); }
+
+  static int destroyed;
+
+private:
+  Node * ref_;
+};
+
+int Node::destroyed = 0;
+
+/** Roots are never unregistered, so the test uses a single static one. */
+class TestRoot : public GCRootBase {
+public:
+  TestRoot() : ptr(NULL) {}
+  void trace() const { GC::safeMark(ptr); }
+
+  GC * ptr;
+};
+
+TestRoot root;
+
+class GCArenaTest : public testing::Test {
+protected:
+  uint64_t arenasReleased;
+  uint64_t chunksReleased;
+
+  virtual void SetUp() {
+    // Collect whatever earlier tests left behind, so that it isn't counted here.
+    root.ptr = NULL;
+    GC::sweep();
+    Node::destroyed = 0;
+    arenasReleased = counter("gc-arenas-released");
+    chunksReleased = counter("gc-arena-chunks-released");
+  }
+
+  virtual void TearDown() {
+    root.ptr = NULL;
+    GC::sweep();
+  }
+
+  static uint64_t counter(const char * name) {
+    StatCounter * c = StatCounter::find(name);
+    return c != NULL ? c->value() : 0;
+  }
+
+  /** Number of arenas released since the test started. */
+  uint64_t newArenasReleased() const {
+    return counter("gc-arenas-released") - arenasReleased;
+  }
+
+  /** Number of chunks released since the test started. */
+  uint64_t newChunksReleased() const {
+    return counter("gc-arena-chunks-released") - chunksReleased;
+  }
+
+  /** Allocate a chain of 'count' nodes, enough to fill several chunks. Returns
+      the first node allocated, which is the end of the chain. */
+  static Node * allocateChain(int count) {
+    Node * first = new Node();
+    Node * last = first;
+    for (int i = 1; i < count; ++i) {
+      last = new Node(last);
+    }
+    return first;
+  }
+};
+
+TEST_F(GCArenaTest, UnreachableArenaReleased) {
+  {
+    GCArenaScope arena;
+    allocateChain(1000);
+  }
+
+  GC::sweep();
+  EXPECT_EQ(1000, Node::destroyed);
+  EXPECT_EQ(1u, newArenasReleased());
+}
+
+TEST_F(GCArenaTest, LiveObjectKeepsOnlyItsChunk) {
+  Node * first;
+  {
+    GCArenaScope arena;
+    first = allocateChain(1000);
+  }
+
+  // Only the first node is reachable, so only the first chunk is kept.
+  root.ptr = first;
+  GC::sweep();
+  EXPECT_EQ(999, Node::destroyed);
+  EXPECT_EQ(0u, newArenasReleased());
+  EXPECT_LT(0u, newChunksReleased());
+
+  // Once it dies, so does the arena.
+  root.ptr = NULL;
+  GC::sweep();
+  EXPECT_EQ(1000, Node::destroyed);
+  EXPECT_EQ(1u, newArenasReleased());
+}
+
+TEST_F(GCArenaTest, OpenArenaNotSwept) {
+  {
+    GCArenaScope arena;
+    new Node();
+    GC::sweep();
+    EXPECT_EQ(0, Node::destroyed);
+  }
+
+  GC::sweep();
+  EXPECT_EQ(1, Node::destroyed);
+  EXPECT_EQ(1u, newArenasReleased());
+}
+
+TEST_F(GCArenaTest, ShareEnclosingUsesOuterArena) {
+  {
+    GCArenaScope outer;
+    new Node();
+    {
+      GCArenaScope inner(GCArenaScope::ShareEnclosing);
+      new Node();
+    }
+
+    // The inner node is in the outer arena, which is still open.
+    GC::sweep();
+    EXPECT_EQ(0, Node::destroyed);
+  }
+
+  GC::sweep();
+  EXPECT_EQ(2, Node::destroyed);
+  EXPECT_EQ(1u, newArenasReleased());
+}
+
+TEST_F(GCArenaTest, NewArenaNestsInsideOuter) {
+  {
+    GCArenaScope outer;
+    new Node();
+    {
+      GCArenaScope inner;
+      new Node();
+    }
+
+    // The inner arena is closed, so it can be swept while the outer one is open.
+    GC::sweep();
+    EXPECT_EQ(1, Node::destroyed);
+    EXPECT_EQ(1u, newArenasReleased());
+  }
+
+  GC::sweep();
+  EXPECT_EQ(2, Node::destroyed);
+  EXPECT_EQ(2u, newArenasReleased());
+}
+
+TEST_F(GCArenaTest, ShareEnclosingWithoutOuterOpensArena) {
+  {
+    GCArenaScope arena(GCArenaScope::ShareEnclosing);
+    new Node();
+  }
+
+  GC::sweep();
+  EXPECT_EQ(1, Node::destroyed);
+  EXPECT_EQ(1u, newArenasReleased());
+}
+
+}
@@ -48,6 +48,62 @@ TEST(ScopeTest, LargeScope) {
   ASSERT_EQ(32u, testScope.count());
 }
 
+TEST(ScopeTest, LookupByCopy) {
+  SymbolTable   testScope;
+  VariableDefn var0(VariableDefn::Var, NULL, "var0");
+  VariableDefn var1(VariableDefn::Var, NULL, "var0");
+  testScope.add(&var0);
+  testScope.add(&var1);
+
+  // Overloads share an entry, and names are found from any copy of the text.
+  std::string copy("var0");
+  const SymbolTable::Entry * entry = testScope.findSymbol(copy);
+  ASSERT_TRUE(entry != NULL);
+  ASSERT_EQ(2u, entry->size());
+  ASSERT_EQ(&var0, (*entry)[0]);
+  ASSERT_EQ(&var1, (*entry)[1]);
+  ASSERT_EQ(1u, testScope.count());
+
+  ASSERT_TRUE(testScope.findSymbol("var") == NULL);
+  ASSERT_TRUE(testScope.findSymbol("ScopeTest_neverInterned") == NULL);
+}
+
+TEST(ScopeTest, IterationOrder) {
+  SymbolTable   testScope;
+  const char * names[] = { "zeta", "alpha", "mu", "beta", "omega", "gamma", "eta", "chi",
+      "psi", "delta", "iota", "kappa" };
+  VariableDefn * decls[12];
+  for (int i = 0; i < 12; ++i) {
+    decls[i] = new VariableDefn(VariableDefn::Var, NULL, names[i]);
+    testScope.add(decls[i]);
+  }
+
+  int index = 0;
+  for (SymbolTable::const_iterator it = testScope.begin(); it != testScope.end(); ++it) {
+    ASSERT_EQ(decls[index], it->second.front());
+    ASSERT_EQ(StringRef(names[index]), it->name());
+    ++index;
+  }
+
+  ASSERT_EQ(12, index);
+  testScope.clear();
+  ASSERT_EQ(0u, testScope.count());
+  ASSERT_TRUE(testScope.findSymbol("alpha") == NULL);
+}
+
+TEST(ScopeTest, IdentTable) {
+  std::string first("ScopeTest_ident");
+  std::string second("ScopeTest_ident");
+  const Ident * a = IdentTable::get(first);
+  const Ident * b = IdentTable::get(second);
+  ASSERT_EQ(a, b);
+  ASSERT_EQ(a, IdentTable::find(a->getKey()));
+  ASSERT_NE(first.data(), a->getKeyData());
+  ASSERT_NE(0u, a->getValue().id);
+  ASSERT_NE(a->getValue().id, IdentTable::get("ScopeTest_other")->getValue().id);
+  ASSERT_TRUE(IdentTable::find("ScopeTest_missing") == NULL);
+}
+
 #if 0
 TEST(ScopeTest, BlockScope) {
   LocalScope   parentScope(NULL);
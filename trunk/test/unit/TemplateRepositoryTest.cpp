@@ -0,0 +1,197 @@
+/* ================================================================ *
+    TART - A Sweet Programming Language.
+ * ================================================================ */
+
+#include <gtest/gtest.h>
+
+#include "tart/Common/TemplateRepository.h"
+#include "tart/Common/Diagnostics.h"
+
+#include "tart/Defn/FunctionDefn.h"
+#include "tart/Defn/Module.h"
+
+#include "tart/Expr/Constant.h"
+#include "tart/Type/StaticType.h"
+
+#include "tart/Objects/Builtins.h"
+
+#include "llvm/Support/FileSystem.h"
+
+#include "FakeSourceFile.h"
+
+namespace {
+
+using namespace tart;
+
+class TemplateRepositoryTest : public testing::Test {
+protected:
+  Module * owner;
+  Module * user;
+  Module * observer;
+  FunctionDefn * instance;
+  std::string savedPath;
+
+  TemplateRepositoryTest()
+    : owner(createModule("test.Owner"))
+    , user(createModule("test.User"))
+    , observer(createModule("test.Observer"))
+    , instance(createInstance("List[int].add"))
+  {}
+
+  virtual void SetUp() {
+    savedPath = TemplateRepository::path().str();
+    TemplateRepository::setPath("TemplateRepositoryTest.templates");
+    removeFiles();
+  }
+
+  virtual void TearDown() {
+    removeFiles();
+    TemplateRepository::setPath(savedPath);
+    diag.reset();
+    diag.setMinSeverity(Diagnostics::Debug);
+  }
+
+  static void removeFiles() {
+    bool existed;
+    llvm::sys::fs::remove("TemplateRepositoryTest.templates", existed);
+    llvm::sys::fs::remove("TemplateRepositoryTest.templates.lock", existed);
+  }
+
+  static Module * createModule(StringRef name) {
+    Module * mod = new Module(name, &Builtins::module);
+    mod->setModuleSource(new FakeSourceFile(""));
+    return mod;
+  }
+
+  /** Create a method that looks like an instance method of a template, which is
+      the only kind of definition that the repository shares. */
+  FunctionDefn * createInstance(StringRef name) {
+    FunctionDefn * fn = new FunctionDefn(owner, name, &StaticFnType0<VoidType>::value);
+    fn->createQualifiedName(NULL);
+    fn->addTrait(Defn::Synthetic);
+    fn->addTrait(Defn::Singular);
+    fn->setBody(ConstantInteger::getSInt32(0));
+    return fn;
+  }
+
+  /** Compile 'mod' against a freshly loaded repository, as a separate tartc
+      process would, using the instances in 'uses'. Returns the stale modules. */
+  std::vector<std::string> compile(Module * mod, FunctionDefn * uses = NULL) {
+    TemplateRepository repo;
+    repo.beginModule(mod);
+    if (uses != NULL) {
+      repo.claim(uses, mod);
+    }
+
+    llvm::SmallVector<std::string, 4> stale;
+    repo.endModule(mod, stale);
+    return std::vector<std::string>(stale.begin(), stale.end());
+  }
+
+  /** True if a freshly loaded repository says that 'mod' owns 'de'. The
+      repository is read by compiling an unrelated module. */
+  bool ownedBy(const Defn * de, const Module * mod) {
+    TemplateRepository repo;
+    repo.beginModule(observer);
+    bool result = repo.isOwner(de, mod);
+    llvm::SmallVector<std::string, 4> stale;
+    repo.endModule(observer, stale);
+    return result;
+  }
+};
+
+TEST_F(TemplateRepositoryTest, FirstUserOwns) {
+  TemplateRepository repo;
+  repo.beginModule(owner);
+  EXPECT_TRUE(repo.claim(instance, owner));
+  EXPECT_TRUE(repo.isOwner(instance, owner));
+  llvm::SmallVector<std::string, 4> stale;
+  repo.endModule(owner, stale);
+  EXPECT_TRUE(stale.empty());
+
+  // A later module only imports it.
+  TemplateRepository later;
+  later.beginModule(user);
+  EXPECT_FALSE(later.claim(instance, user));
+  EXPECT_FALSE(later.isOwner(instance, user));
+  later.endModule(user, stale);
+  EXPECT_TRUE(stale.empty());
+  EXPECT_EQ(0, diag.getErrorCount());
+}
+
+TEST_F(TemplateRepositoryTest, Disabled) {
+  TemplateRepository::setPath("");
+  TemplateRepository repo;
+  repo.beginModule(user);
+  EXPECT_TRUE(repo.claim(instance, user));
+  EXPECT_FALSE(repo.isOwner(instance, user));
+  llvm::SmallVector<std::string, 4> stale;
+  repo.endModule(user, stale);
+  EXPECT_TRUE(stale.empty());
+}
+
+TEST_F(TemplateRepositoryTest, ReleasedInstanceMakesImportersStale) {
+  compile(owner, instance);
+  compile(user, instance);
+
+  // The owner no longer uses the instance, so the importer only has a declaration.
+  std::vector<std::string> stale = compile(owner);
+  ASSERT_EQ(1u, stale.size());
+  EXPECT_EQ("test.User", stale[0]);
+
+  // Compiling the importer again makes it the owner.
+  EXPECT_TRUE(compile(user, instance).empty());
+  EXPECT_TRUE(ownedBy(instance, user));
+}
+
+TEST_F(TemplateRepositoryTest, ReclaimedInstanceKeepsImporters) {
+  compile(owner, instance);
+  compile(user, instance);
+
+  // Recompiling the owner with the same uses changes nothing.
+  EXPECT_TRUE(compile(owner, instance).empty());
+  EXPECT_TRUE(ownedBy(instance, owner));
+
+  // The importer is still remembered the next time around.
+  std::vector<std::string> stale = compile(owner);
+  ASSERT_EQ(1u, stale.size());
+  EXPECT_EQ("test.User", stale[0]);
+}
+
+TEST_F(TemplateRepositoryTest, ConcurrentCompilesMerge) {
+  FunctionDefn * other = createInstance("List[int].remove");
+  llvm::SmallVector<std::string, 4> stale;
+
+  // Two compiles which both start before either has finished.
+  TemplateRepository first;
+  TemplateRepository second;
+  first.beginModule(owner);
+  second.beginModule(user);
+  EXPECT_TRUE(first.claim(instance, owner));
+  EXPECT_TRUE(second.claim(other, user));
+  first.endModule(owner, stale);
+  second.endModule(user, stale);
+  EXPECT_TRUE(stale.empty());
+
+  // Neither one's entries are lost.
+  EXPECT_TRUE(ownedBy(instance, owner));
+  EXPECT_TRUE(ownedBy(other, user));
+}
+
+TEST_F(TemplateRepositoryTest, OwnerLostDuringImport) {
+  compile(owner, instance);
+
+  // The importer reads the repository, and then the owner is recompiled without
+  // the instance before the importer has finished.
+  TemplateRepository importer;
+  importer.beginModule(user);
+  EXPECT_FALSE(importer.claim(instance, user));
+  EXPECT_TRUE(compile(owner).empty());
+
+  diag.setMinSeverity(Diagnostics::Off);
+  llvm::SmallVector<std::string, 4> stale;
+  importer.endModule(user, stale);
+  EXPECT_EQ(1, diag.getErrorCount());
+}
+
+}
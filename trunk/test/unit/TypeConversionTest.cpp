@@ -12,9 +12,13 @@
 #include "tart/Type/TupleType.h"
 #include "tart/Type/TypeRelation.h"
 #include "tart/Type/TypeConversion.h"
+#include "tart/Type/TypeQueryCache.h"
 #include "tart/Type/UnionType.h"
 
+#include "tart/Expr/Constant.h"
+
 #include "tart/Common/Diagnostics.h"
+#include "tart/Common/GC.h"
 
 #include "FakeSourceFile.h"
 #include "TestHelpers.h"
@@ -73,3 +77,59 @@ TEST_F(TypeConversionTest, TupleConversion) {
   EXPECT_EQ(IdenticalTypes, TypeConversion::check(tt1, tt1));
   EXPECT_EQ(Truncation, TypeConversion::check(tt1, tt2));
 }
+
+TEST_F(TypeConversionTest, CachedMatchesUncached) {
+  const Type * types[] = {
+    &BoolType::instance, &CharType::instance,
+    &Int8Type::instance, &Int16Type::instance, &Int32Type::instance, &Int64Type::instance,
+    &UInt8Type::instance, &UInt16Type::instance, &UInt32Type::instance, &UInt64Type::instance,
+    &FloatType::instance, &DoubleType::instance,
+  };
+  const int numTypes = sizeof(types) / sizeof(types[0]);
+  const int options[] = { 0, TypeConversion::EXPLICIT };
+
+  for (int o = 0; o < 2; ++o) {
+    for (int s = 0; s < numTypes; ++s) {
+      for (int d = 0; d < numTypes; ++d) {
+        // The first call computes the result, and the second one finds it in the cache.
+        TypeQueryCache::clear();
+        ConversionRank uncached = TypeConversion::check(types[s], types[d], options[o]);
+        ConversionRank cached = TypeConversion::check(types[s], types[d], options[o]);
+        EXPECT_EQ(uncached, cached) << "from " << s << " to " << d << " options " << options[o];
+      }
+    }
+  }
+
+  TypeQueryCache::clear();
+}
+
+TEST_F(TypeConversionTest, ExpressionsSkipCache) {
+  TypeQueryCache::clear();
+
+  // A constant source expression can be narrowed without loss, which the type
+  // alone can't tell.
+  Expr * srcExpr = ConstantInteger::getSInt32(1);
+  EXPECT_EQ(ExactConversion, TypeConversion::check(srcExpr, &Int8Type::instance));
+  EXPECT_EQ(0u, TypeQueryCache::size());
+  EXPECT_EQ(Truncation, TypeConversion::check(&Int32Type::instance, &Int8Type::instance));
+  EXPECT_NE(0u, TypeQueryCache::size());
+  EXPECT_EQ(ExactConversion, TypeConversion::check(srcExpr, &Int8Type::instance));
+
+  // Asking for the converted expression also bypasses the cache.
+  TypeQueryCache::clear();
+  Expr * dstExpr = NULL;
+  EXPECT_EQ(IdenticalTypes, TypeConversion::convert(&Int32Type::instance, srcExpr,
+      &Int32Type::instance, &dstExpr));
+  EXPECT_EQ(0u, TypeQueryCache::size());
+  EXPECT_TRUE(dstExpr != NULL);
+
+  TypeQueryCache::clear();
+}
+
+TEST_F(TypeConversionTest, SweepClearsCache) {
+  // The cache doesn't keep the types in it alive, so a collection empties it.
+  TypeConversion::check(&Int32Type::instance, &Int8Type::instance);
+  EXPECT_NE(0u, TypeQueryCache::size());
+  GC::sweep();
+  EXPECT_EQ(0u, TypeQueryCache::size());
+}
@@ -6,11 +6,23 @@
 
 #include "tart/Sema/BindingEnv.h"
 #include "tart/Sema/CallCandidate.h"
+#include "tart/Sema/Infer/TypeInference.h"
+
+#include "tart/Defn/FunctionDefn.h"
+#include "tart/Defn/Module.h"
 
 #include "tart/Expr/Exprs.h"
+#include "tart/Expr/Constant.h"
+#include "tart/Type/AmbiguousResultType.h"
 #include "tart/Type/StaticType.h"
 
+#include "tart/Objects/Builtins.h"
+#include "tart/Common/Diagnostics.h"
+
+#include "llvm/Support/TimeValue.h"
+
 #include "MockProvision.h"
+#include "FakeSourceFile.h"
 #include "TestHelpers.h"
 
 namespace {
@@ -19,10 +31,108 @@ using namespace tart;
 
 class TypeInferenceTest : public testing::Test {
 protected:
+  Module * module;
+  FunctionDefn * addInt32;
+  FunctionDefn * addInt64;
+  FunctionDefn * addFloat;
+  FunctionDefn * addDouble;
+  unsigned savedSearchLimit;
+
+  TypeInferenceTest()
+    : module(new Module("test", &Builtins::module))
+  {
+    module->setModuleSource(new FakeSourceFile(""));
+    addInt32 = new FunctionDefn(module, "add",
+        &StaticFnType2<Int32Type, Int32Type, Int32Type>::value);
+    addInt64 = new FunctionDefn(module, "add",
+        &StaticFnType2<Int64Type, Int64Type, Int64Type>::value);
+    addFloat = new FunctionDefn(module, "add",
+        &StaticFnType2<FloatType, FloatType, FloatType>::value);
+    addDouble = new FunctionDefn(module, "add",
+        &StaticFnType2<DoubleType, DoubleType, DoubleType>::value);
+  }
+
+  virtual void SetUp() {
+    savedSearchLimit = TypeInferencePass::searchLimit();
+  }
+
+  virtual void TearDown() {
+    TypeInferencePass::setSearchLimit(savedSearchLimit);
+    diag.reset();
+    diag.setMinSeverity(Diagnostics::Debug);
+  }
 
   CallExpr * createCall() {
     return new CallExpr(Expr::Call, SourceLocation(), NULL);
   }
+
+  void addCandidate(CallExpr * call, FunctionDefn * fn) {
+    ParameterAssignments pa;
+    ParameterAssignmentsBuilder builder(pa, fn->functionType());
+    for (size_t i = 0; i < call->argCount(); ++i) {
+      builder.addPositionalArg();
+    }
+
+    ASSERT_TRUE(builder.check());
+    call->candidates().push_back(new CallCandidate(call, NULL, fn, pa));
+  }
+
+  /** Create a call to the overloaded 'add' function. */
+  CallExpr * createAdd(Expr * a0, Expr * a1) {
+    CallExpr * call = createCall();
+    call->appendArg(a0);
+    call->appendArg(a1);
+    addCandidate(call, addInt32);
+    addCandidate(call, addInt64);
+    addCandidate(call, addFloat);
+    addCandidate(call, addDouble);
+    call->setType(new AmbiguousResultType(call));
+    return call;
+  }
+
+  /** Create a balanced tree of calls to 'add' with 2^depth leaves. The type of
+      each leaf is chosen by 'leafType'. */
+  Expr * createAddTree(int depth, int & leafIndex, const Type * (*leafType)(int)) {
+    if (depth == 0) {
+      int index = leafIndex++;
+      return ConstantInteger::get(SourceLocation(), leafType(index), index);
+    }
+
+    Expr * left = createAddTree(depth - 1, leafIndex, leafType);
+    Expr * right = createAddTree(depth - 1, leafIndex, leafType);
+    return createAdd(left, right);
+  }
+
+  /** Run type inference on 'expr', and return the time taken in microseconds. */
+  int64_t infer(Expr * expr) {
+    BindingEnv env;
+    llvm::sys::TimeValue start = llvm::sys::TimeValue::now();
+    TypeInferencePass::run(module, expr, env, QualifiedType());
+    llvm::sys::TimeValue elapsed = llvm::sys::TimeValue::now() - start;
+    return elapsed.seconds() * 1000000 + elapsed.microseconds();
+  }
+
+  /** Return the method chosen for a call. */
+  static FunctionDefn * chosenMethod(Expr * expr) {
+    CallExpr * call = cast<CallExpr>(expr);
+    if (call->candidates().size() != 1) {
+      return NULL;
+    }
+
+    return call->candidates().front()->method();
+  }
+
+  static const Type * allInt32(int index) {
+    return &Int32Type::instance;
+  }
+
+  static const Type * lastInt64(int index) {
+    if (index == 7) {
+      return &Int64Type::instance;
+    }
+
+    return &Int32Type::instance;
+  }
 };
 
 TEST_F(TypeInferenceTest, CallCandidateSpecificity) {
@@ -30,4 +140,66 @@ TEST_F(TypeInferenceTest, CallCandidateSpecificity) {
   (void)call;
 }
 
+TEST_F(TypeInferenceTest, SingleOverloadedCall) {
+  Expr * call = createAdd(
+      ConstantInteger::get(SourceLocation(), &Int64Type::instance, 1),
+      ConstantInteger::get(SourceLocation(), &Int64Type::instance, 2));
+  infer(call);
+  EXPECT_EQ(0, diag.getErrorCount());
+  EXPECT_EQ(addInt64, chosenMethod(call));
+}
+
+// A tree of 15 calls with 4 overloads each has over a billion combinations
+// of candidates, and must not be solved by trying them all.
+TEST_F(TypeInferenceTest, NestedOverloadsWorstCase) {
+  int leafIndex = 0;
+  Expr * root = createAddTree(4, leafIndex, allInt32);
+  int64_t micros = infer(root);
+  RecordProperty("inference_us", int(micros));
+  EXPECT_EQ(0, diag.getErrorCount());
+  EXPECT_EQ(0, diag.getWarningCount());
+
+  // Every call should select the int32 overload.
+  CallExpr * call = cast<CallExpr>(root);
+  while (call != NULL) {
+    EXPECT_EQ(addInt32, chosenMethod(call));
+    call = dyn_cast<CallExpr>(call->arg(0));
+  }
+}
+
+// As above, but one int64 leaf forces the calls on the path from that leaf
+// to the root to be widened, while the rest stay int32.
+TEST_F(TypeInferenceTest, NestedOverloadsMixedTypes) {
+  int leafIndex = 0;
+  Expr * root = createAddTree(3, leafIndex, lastInt64);
+  int64_t micros = infer(root);
+  RecordProperty("inference_us", int(micros));
+  EXPECT_EQ(0, diag.getErrorCount());
+
+  CallExpr * call = cast<CallExpr>(root);
+  EXPECT_EQ(addInt64, chosenMethod(call));
+  EXPECT_EQ(addInt32, chosenMethod(call->arg(0)));
+  EXPECT_EQ(addInt64, chosenMethod(call->arg(1)));
+  EXPECT_EQ(addInt32, chosenMethod(cast<CallExpr>(call->arg(1))->arg(0)));
+  EXPECT_EQ(addInt64, chosenMethod(cast<CallExpr>(call->arg(1))->arg(1)));
+}
+
+// Two candidates which are indistinguishable force a search; with a search
+// limit of zero the search gives up straight away, with a warning.
+TEST_F(TypeInferenceTest, SearchLimit) {
+  FunctionDefn * addInt32Copy = new FunctionDefn(module, "add",
+      &StaticFnType2<Int32Type, Int32Type, Int32Type>::value);
+  CallExpr * call = createCall();
+  call->appendArg(ConstantInteger::get(SourceLocation(), &Int32Type::instance, 1));
+  call->appendArg(ConstantInteger::get(SourceLocation(), &Int32Type::instance, 2));
+  addCandidate(call, addInt32);
+  addCandidate(call, addInt32Copy);
+  call->setType(new AmbiguousResultType(call));
+
+  TypeInferencePass::setSearchLimit(0);
+  diag.setMinSeverity(Diagnostics::Off);
+  infer(call);
+  EXPECT_EQ(1, diag.getWarningCount());
+}
+
 }
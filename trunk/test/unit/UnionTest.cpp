@@ -80,6 +80,7 @@ TEST_F(UnionTest, FloatOrVoidUnion) {
   ASSERT_FALSE(utype->hasNullType());
   ASSERT_TRUE(utype->isSingleOptionalType());
   ASSERT_FALSE(utype->hasRefTypesOnly());
+  ASSERT_FALSE(utype->isRefOrVoidType());
   ASSERT_EQ(&FloatType::instance, utype->getFirstNonVoidType());
   ASSERT_TRUE(utype->isSingular());
 }
@@ -110,6 +111,24 @@ TEST_F(UnionTest, NullOrRefTypeUnion) {
   ASSERT_TRUE(utype->isSingular());
 }
 
+TEST_F(UnionTest, VoidOrRefTypeUnion) {
+  QualifiedTypeList memberTypes;
+  memberTypes.push_back(&VoidType::instance);
+  memberTypes.push_back(testClass);
+  UnionType * utype = UnionType::get(memberTypes);
+  ASSERT_TRUE(utype->hasVoidType());
+  ASSERT_FALSE(utype->hasNullType());
+  ASSERT_FALSE(utype->isSingleOptionalType());
+  ASSERT_FALSE(utype->hasRefTypesOnly());
+  ASSERT_TRUE(utype->isRefOrVoidType());
+  // A null reference is a valid member value, so void needs its own discriminator.
+  ASSERT_GE(utype->getTypeIndex(&VoidType::instance), 0);
+  ASSERT_GE(utype->getTypeIndex(testClass), 0);
+  ASSERT_NE(utype->getTypeIndex(&VoidType::instance), utype->getTypeIndex(testClass));
+  ASSERT_EQ(testClass, utype->getFirstNonVoidType());
+  ASSERT_TRUE(utype->isSingular());
+}
+
 TEST_F(UnionTest, Coalesce) {
   QualifiedTypeList memberTypes;
   memberTypes.push_back(&Int32Type::instance);
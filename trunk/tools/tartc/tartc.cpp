@@ -5,17 +5,21 @@
 #include "tart/Common/GC.h"
 #include "tart/Common/Diagnostics.h"
 #include "tart/Common/Compiler.h"
+#include "tart/Common/CompilerStats.h"
 #include "tart/Common/PackageMgr.h"
 
 #include "tart/Objects/Builtins.h"
 #include "tart/Objects/TargetSelection.h"
 
+#include "llvm/Pass.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Signals.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/PrettyStackTrace.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/raw_ostream.h"
 
 #include "config_paths.h"
 
@@ -25,8 +29,11 @@ using namespace llvm::sys;
 
 // Global options
 
-//static cl::opt<bool>
-//Stats("showstats", cl::desc("Print performance metrics and statistics"));
+// Phase times are printed with -time-passes, and counters with -stats. Both options
+// are defined by LLVM.
+static cl::opt<std::string>
+StatsFile("stats-json", cl::desc("Write phase times and statistics to a JSON file"),
+    cl::value_desc("filename"));
 
 static cl::list<std::string>
 ModulePaths("i", cl::Prefix, cl::desc("Module search path"));
@@ -37,10 +44,24 @@ InputFilenames(cl::Positional, cl::desc("<input files>"));
 static cl::opt<bool>
 NoStdInc("nostdlib", cl::desc("Don't add the standard libraries to the module import path list"));
 
+static cl::opt<Diagnostics::Severity>
+MinSeverity("min-severity", cl::init(Diagnostics::Debug),
+    cl::desc("Don't write messages below this severity, except those asked for by "
+        "debugging options such as -trace-def"),
+    cl::values(
+        clEnumValN(Diagnostics::Debug, "debug", "Write all messages (the default)"),
+        clEnumValN(Diagnostics::Info, "info", "Leave out debugging messages"),
+        clEnumValN(Diagnostics::Warning, "warning", "Only write warnings and errors"),
+        clEnumValN(Diagnostics::Error, "error", "Only write errors"),
+        clEnumValEnd));
+
 int main(int argc, char **argv) {
   PrintStackTraceOnErrorSignal();
   cl::ParseCommandLineOptions(argc, argv, " tart\n");
   PrettyStackTraceProgram X(argc, argv);
+  PhaseTimer::setEnabled(TimePassesIsEnabled || !StatsFile.empty());
+  diag.setMinSeverity(
+      Diagnostics::DebugOption::anyGiven() ? Diagnostics::Debug : MinSeverity.getValue());
   //llvm_shutdown_obj Y; // Call llvm_shutdown() on exit.
 
   InitializeAllTargets();
@@ -68,26 +89,39 @@ int main(int argc, char **argv) {
     }
   }
 
-  // Now get the system classes we will need.
-  TargetSelection::init();
-  Builtins::init();
-  Builtins::loadSystemClasses();
+  {
+    PhaseScope scope(Phase::Compile);
+
+    // Now get the system classes we will need.
+    TargetSelection::init();
+    Builtins::init();
+    Builtins::loadSystemClasses();
+
+    // Process the input files.
+    Compiler compiler;
+    for (unsigned i = 0, e = InputFilenames.size(); i != e; ++i) {
+      const std::string &inFile = InputFilenames[i];
+      compiler.processInputFile(inFile);
+    }
+  }
+
+  if (TimePassesIsEnabled) {
+    PhaseTimer::print(errs());
+  }
 
-  // Process the input files.
-  Compiler compiler;
-  for (unsigned i = 0, e = InputFilenames.size(); i != e; ++i) {
-    const std::string &inFile = InputFilenames[i];
-    compiler.processInputFile(inFile);
+  if (AreStatisticsEnabled()) {
+    StatCounter::print(errs());
   }
 
-#if 0
-  if (Stats) {
-      // Printed from high-to-low level.
-      //SourceMgr.PrintStats();
-      //compiler.GetFileManager().PrintStats();
-      //fprintf(stderr, "\n");
+  if (!StatsFile.empty()) {
+    std::string errorInfo;
+    raw_fd_ostream out(StatsFile.c_str(), errorInfo);
+    if (!errorInfo.empty()) {
+      errs() << "Error writing statistics file '" << StatsFile << "': " << errorInfo << "\n";
+    } else {
+      printStatsJson(out);
+    }
   }
-#endif
 
   GC::uninit();
   return diag.getErrorCount() != 0;
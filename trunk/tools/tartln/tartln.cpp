@@ -26,18 +26,30 @@
 #include "llvm/Support/Program.h"
 #include "llvm/Support/TargetRegistry.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/Target/TargetData.h"
 #include "llvm/Target/TargetMachine.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/Transforms/IPO.h"
 #include "llvm/Transforms/IPO/PassManagerBuilder.h"
 #include "llvm/Transforms/Scalar.h"
 
 #include "tart/Reflect/ReflectorPass.h"
 #include "tart/Reflect/StaticRoots.h"
+#include "tart/Opt/BoundsCheckElim.h"
+#include "tart/Opt/Devirtualizer.h"
+#include "tart/Opt/ModulePartitioner.h"
+#include "tart/Opt/Profile.h"
+
+#include "config.h"
 
 #include <memory>
 #include <cstring>
 
+#if HAVE_PTHREADS
+  #include <pthread.h>
+#endif
+
 using namespace llvm;
 
 namespace tart {
@@ -127,9 +139,22 @@ static cl::opt<OptLevel> optOptimizationLevel(cl::init(O0),
 static cl::opt<bool> optDisableInline("disable-inlining",
     cl::desc("Do not run the inliner pass"));
 
+static cl::opt<bool> optDisableDevirt("disable-devirtualization",
+    cl::desc("Do not resolve virtual calls using class hierarchy analysis"));
+
+static cl::opt<bool> optDisableBoundsCheckElim("disable-bounds-check-elim",
+    cl::desc("Do not remove array bounds checks which are implied by loop conditions"));
+
 static cl::opt<bool> optInternalize("internalize",
     cl::desc("Mark all symbols as internal except for 'main'"));
 
+static cl::opt<bool> optProfileGenerate("profile-generate",
+    cl::desc("Instrument the program to write an execution profile when it exits"));
+
+static cl::opt<std::string> optProfileUse("profile-use",
+    cl::desc("Optimize using a profile written by a -profile-generate build"),
+    cl::value_desc("filename"));
+
 static cl::opt<bool> optVerifyEach("verify-each",
     cl::desc("Verify intermediate results of all passes"));
 
@@ -161,6 +186,11 @@ static cl::opt<bool> optNoImplicitFloats("no-implicit-float",
   cl::desc("Don't generate implicit floating point instructions (x86-only)"),
   cl::init(false));
 
+static cl::opt<unsigned> optJobs("j", cl::Prefix, cl::init(1),
+  cl::desc("Split the program into N partitions, and generate object code for them "
+      "in parallel"),
+  cl::value_desc("N"));
+
 /// printAndExit - Prints a message to standard error and exits with error code
 ///
 /// Inputs:
@@ -184,11 +214,105 @@ static inline void addPass(PassManagerBase & pm, Pass * pass) {
   }
 }
 
+// The bounds check elimination pass, if it was added by the pass manager builder.
+static tart::BoundsCheckElim * boundsCheckElim = NULL;
+
+// Runs after the loop optimizations, once the index operators have been inlined
+// and the loops rotated.
+static void addBoundsCheckElimPass(const PassManagerBuilder & builder, PassManagerBase & pm) {
+  boundsCheckElim = new tart::BoundsCheckElim();
+  addPass(pm, boundsCheckElim);
+}
+
+// The alias analyses that the link-time pipeline uses. They are immutable passes, so
+// they have to be added to each pass manager that runs LICM, GVN, DSE or MemCpyOpt.
+static void addAliasAnalysisPasses(PassManagerBase & pm) {
+  addPass(pm, createTypeBasedAliasAnalysisPass());
+  addPass(pm, createBasicAliasAnalysisPass());
+}
+
+// The interprocedural part of the link-time pipeline, which is the same as
+// PassManagerBuilder::populateLTOPassManager up to the point where it computes
+// GlobalsModRef and switches to function-level passes. Used when the rest is run
+// on each partition.
+static void addInterproceduralPasses(PassManagerBase & pm) {
+  addAliasAnalysisPasses(pm);
+  addPass(pm, createIPSCCPPass());
+  addPass(pm, createGlobalOptimizerPass());
+  addPass(pm, createConstantMergePass());
+  addPass(pm, createDeadArgEliminationPass());
+  addPass(pm, createInstructionCombiningPass());
+  if (!optDisableInline) {
+    addPass(pm, createFunctionInliningPass());
+  }
+  addPass(pm, createPruneEHPass());
+  if (!optDisableInline) {
+    addPass(pm, createGlobalOptimizerPass());
+  }
+  addPass(pm, createGlobalDCEPass());
+  addPass(pm, createArgumentPromotionPass());
+  addPass(pm, createInstructionCombiningPass());
+  addPass(pm, createJumpThreadingPass());
+  addPass(pm, createScalarReplAggregatesPass());
+  addPass(pm, createFunctionAttrsPass());
+}
+
+// The function-level optimizations from the end of the link-time pipeline. They only
+// look at one function at a time, so when the program is partitioned they are run on
+// each partition in parallel, rather than on the whole program. The pass manager
+// must already have the alias analyses in it.
+static void addFunctionOptPasses(PassManagerBase & pm) {
+  addPass(pm, createLICMPass());
+  addPass(pm, createGVNPass());
+  addPass(pm, createMemCpyOptPass());
+  addPass(pm, createDeadStoreEliminationPass());
+  addPass(pm, createInstructionCombiningPass());
+  addPass(pm, createJumpThreadingPass());
+}
+
+// The user's passes may leave cruft around. Clean up after them.
+static void addCleanupPasses(PassManagerBase & pm) {
+  addPass(pm, createInstructionCombiningPass());
+  addPass(pm, createCFGSimplificationPass());
+  addPass(pm, createAggressiveDCEPass());
+}
+
+// True if the program is to be split into partitions which are compiled in parallel.
+// This is only done for object files; the pieces of an assembly file can't simply be
+// pasted together.
+static bool isPartitioned() {
+  return optJobs > 1 && optOutputType == ObjectFile;
+}
+
 /// Optimize - Perform link time optimizations. This will run the scalar
 /// optimizations, any loaded plugin-optimization modules, and then the
 /// inter-procedural optimizations if applicable.
 void optimize(Module * module, const TargetData * targetData) {
 
+  // The profile passes have to see the program exactly as it was linked, so that the
+  // counters of an instrumented build line up with the code that the profile is
+  // applied to. So they are run before anything else.
+  if (optProfileGenerate) {
+    PassManager profilePasses;
+    tart::ProfileInstrumenter * instrumenter = new tart::ProfileInstrumenter();
+    profilePasses.add(instrumenter);
+    profilePasses.run(*module);
+    if (optVerbose) {
+      instrumenter->printStats(outs());
+    }
+  } else if (!optProfileUse.empty()) {
+    PassManager profilePasses;
+    tart::ProfileAnnotator * annotator = new tart::ProfileAnnotator(optProfileUse);
+    profilePasses.add(annotator);
+    profilePasses.run(*module);
+    if (!annotator->errorMessage().empty()) {
+      errs() << "tartln: warning: " << annotator->errorMessage() <<
+          "; the profile will not be used.\n";
+    } else if (optVerbose) {
+      annotator->printStats(outs());
+    }
+  }
+
   // Instantiate the pass manager to organize the passes.
   FunctionPassManager fpm(module);
   PassManager passes;
@@ -219,6 +343,14 @@ void optimize(Module * module, const TargetData * targetData) {
     passes.add(createStripDeadDebugInfoPass());
   }
 
+  // With the whole program visible, resolve calls to methods that are never overridden,
+  // so that the inliner can see them.
+  tart::Devirtualizer * devirtualizer = NULL;
+  if (optOptimizationLevel > O0 && !optLinkAsLibrary && !optDisableDevirt) {
+    devirtualizer = new tart::Devirtualizer();
+    addPass(passes, devirtualizer);
+  }
+
   if (optOptimizationLevel > O0) {
     // Add an appropriate TargetData instance for this module...
     if (targetData) {
@@ -232,25 +364,32 @@ void optimize(Module * module, const TargetData * targetData) {
     }
     Builder.OptLevel = int(optOptimizationLevel);
     Builder.DisableSimplifyLibCalls = false;
+    if (!optDisableBoundsCheckElim) {
+      Builder.addExtension(PassManagerBuilder::EP_LoopOptimizerEnd, addBoundsCheckElimPass);
+    }
     Builder.populateFunctionPassManager(fpm);
     Builder.populateModulePassManager(passes);
-    Builder.populateLTOPassManager(
-        passes,
-        /*Internalize=*/ false,
-        /*RunInliner=*/ !optDisableInline);
+
+    // When the program is partitioned, the function-level part of the link-time
+    // pipeline is run on each partition instead.
+    if (isPartitioned()) {
+      addInterproceduralPasses(passes);
+    } else {
+      Builder.populateLTOPassManager(
+          passes,
+          /*Internalize=*/ false,
+          /*RunInliner=*/ !optDisableInline);
+    }
   }
 
-  // The user's passes may leave cruft around. Clean up after them them but
-  // only if we haven't got DisableOptimizations set
-  if (optOptimizationLevel > O0) {
-    addPass(passes, createInstructionCombiningPass());
-    addPass(passes, createCFGSimplificationPass());
-    addPass(passes, createAggressiveDCEPass());
-    addPass(passes, createGlobalDCEPass());
-  } else { //if (optInternalize) {
-    addPass(passes, createGlobalDCEPass());
+  // Clean up, but only if we haven't got DisableOptimizations set. When the program
+  // is partitioned, the cleanup passes are run on each partition instead.
+  if (optOptimizationLevel > O0 && !isPartitioned()) {
+    addCleanupPasses(passes);
   }
 
+  addPass(passes, createGlobalDCEPass());
+
   if (!optLinkAsLibrary) {
     addPass(passes, new tart::StaticRoots());
     addPass(passes, new tart::ReflectorPass());
@@ -275,9 +414,27 @@ void optimize(Module * module, const TargetData * targetData) {
 
   // Run our queue of passes all at once now, efficiently.
   passes.run(*module);
+
+  if (devirtualizer != NULL && optVerbose) {
+    devirtualizer->printStats(outs());
+  }
+
+  if (boundsCheckElim != NULL && optVerbose) {
+    boundsCheckElim->printStats(outs());
+  }
 }
 
-std::auto_ptr<TargetMachine> selectTarget(Module & mod) {
+/// The target chosen for the program: everything needed to create a TargetMachine.
+struct TargetSelection {
+  const Target * target;
+  std::string triple;
+  std::string features;
+};
+
+/// Choose the target for 'mod' from the command line options and the module's
+/// triple. This exits if there is no such target, so it must only be called from
+/// the main thread.
+static TargetSelection lookupTarget(Module & mod) {
   // If we are supposed to override the target triple, do so now.
   //if (!optTargetTriple.empty()) {
   //  mod.setTargetTriple(optTargetTriple);
@@ -340,10 +497,24 @@ std::auto_ptr<TargetMachine> selectTarget(Module & mod) {
 #endif
   }
 
+  TargetSelection selection;
+  selection.target = theTarget;
+  selection.triple = theTriple.getTriple();
+  selection.features = featuresStr;
+  return selection;
+}
+
+/// Create a target machine for a target chosen by lookupTarget. Each thread that
+/// generates code needs a target machine of its own.
+static std::auto_ptr<TargetMachine> createTargetMachine(const TargetSelection & selection) {
   TargetOptions options;
   return std::auto_ptr<TargetMachine>(
-      theTarget->createTargetMachine(theTriple.getTriple(), optMCPU, StringRef(featuresStr),
-          options));
+      selection.target->createTargetMachine(selection.triple, optMCPU,
+          StringRef(selection.features), options));
+}
+
+std::auto_ptr<TargetMachine> selectTarget(Module & mod) {
+  return createTargetMachine(lookupTarget(mod));
 }
 
 /// GenerateBitcode - generates a bitcode file from the module provided
@@ -371,6 +542,40 @@ void generateBitcode(Module * module, const sys::Path & outputFilePath) {
   bcOut.close();
 }
 
+static CodeGenOpt::Level codeGenOptLevel() {
+  switch (optOptimizationLevel) {
+    case O0: return CodeGenOpt::None;
+    case O1: return CodeGenOpt::Less;
+    case O2: return CodeGenOpt::Default;
+    case O3: return CodeGenOpt::Aggressive;
+  }
+
+  return CodeGenOpt::Default;
+}
+
+/// Run the code generator on 'mod', writing the result to 'out'. Returns false if
+/// the target can't produce the requested kind of file.
+static bool emitMachineCode(Module & mod, formatted_raw_ostream & out, TargetMachine & target,
+    TargetMachine::CodeGenFileType codeGenType) {
+  // Build up all of the passes that we want to do to the module.
+  PassManager pm;
+
+  // Add the target data from the target machine, if it exists, or the module.
+  if (const TargetData * targetData = target.getTargetData()) {
+    pm.add(new TargetData(*targetData));
+  } else {
+    pm.add(new TargetData(&mod));
+  }
+
+  if (target.addPassesToEmitFile(pm, out, codeGenType, codeGenOptLevel())) {
+    errs() << "tartln: target does not support generation of this file type!\n";
+    return false;
+  }
+
+  pm.run(mod);
+  return true;
+}
+
 static void generateMachineCode(std::auto_ptr<Module> & mod, const sys::Path & assemblyFile,
     TargetMachine & target, TargetMachine::CodeGenFileType codeGenType) {
   std::string errMsg;
@@ -409,39 +614,184 @@ static void generateMachineCode(std::auto_ptr<Module> & mod, const sys::Path & a
     exit(1);
   }
 
-  CodeGenOpt::Level optLevel = CodeGenOpt::Default;
-  switch (optOptimizationLevel) {
-    case O0: optLevel = CodeGenOpt::None; break;
-    case O1: optLevel = CodeGenOpt::Less; break;
-    case O2: optLevel = CodeGenOpt::Default; break;
-    case O3: optLevel = CodeGenOpt::Aggressive; break;
+  // Override default to generate verbose assembly.
+  target.setAsmVerbosityDefault(true);
+
+  if (!emitMachineCode(*mod, *asOut, target, codeGenType)) {
+    sys::Path(assemblyFile).eraseFromDisk();
+    llvm_shutdown();
+    exit(1);
   }
+}
 
-  // Build up all of the passes that we want to do to the module.
-  PassManager pm;
+/// The work of compiling one partition of the program.
+struct PartitionJob {
+  const tart::ModulePartitioner * partitioner;
+  const TargetSelection * target;
+  const std::string * bitcode;
+  unsigned part;
+  sys::Path objectFile;
+  std::string errMsg;
+};
 
-  // Add the target data from the target machine, if it exists, or the module.
-  if (const TargetData * targetData = target.getTargetData()) {
-    pm.add(new TargetData(*targetData));
-  } else {
-    pm.add(new TargetData(mod.get()));
+/// Load a partition from the bitcode of the whole program, optimize its functions, and
+/// compile it to an object file. Each partition has its own LLVMContext, so that
+/// partitions can be compiled on separate threads.
+static void * compilePartition(void * arg) {
+  PartitionJob * job = static_cast<PartitionJob *>(arg);
+  LLVMContext context;
+
+  MemoryBuffer * buffer = MemoryBuffer::getMemBuffer(*job->bitcode, job->objectFile.str(), false);
+  std::auto_ptr<Module> mod(ParseBitcodeFile(buffer, context, &job->errMsg));
+  delete buffer;
+  if (mod.get() == NULL) {
+    return NULL;
   }
 
-  // Override default to generate verbose assembly.
-  target.setAsmVerbosityDefault(true);
+  job->partitioner->extract(mod.get(), job->part);
+  std::auto_ptr<TargetMachine> target = createTargetMachine(*job->target);
 
-  if (target.addPassesToEmitFile(pm, *asOut, codeGenType, optLevel)) {
-    errs() << "tartln: target does not support generation of this file type!\n";
-    goto fail;
+  // GlobalsModRef is a module pass, so the function passes are run by a module-level
+  // pass manager. It only sees the functions in this partition, but those are the
+  // ones being optimized; everything else is an external declaration to it.
+  PassManager passes;
+  passes.add(new TargetData(*target->getTargetData()));
+  if (optOptimizationLevel > O0) {
+    addAliasAnalysisPasses(passes);
+    addPass(passes, createGlobalsModRefPass());
+    addFunctionOptPasses(passes);
+    addCleanupPasses(passes);
   }
 
-  pm.run(*mod);
-  return;
+  // Get rid of the declarations and copied constants that this partition doesn't use.
+  addPass(passes, createGlobalDCEPass());
+  passes.run(*mod);
 
-fail:
-  sys::Path(assemblyFile).eraseFromDisk();
-  llvm_shutdown();
-  exit(1);
+  raw_fd_ostream * fdOut =
+      new raw_fd_ostream(job->objectFile.c_str(), job->errMsg, raw_fd_ostream::F_Binary);
+  if (!job->errMsg.empty()) {
+    delete fdOut;
+    return NULL;
+  }
+
+  formatted_raw_ostream objOut(*fdOut, formatted_raw_ostream::DELETE_STREAM);
+  if (!emitMachineCode(*mod, objOut, *target, TargetMachine::CGFT_ObjectFile)) {
+    job->errMsg = "code generation failed";
+  }
+
+  return NULL;
+}
+
+/// Combine the object files for each partition into a single relocatable object.
+static bool combineObjectFiles(const std::vector<PartitionJob> & jobs,
+    const sys::Path & outputFile) {
+  sys::Path ld = sys::Program::FindProgramByName("ld");
+  if (ld.isEmpty()) {
+    errs() << "tartln: can't find 'ld' to combine the object files.\n";
+    return false;
+  }
+
+  std::vector<const char *> args;
+  args.push_back(ld.c_str());
+  args.push_back("-r");
+  args.push_back("-o");
+  args.push_back(outputFile.c_str());
+  for (std::vector<PartitionJob>::const_iterator it = jobs.begin(); it != jobs.end(); ++it) {
+    args.push_back(it->objectFile.c_str());
+  }
+  args.push_back(NULL);
+
+  std::string errMsg;
+  if (sys::Program::ExecuteAndWait(ld, &args[0], NULL, NULL, 0, 0, &errMsg) != 0) {
+    errs() << "tartln: combining object files failed";
+    if (!errMsg.empty()) {
+      errs() << ": " << errMsg;
+    }
+    errs() << "\n";
+    return false;
+  }
+
+  return true;
+}
+
+/// Split the program into partitions, compile each one on its own thread, and combine
+/// the results into 'outputFile'. The partitions depend only on the program and on the
+/// value of -j, so the output is the same from one run to the next.
+static void generatePartitionedObjectFile(Module * module, const sys::Path & outputFile) {
+  // Choose the target here rather than in the threads, since a bad target exits.
+  TargetSelection target = lookupTarget(*module);
+
+  tart::ModulePartitioner partitioner(module, optJobs);
+  partitioner.run();
+  if (optVerbose) {
+    partitioner.printStats(outs());
+    outs() << "Generating object code to " << outputFile.str() << '\n';
+  }
+
+  // Each thread reads its own copy of the program from this.
+  std::string bitcode;
+  raw_string_ostream bcOut(bitcode);
+  WriteBitcodeToFile(module, bcOut);
+  bcOut.flush();
+
+  std::vector<PartitionJob> jobs(partitioner.numPartitions());
+  for (unsigned i = 0; i < jobs.size(); ++i) {
+    jobs[i].partitioner = &partitioner;
+    jobs[i].target = &target;
+    jobs[i].bitcode = &bitcode;
+    jobs[i].part = i;
+    jobs[i].objectFile = outputFile;
+    jobs[i].objectFile.eraseSuffix();
+    jobs[i].objectFile.appendSuffix("part" + utostr(i) + ".o");
+    sys::RemoveFileOnSignal(jobs[i].objectFile);
+  }
+
+  TargetMachine::setAsmVerbosityDefault(true);
+
+#if HAVE_PTHREADS
+  if (llvm_start_multithreaded()) {
+    std::vector<pthread_t> threads(jobs.size());
+    for (unsigned i = 0; i < jobs.size(); ++i) {
+      if (pthread_create(&threads[i], NULL, compilePartition, &jobs[i]) != 0) {
+        printAndExit("unable to create code generation thread");
+      }
+    }
+
+    for (unsigned i = 0; i < jobs.size(); ++i) {
+      pthread_join(threads[i], NULL);
+    }
+
+    llvm_stop_multithreaded();
+  } else
+#endif
+  {
+    for (unsigned i = 0; i < jobs.size(); ++i) {
+      compilePartition(&jobs[i]);
+    }
+  }
+
+  bool succeeded = true;
+  for (std::vector<PartitionJob>::const_iterator it = jobs.begin(); it != jobs.end(); ++it) {
+    if (!it->errMsg.empty()) {
+      errs() << "tartln: " << it->objectFile.str() << ": " << it->errMsg << '\n';
+      succeeded = false;
+    }
+  }
+
+  sys::RemoveFileOnSignal(outputFile);
+  if (succeeded) {
+    succeeded = combineObjectFiles(jobs, outputFile);
+  }
+
+  for (std::vector<PartitionJob>::iterator it = jobs.begin(); it != jobs.end(); ++it) {
+    it->objectFile.eraseFromDisk();
+  }
+
+  if (!succeeded) {
+    sys::Path(outputFile).eraseFromDisk();
+    llvm_shutdown();
+    exit(1);
+  }
 }
 
 // BuildLinkItems -- This function generates a LinkItemList for the LinkItems
@@ -539,15 +889,6 @@ int main(int argc, char **argv, char **envp) {
     std::auto_ptr<Module> composite(linker.releaseModule());
     std::auto_ptr<TargetMachine> targetMachine = selectTarget(*composite.get());
 
-    // Optimize the module
-    optimize(composite.get(), targetMachine->getTargetData());
-
-    if (optDumpAsm) {
-      errs() << "-------------------------------------------------------------\n";
-      errs() << composite.get();
-      errs() << "-------------------------------------------------------------\n";
-    }
-
     // Determine output file name - and possibly deduce file type
     sys::Path outputFilename;
     bool outputToStdout = (optOutputFilename == "-");
@@ -610,11 +951,22 @@ int main(int argc, char **argv, char **envp) {
       }
     }
 
+    // Optimize the module
+    optimize(composite.get(), targetMachine->getTargetData());
+
+    if (optDumpAsm) {
+      errs() << "-------------------------------------------------------------\n";
+      errs() << composite.get();
+      errs() << "-------------------------------------------------------------\n";
+    }
+
     if (optOutputType == BitcodeFile) {
       generateBitcode(composite.get(), outputFilename);
     } else if (optOutputType == AssemblyFile) {
       generateMachineCode(composite, outputFilename, *targetMachine.get(),
           TargetMachine::CGFT_AssemblyFile);
+    } else if (isPartitioned()) {
+      generatePartitionedObjectFile(composite.get(), outputFilename);
     } else if (optOutputType == ObjectFile) {
       generateMachineCode(composite, outputFilename, *targetMachine.get(),
           TargetMachine::CGFT_ObjectFile);